@@ -0,0 +1,147 @@
+/******************************************************************************
+
+File Name:    Aggregate.hpp
+Description:  This program creates the aggregate policies of an RST, monoids
+              summarizing the items of every subtree, along with the node
+              which stores the summary of its subtree
+
+******************************************************************************/
+
+
+#ifndef AGGREGATE_HPP
+#define AGGREGATE_HPP
+#include "BSTNode.hpp"
+#include <limits>
+#include <utility>
+
+
+/******************************************************************************
+struct NoAggregate
+
+Description: Creates a NoAggregate, the default aggregate policy of an RST.
+    Its nodes are plain BSTNodes and nothing is recomputed when the tree
+    changes shape
+******************************************************************************/
+struct NoAggregate {  };
+
+
+/******************************************************************************
+struct SumAggregate, MinAggregate, MaxAggregate
+
+Description: Create the aggregate policies adding up the items of a range or
+    finding the smallest or largest of them. Every aggregate policy gives
+
+        Value                   - the type of the summaries
+        identity()              - the summary of no items
+        of(item)                - the summary of a single item
+        combine(a, b)           - the summary of the items of a followed by
+                                  those of b, which must be associative
+
+    so a policy summing one field of a record only has to change of
+******************************************************************************/
+template<typename Data>
+struct SumAggregate {
+  typedef Data Value;
+
+  static Value identity() { return Value(); }
+  static const Value& of(const Data& item) { return item; }
+  static Value combine(const Value& a, const Value& b) { return a + b; }
+};
+
+template<typename Data>
+struct MinAggregate {
+  typedef Data Value;
+
+  static Value identity() { return std::numeric_limits<Value>::max(); }
+  static const Value& of(const Data& item) { return item; }
+  static Value combine(const Value& a, const Value& b) { return b < a ? b : a; }
+};
+
+template<typename Data>
+struct MaxAggregate {
+  typedef Data Value;
+
+  static Value identity() { return std::numeric_limits<Value>::lowest(); }
+  static const Value& of(const Data& item) { return item; }
+  static Value combine(const Value& a, const Value& b) { return a < b ? b : a; }
+};
+
+
+/******************************************************************************
+class AggregateNode
+
+Description: Creates an AggregateNode, a BSTNode which also keeps the summary
+    of its subtree under an aggregate policy. The tree holding it only ever
+    sees BSTNode pointers and casts them back to AggregateNodes to read or
+    recompute the summaries
+
+Data Fields:
+    total (Aggregate::Value) - the summary of the items of our subtree, in
+                               order
+
+Public functions:
+    AggregateNode - constructor for AggregateNode
+    totalOf       - gives the summary of a possibly empty subtree
+    updateTotal   - recomputes total from the children of a node
+******************************************************************************/
+template<typename Data, typename Aggregate>
+class AggregateNode : public BSTNode<Data> {
+
+public:
+
+  typename Aggregate::Value total;
+
+
+  /****************************************************************************
+  Function Name:  AggregateNode
+  Purpose:        This function initializes a node and its summary
+  Description:    This function passes args on to the constructor of BSTNode.
+                  The new node has no children, so its summary is that of its
+                  own item
+  Input:          args: the arguments for the constructor of BSTNode
+  Result:         An AggregateNode with no left, right, or parent node
+  ****************************************************************************/
+  template<typename... Args>
+  explicit AggregateNode(Args&&... args)
+      : BSTNode<Data>(std::forward<Args>(args)...),
+        total(Aggregate::of(this -> data)) {  }
+
+  static typename Aggregate::Value totalOf(const BSTNode<Data>* n) {
+    return n ? static_cast<const AggregateNode*>(n) -> total
+             : Aggregate::identity();
+  }
+
+
+  /****************************************************************************
+  Function Name:  updateTotal
+  Purpose:        This function recomputes the summary of our subtree
+  Description:    This function combines the summaries of our children, which
+                  must already be correct, with the summary of our item,
+                  keeping the items in order
+  Result:         total summarizes this node and its subtrees
+  ****************************************************************************/
+  void updateTotal() {
+    total = Aggregate::combine(
+      Aggregate::combine(totalOf(this -> left), Aggregate::of(this -> data)),
+      totalOf(this -> right));
+  }
+};
+
+
+/******************************************************************************
+struct AggregateNodeOf
+
+Description: Gives the node an RST with an aggregate policy is built from,
+    a plain BSTNode for NoAggregate so such trees carry nothing extra
+******************************************************************************/
+template<typename Data, typename Aggregate>
+struct AggregateNodeOf {
+  typedef AggregateNode<Data, Aggregate> type;
+};
+
+template<typename Data>
+struct AggregateNodeOf<Data, NoAggregate> {
+  typedef BSTNode<Data> type;
+};
+
+#endif // AGGREGATE_HPP
@@ -12,31 +12,84 @@ Description:  This program creates a class called BST, creating a binary
 #define BST_HPP
 #include "BSTNode.hpp"
 #include "BSTIterator.hpp"
+#include "NodePool.hpp"
+#include "KeyCompare.hpp"
+#include "BSTStats.hpp"
+#include <algorithm>
+#include <cmath>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 
 /******************************************************************************
 class BST
 
 Description: Creates a BST, or binary search tree, which will allow us to
-    insert or find BSTNodes
+    insert or find BSTNodes. Iterators refer to the BST object they came
+    from, so moving or swapping a BST, and RST::split or RST::merge,
+    invalidate all of its iterators
+
+Template Parameters:
+    Data    - the type of the items stored in our BST
+    Alloc   - the allocator creating and destroying our BSTNodes. NodePool,
+              the default, keeps nodes in contiguous blocks, while
+              HeapAllocator calls new and delete for every node
+    Compare - the strict weak ordering of our items, std::less by default. A
+              search orders a key against a node with one call of a
+              three-way compare when KeyCompare finds one
+    Node    - the type of node Alloc creates, BSTNode by default. A class
+              deriving from BSTNode may keep more about its subtree, and is
+              only ever handled through BSTNode pointers
 
 Data Fields:
-    root (BSTNode<Data>*) - the root of our BST
-    isize (unsigned int)  - the number of BSTNodes in our tree
+    root (BSTNode<Data>*)      - the root of our BST
+    isize (unsigned int)       - the number of BSTNodes in our tree
+    alloc (Alloc)              - the allocator owning our BSTNodes
+    comp (KeyCompare<Compare>) - the comparator ordering our items
+    leftmost (BSTNode<Data>*)  - the first node of our BST, or nullptr
+    rightmost (BSTNode<Data>*) - the last node of our BST, or nullptr
+    counters (BSTCounters)     - what our BST has done, only with BST_STATS
 
 Public functions:
-    BST     - constructor for BST
-    ~BST    - desctructor for BST
-    insert  - inserts an item into our BST
-    find    - finds a BSTNode in our BST
-    size    - gives the size of our BST
-    empty   - checks to see if BST is empty
-    begin   - creates iterator pointing to the first item in the BST
-    end     - creates iterator pointing past the last item in the BST
-    inorder - performs an inorder traversal of our BST
+    BST         - constructor for BST
+    ~BST        - desctructor for BST
+    insert      - inserts an item into our BST
+    clear       - removes every item from our BST
+    find        - finds a BSTNode in our BST
+    find_batch  - finds many keys at once, overlapping their cache misses
+    contains_batch - checks many keys at once
+    lower_bound - finds the first item not less than a key
+    upper_bound - finds the first item greater than a key
+    equal_range - finds the items equal to a key
+    floor       - finds the last item not greater than a key
+    ceiling     - finds the first item not less than a key
+    range       - gives a view of the items in a half open range
+    key_comp    - gives the comparator ordering our items
+    size        - gives the size of our BST
+    empty       - checks to see if BST is empty
+    begin       - creates iterator pointing to the first item in the BST
+    end         - creates iterator pointing past the last item in the BST
+    rbegin      - creates reverse iterator pointing to the last item
+    rend        - creates reverse iterator pointing before the first item
+    inorder     - performs an inorder traversal of our BST
+    rank        - counts the items less than a key
+    select      - finds the k-th smallest item
+    count_range - counts the items in a half open range
+    stats       - gives the counters of our BST
+    reset_stats - sets the counters of our BST back to zero
+    shape       - measures the height and depths of our BST
+
+    rank, select and count_range take O(log n) time on an RST and are only
+    available when BST_ORDER_STATISTICS is defined. stats and reset_stats
+    are only available when BST_STATS is defined, and without it nothing is
+    counted
 ******************************************************************************/
-template<typename Data>
+template<typename Data, template<typename> class Alloc = NodePool,
+         typename Compare = std::less<Data>, typename Node = BSTNode<Data> >
 class BST {
 
 protected:
@@ -47,10 +100,31 @@ protected:
   /** Number of Data items stored in this BST. */
   unsigned int isize;
 
+  /** Allocator which creates and destroys the BSTNodes of this BST. */
+  Alloc<Node> alloc;
+
+  /** The first and last nodes of this BST, so begin() and --end() take O(1)
+   *  time. Rotations never change them. */
+  BSTNode<Data>* leftmost;
+  BSTNode<Data>* rightmost;
+
+  /** Comparator ordering the items of this BST. */
+  KeyCompare<Compare> comp;
+
+  /** The node of the last insert while finger search is on, where the next
+   *  insert starts looking, or nullptr. Dropped whenever nodes may go. */
+  BSTNode<Data>* finger;
+  bool fingerSearch;
+
+  /** Rotations, descents and allocations of this BST. Comparisons are
+   *  counted by comp. */
+  BST_STAT(mutable BSTCounters counters;)
+
 public:
 
   /** define iterator as an aliased typename for BSTIterator<Data>. */
   typedef BSTIterator<Data> iterator;
+  typedef std::reverse_iterator<iterator> reverse_iterator;
 
 
   /****************************************************************************
@@ -58,165 +132,315 @@ public:
   Purpose:        This function initializes an empty BST
   Description:    This function initializes an empty BST by creating a null
                   root and setting isize to zero
+  Input:          comp: the comparator ordering our items
   Result:         An empty BST is created
   ****************************************************************************/
-  BST() : root(nullptr), isize(0) {  }
+  explicit BST(const Compare& comp = Compare())
+      : root(nullptr), isize(0), leftmost(nullptr), rightmost(nullptr),
+        comp(comp), finger(nullptr), fingerSearch(false) {  }
+
+  BST(const BST&) = delete;
+  BST& operator=(const BST&) = delete;
+
+
+  /****************************************************************************
+  Function Name:  BST
+  Purpose:        This function moves a BST
+  Description:    This function takes over the nodes and allocator of other,
+                  leaving other as an empty BST
+  Input:          other:  the BST we are taking the nodes of
+  Result:         A BST holding every item of other
+  ****************************************************************************/
+  BST(BST&& other) noexcept : root(other.root), isize(other.isize),
+                              leftmost(other.leftmost),
+                              rightmost(other.rightmost), comp(other.comp),
+                              finger(nullptr),
+                              fingerSearch(other.fingerSearch) {
+    alloc.swap(other.alloc);
+    other.root = other.leftmost = other.rightmost = other.finger = nullptr;
+    other.isize = 0;
+  }
+
+
+  /****************************************************************************
+  Function Name:  operator=
+  Purpose:        This function move assigns a BST
+  Description:    This function clears our BST and takes over the nodes and
+                  allocator of other
+  Input:          other:  the BST we are taking the nodes of
+  Result:         Returns this BST
+  ****************************************************************************/
+  BST& operator=(BST&& other) noexcept {
+    if (this != &other) {
+      clear();
+      alloc.swap(other.alloc);
+      root = other.root;
+      isize = other.isize;
+      leftmost = other.leftmost;
+      rightmost = other.rightmost;
+      comp = other.comp;
+      fingerSearch = other.fingerSearch;
+      other.root = other.leftmost = other.rightmost = other.finger = nullptr;
+      other.isize = 0;
+    }
+    return *this;
+  }
 
 
   /****************************************************************************
   Function Name:  ~BST
   Purpose:        This function deconstructs our BST
-  Description:    This function unitializes our BST by calling our deleteAll
-                  function starting at root, thus deleting every node in our
-                  BST
+  Description:    This function unitializes our BST by calling our clear
+                  function, thus deleting every node in our BST
   Result:         An empty BST
   ****************************************************************************/
   virtual ~BST() {
-    deleteAll(root);
+    clear();
   }
 
 
   /****************************************************************************
   Function Name:  insert
   Purpose:        This function inserts an item into our BST
-  Description:    This function creates a BSTNode which will contain the data
-                  from our parameter. It checks to see if a root exists. If it
-                  does, it then checks to see if it is inserted into the left
-                  subtree or the right subtree. If the BSTNode already exists,
-                  then item is not inserted. It then increases isize
+  Description:    This function calls insertNode, which searches for the
+                  position of item and only creates a BSTNode if item is not
+                  already in our BST
   Input:          item: the data of the BSTNode we are attempting to insert 
                   into our tree
   Result:         true if the insert was performed successfully
                   false if the insert was performed unsuccessfully
   ****************************************************************************/
   virtual bool insert(const Data& item) {
+    return insertNode(item) != nullptr;
+  }
 
-    /* Variable to indicate whether insertiong was successful or not */
-    bool inserted = false;
+  virtual bool insert(Data&& item) {
+    bool inserted;
+    emplaceNode(item, inserted, std::move(item));
+    return inserted;
+  }
 
-    BSTNode<Data>* current = root;
-    BSTNode<Data>* insertingNode = new BSTNode<Data> (item);
 
-    /* If statement is executed when current does not exist */
-    if (!current) {
-      root = insertingNode;
-      inserted = true;
-    }
+  /****************************************************************************
+  Function Name:  insert
+  Purpose:        This function inserts an item next to a hint
+  Description:    This function calls emplaceNear, which climbs from the node
+                  of hint only as far as it has to instead of walking down
+                  from root. A hint of end() starts from the last node, so
+                  appending sorted items takes O(1) comparisons each
+  Input:          hint: an iterator to an item close to item, or end()
+                  item: the data of the BSTNode we are attempting to insert
+  Result:         Returns an iterator to item, newly inserted or not
+  ****************************************************************************/
+  iterator insert(iterator hint, const Data& item) {
+    bool inserted;
+    return iterator(emplaceNear(hint.curr ? hint.curr : rightmost, item,
+                                inserted, item), &rightmost);
+  }
 
-    /* While loop is executed while current exists */
-    while (current) {
 
-      /* If statement is executed when data of current is less than item */
-      if (current -> data < item) {
+  /****************************************************************************
+  Function Name:  find
+  Purpose:        This function finds a BSTNode in our BST
+  Description:    This function calls findNode, which walks down from root
+                  ordering item against the data of each node with a single
+                  comparison where possible. With a transparent Compare, such
+                  as std::less<>, item may be any type Compare accepts, so a
+                  std::string key can be found with a std::string_view
+  Input:          item: the data of the BSTNode we are attempting to find
+  Result:         Returns an iterator pointing to the BSTNode, or pointing past
+                  the last node in the BST if not found
+  ****************************************************************************/
+  iterator find(const Data& item) const {
+    return iterator(findNode(item), &rightmost);
+  }
 
-        /* If statement is executed when current's right child doesn't exist */
-        if (!current -> right) {
+  template<typename Key, typename C = Compare,
+           typename = typename C::is_transparent>
+  iterator find(const Key& item) const {
+    return iterator(findNode(item), &rightmost);
+  }
 
-          /* We set insertingNode as current's right child and set our variable
-           * to true */
-          current -> right = insertingNode;
-          current -> right -> parent = current;
-          inserted = true;
-          break;
-        }
 
-        else
+  /****************************************************************************
+  Function Name:  find_batch
+  Purpose:        This function finds many keys at once
+  Description:    This function calls findNodes, which walks several descents
+                  in turns instead of one after the other, so the cache misses
+                  of different keys overlap. A batch sorted in increasing
+                  order is instead walked down together, visiting every node
+                  shared by the search paths only once
+  Input:          first:  iterator to the first key, a Data or any type a
+                          transparent Compare accepts
+                  last:   iterator past the last key
+                  out:    receives an iterator per key, in the order of the
+                          keys, pointing past the last node if not found
+  Result:         Returns out advanced past the last iterator written
+  ****************************************************************************/
+  template<typename KeyIterator, typename OutIterator>
+  OutIterator find_batch(KeyIterator first, KeyIterator last,
+                         OutIterator out) const {
+    std::vector<BSTNode<Data>*> found;
+    findNodes(first, last, found);
+    for (std::size_t i = 0; i < found.size(); ++i)
+      *out++ = iterator(found[i], &rightmost);
+    return out;
+  }
 
-          /* Recursion is used to traverse down the right subtree */
-          current = current -> right;
-      }
 
-      /* Else if statement is executed when data of current is greater than
-       * item */
-      else if (item < current -> data) {
+  /****************************************************************************
+  Function Name:  contains_batch
+  Purpose:        This function checks if many keys are in our BST
+  Description:    This function calls findNodes just like find_batch
+  Input:          first:  iterator to the first key
+                  last:   iterator past the last key
+                  out:    receives a bool per key, in the order of the keys
+  Result:         Returns out advanced past the last bool written
+  ****************************************************************************/
+  template<typename KeyIterator, typename OutIterator>
+  OutIterator contains_batch(KeyIterator first, KeyIterator last,
+                             OutIterator out) const {
+    std::vector<BSTNode<Data>*> found;
+    findNodes(first, last, found);
+    for (std::size_t i = 0; i < found.size(); ++i)
+      *out++ = found[i] != nullptr;
+    return out;
+  }
 
-        /* If statement is executed when current's left child doesn't exist */
-        if (!current -> left) {
 
-          /* We set insertingNode as current's left child and set our variable
-           * to true */
-          current -> left = insertingNode;
-          current -> left -> parent = current;
-          inserted = true;
-          break;
-        }
+  /****************************************************************************
+  Function Name:  lower_bound
+  Purpose:        This function finds the first item not less than a key
+  Description:    This function calls lowerNode, which walks down from root
+                  once taking a single comparison per level. Like find, it
+                  takes any key a transparent Compare accepts
+  Input:          key:  the item we are looking for, which need not be in our
+                        BST
+  Result:         Returns an iterator to the first item not less than key, or
+                  end() if every item is less than key
+  ****************************************************************************/
+  iterator lower_bound(const Data& key) const {
+    return iterator(lowerNode(key), &rightmost);
+  }
 
-        else
+  template<typename Key, typename C = Compare,
+           typename = typename C::is_transparent>
+  iterator lower_bound(const Key& key) const {
+    return iterator(lowerNode(key), &rightmost);
+  }
 
-          /* Recursion is used to traverse down the left subtree */
-          current = current -> left;
-      }
 
-      else
-        break;
-    }
+  /****************************************************************************
+  Function Name:  upper_bound
+  Purpose:        This function finds the first item greater than a key
+  Description:    This function calls upperNode, which works like lowerNode
+                  but only goes left when key is less than current
+  Input:          key:  the item we are looking for
+  Result:         Returns an iterator to the first item greater than key, or
+                  end() if no item is greater than key
+  ****************************************************************************/
+  iterator upper_bound(const Data& key) const {
+    return iterator(upperNode(key), &rightmost);
+  }
 
-    /* If statement is executed when insertion is successful */
-    if (inserted)
-      ++isize;
+  template<typename Key, typename C = Compare,
+           typename = typename C::is_transparent>
+  iterator upper_bound(const Key& key) const {
+    return iterator(upperNode(key), &rightmost);
+  }
 
-    else
 
-      /* We free the node created since it was not inserted into our BST */
-      delete insertingNode;
+  /****************************************************************************
+  Function Name:  equal_range
+  Purpose:        This function finds the items equal to a key
+  Description:    This function walks down like find while remembering the
+                  last node where it went left. Items are unique, so if key is
+                  found the range ends at its successor, and otherwise both
+                  ends are the first item greater than key
+  Input:          key:  the item we are looking for
+  Result:         Returns the pair lower_bound(key), upper_bound(key)
+  ****************************************************************************/
+  std::pair<iterator, iterator> equal_range(const Data& key) const {
+    return equalNodes(key);
+  }
 
-    return inserted;
+  template<typename Key, typename C = Compare,
+           typename = typename C::is_transparent>
+  std::pair<iterator, iterator> equal_range(const Key& key) const {
+    return equalNodes(key);
   }
 
 
   /****************************************************************************
-  Function Name:  find
-  Purpose:        This function finds a BSTNode in our BST
-  Description:    This function creates a temporary BSTNode for tracking our
-                  current location. It then comparies the value of item to the
-                  data of our current node. It then goes left or right whether
-                  the item is greater or less than the data of current.
-  Input:          item: the data of the BSTNode we are attempting to find
-  Result:         Returns an iterator pointing to the BSTNode, or pointing past
-                  the last node in the BST if not found
+  Function Name:  floor
+  Purpose:        This function finds the last item not greater than a key
+  Description:    This function calls floorNode, which mirrors lowerNode by
+                  remembering the last node where it went right
+  Input:          key:  the item we are looking for
+  Result:         Returns an iterator to the last item not greater than key,
+                  or end() if every item is greater than key
   ****************************************************************************/
-  iterator find(const Data& item) const {
-    BSTNode<Data>* current = root;
-
-    /* If statement is executed when current does not exist */
-    if (!current)
-      return end();
-
-    /* While loop is executed when current exists */
-    while (current) {
+  iterator floor(const Data& key) const {
+    return iterator(floorNode(key), &rightmost);
+  }
 
-      /* If statement is executed when item is less that the data of current */
-      if (item < current -> data) {
+  template<typename Key, typename C = Compare,
+           typename = typename C::is_transparent>
+  iterator floor(const Key& key) const {
+    return iterator(floorNode(key), &rightmost);
+  }
 
-        /* If statement is executed when current's left childs doesn't exist */
-        if (!current -> left)
-          return end();
 
-        else
+  /****************************************************************************
+  Function Name:  ceiling
+  Purpose:        This function finds the first item not less than a key
+  Description:    This function is another name for lower_bound, pairing up
+                  with floor
+  Input:          key:  the item we are looking for
+  Result:         Returns an iterator to the first item not less than key, or
+                  end() if every item is less than key
+  ****************************************************************************/
+  iterator ceiling(const Data& key) const {
+    return lower_bound(key);
+  }
 
-          /* Recursion is used to traverse down the left subtree */
-          current = current -> left;
-      }
+  template<typename Key, typename C = Compare,
+           typename = typename C::is_transparent>
+  iterator ceiling(const Key& key) const {
+    return lower_bound(key);
+  }
 
-      /* Else if statement is executed when the data of current is less than
-       * item */
-      else if (current -> data < item) {
 
-        /* If statement is executed when current's right child doesn't exist */
-        if (!current -> right)
-          return end();
+  /****************************************************************************
+  Function Name:  range
+  Purpose:        This function gives a view of the items in a half open range
+  Description:    This function finds both ends of the range with one
+                  lower_bound each, so the view walks the items between them
+                  by following pointers, without comparing any more keys.
+                  The view is invalidated like any other iterator
+  Input:          lo: the smallest item in the range
+                  hi: the item at which the range stops
+  Result:         Returns a view of the items x with lo <= x < hi, which is
+                  empty if hi is not greater than lo
+  ****************************************************************************/
+  BSTRange<Data> range(const Data& lo, const Data& hi) const {
+    iterator first = lower_bound(lo);
 
-        else
+    /* If statement is executed when the range is empty */
+    if (!comp.less(lo, hi))
+      return BSTRange<Data>(first, first);
 
-          /* Recursion is used to traverse down the right subtree */
-          current = current -> right;
+    return BSTRange<Data>(first, lower_bound(hi));
+  }
 
-      }
 
-      else
-        break;
-    }
-      return typename BST<Data>::iterator(current);
+  /****************************************************************************
+  Function Name:  key_comp
+  Purpose:        This function gives the comparator ordering our items
+  Result:         Returns a copy of our Compare
+  ****************************************************************************/
+  Compare key_comp() const {
+    return comp.get();
   }
 
 
@@ -224,11 +448,16 @@ public:
   Function Name:  size
   Purpose:        This function returns the number of items in our BST
   Description:    This function access our data field isize and return its
-                  value
+                  value. With BST_ORDER_STATISTICS the size of root is
+                  returned
   Result:         Returns the number of BSTNodes in our BST
   ****************************************************************************/
   unsigned int size() const {
+#ifdef BST_ORDER_STATISTICS
+    return BSTNode<Data>::sizeOf(root);
+#else
     return isize;
+#endif
   }
 
 
@@ -254,12 +483,12 @@ public:
   Function Name:  begin
   Purpose:        This function creates an iterator pointing to the first item
                   in the BST
-  Description:    This function calls upon our aliased iterator and our first
-                  function to find the first item in the BST
+  Description:    This function calls upon our aliased iterator with the
+                  first node we keep track of, so it takes O(1) time
   Result:         Returns an iterator pointing to the first item in the BST
   ****************************************************************************/
   iterator begin() const {
-    return typename BST<Data>::iterator(first(root));
+    return iterator(leftmost, &rightmost);
   }
 
 
@@ -270,7 +499,15 @@ public:
   Result:         Returns an iterator pointing past the last item in the BST
   ****************************************************************************/
   iterator end() const {
-    return typename BST<Data>::iterator(0);
+    return iterator(0, &rightmost);
+  }
+
+  reverse_iterator rbegin() const {
+    return reverse_iterator(end());
+  }
+
+  reverse_iterator rend() const {
+    return reverse_iterator(begin());
   }
 
 
@@ -285,6 +522,844 @@ public:
     inorder(root);
   }
 
+
+#ifdef BST_ORDER_STATISTICS
+  /****************************************************************************
+  Function Name:  rank
+  Purpose:        This function counts the items less than a key
+  Description:    This function walks down the search path of item. Every
+                  time it goes right, the node and its left subtree are less
+                  than item and their size is added to the count. This takes
+                  one comparison per level
+  Input:          item: the key we are ranking, which need not be in our BST
+  Result:         Returns the number of items in our BST less than item
+  ****************************************************************************/
+  unsigned int rank(const Data& item) const {
+    unsigned int less = 0;
+    BSTNode<Data>* current = root;
+
+    /* While loop is executed while current exists */
+    while (current) {
+
+      /* If statement is executed when current and its left subtree are less
+       * than item */
+      if (comp.less(current -> data, item)) {
+        less += BSTNode<Data>::sizeOf(current -> left) + 1;
+        current = current -> right;
+      }
+
+      else
+        current = current -> left;
+    }
+
+    return less;
+  }
+
+
+  /****************************************************************************
+  Function Name:  select
+  Purpose:        This function finds the k-th smallest item
+  Description:    This function walks down from root, comparing k with the
+                  size of the left subtree to decide which way to go. No items
+                  are compared
+  Input:          k:  the position of the item, starting from 0
+  Result:         Returns an iterator to the k-th smallest item, or end() if
+                  k is not less than size()
+  ****************************************************************************/
+  iterator select(unsigned int k) const {
+    BSTNode<Data>* current = root;
+
+    /* While loop is executed while current exists */
+    while (current) {
+      unsigned int leftSize = BSTNode<Data>::sizeOf(current -> left);
+
+      /* If statement is executed when the item is in the left subtree */
+      if (k < leftSize)
+        current = current -> left;
+
+      /* Else if statement is executed when the item is in the right subtree */
+      else if (k > leftSize) {
+        k -= leftSize + 1;
+        current = current -> right;
+      }
+
+      else
+        break;
+    }
+
+    return iterator(current, &rightmost);
+  }
+
+
+  /****************************************************************************
+  Function Name:  count_range
+  Purpose:        This function counts the items in a half open range
+  Input:          lo: the smallest item counted
+                  hi: the item at which counting stops
+  Result:         Returns the number of items x with lo <= x < hi
+  ****************************************************************************/
+  unsigned int count_range(const Data& lo, const Data& hi) const {
+
+    /* If statement is executed when the range is empty */
+    if (!comp.less(lo, hi))
+      return 0;
+
+    return rank(hi) - rank(lo);
+  }
+#endif
+
+
+#ifdef BST_STATS
+  /****************************************************************************
+  Function Name:  stats
+  Purpose:        This function gives a snapshot of the counters of our BST
+  Result:         Returns the counters since our BST was created or
+                  reset_stats was last called
+  ****************************************************************************/
+  BSTStats stats() const {
+    return counters.snapshot(comp.count());
+  }
+
+  void reset_stats() {
+    counters = BSTCounters();
+    comp.resetCount();
+  }
+#endif
+
+
+  /****************************************************************************
+  Function Name:  shape
+  Purpose:        This function measures the shape of our BST
+  Description:    This function visits every node, counting the nodes at each
+                  depth, so it takes O(n) time. It is meant for diagnosing a
+                  tree, not for hot paths, and is available in every build
+  Result:         Returns the height, depths and depth histogram of our BST
+  ****************************************************************************/
+  BSTShape shape() const {
+    BSTShape result;
+    double depths = 0;
+    std::vector< std::pair<BSTNode<Data>*, unsigned int> > stack;
+
+    /* If statement is executed when there are nodes to visit */
+    if (root)
+      stack.push_back(std::make_pair(root, 0u));
+
+    /* While loop is executed until every node has been visited */
+    while (!stack.empty()) {
+      BSTNode<Data>* n = stack.back().first;
+      unsigned int depth = stack.back().second;
+      stack.pop_back();
+
+      /* If statement is executed when n is the first node this deep */
+      if (depth >= result.histogram.size())
+        result.histogram.resize(depth + 1, 0);
+
+      ++result.histogram[depth];
+      ++result.size;
+      depths += depth;
+
+      if (n -> left)
+        stack.push_back(std::make_pair(n -> left, depth + 1));
+      if (n -> right)
+        stack.push_back(std::make_pair(n -> right, depth + 1));
+    }
+
+    result.height = result.histogram.size();
+    result.averageDepth = result.size ? depths / result.size : 0.0;
+    result.expectedDepth = result.size ? 2 * std::log(double(result.size)) : 0.0;
+    return result;
+  }
+
+
+  /****************************************************************************
+  Function Name:  clear
+  Purpose:        This function removes every item from our BST
+  Description:    This function only visits the nodes one by one when they
+                  need their destructors called or when the allocator cannot
+                  free them in bulk. Otherwise every block of the allocator is
+                  freed at once without walking the tree
+  Result:         An empty BST
+  ****************************************************************************/
+  void clear() {
+
+    /* If statement is executed when the nodes must be destroyed one by one,
+     * either because they need their destructors called or because another
+     * tree still uses the blocks of our allocator */
+    if (root && (!Alloc<Node>::bulkRelease ||
+                 !std::is_trivially_destructible<Node>::value ||
+                 !alloc.sole()))
+      deleteAll(root);
+
+#ifdef BST_STATS
+    /* Nodes released in bulk are never destroyed one by one */
+    else if (root)
+      counters.deallocations += size();
+#endif
+
+    alloc.release();
+    root = leftmost = rightmost = finger = nullptr;
+    isize = 0;
+  }
+
+
+  /****************************************************************************
+  Function Name:  finger_search
+  Purpose:        This function turns finger search on or off
+  Description:    While finger search is on, every insert starts from the
+                  node of the previous insert instead of from root, and climbs
+                  only as far as it has to. Appending sorted keys then takes
+                  O(1) comparisons each, and keys close to the previous one
+                  O(log d) where d is how many keys lie between them
+  Input:          enable: whether inserts should start from the finger
+  Result:         The next insert starts from root, and later ones from the
+                  finger if enable is true
+  ****************************************************************************/
+  void finger_search(bool enable) {
+    fingerSearch = enable;
+    finger = nullptr;
+  }
+
+protected:
+
+
+  /****************************************************************************
+  Function Name:  createNode
+  Purpose:        This function creates a node with our allocator
+  Input:          args: the arguments for the constructor of the BSTNode
+  Result:         Returns the new, unlinked BSTNode
+  ****************************************************************************/
+  template<typename... Args>
+  BSTNode<Data>* createNode(Args&&... args) {
+    BST_STAT(++counters.allocations;)
+    return alloc.create(std::forward<Args>(args)...);
+  }
+
+  void destroyNode(BSTNode<Data>* n) {
+    BST_STAT(++counters.deallocations;)
+    alloc.destroy(static_cast<Node*>(n));
+  }
+
+#ifdef BST_STATS
+  /** Records a walk down from the root which visited levels nodes */
+  void noteDescent(unsigned long long levels) const {
+    ++counters.descents;
+    counters.descentNodes += levels;
+    counters.deepestDescent.raise(levels);
+  }
+#endif
+
+
+  /****************************************************************************
+  Function Name:  insertNode
+  Purpose:        This function inserts an item into our BST as a leaf
+  Description:    This function calls emplaceNode with item as both the key
+                  and the data to copy
+  Input:          item: the data of the BSTNode we are attempting to insert
+  Result:         Returns the newly linked BSTNode
+                  Returns nullptr if item was already in our BST
+  ****************************************************************************/
+  BSTNode<Data>* insertNode(const Data& item) {
+    bool inserted;
+    BSTNode<Data>* n = emplaceNode(item, inserted, item);
+    return inserted ? n : nullptr;
+  }
+
+
+  /****************************************************************************
+  Function Name:  emplaceNode
+  Purpose:        This function finds or inserts the node of a key
+  Description:    This function traverses down from root to find where key
+                  belongs, or climbs from the last insertion point when finger
+                  search is on. A BSTNode is only constructed from args once
+                  we know key is not in our BST, so neither a lookup nor a
+                  duplicate ever builds any Data. The new node is linked in as
+                  a leaf and isize is increased
+  Input:          key:      the key we are looking for. It is ordered
+                            against the data of our nodes, so it may be a Data
+                            or any type Compare can order against Data
+                  inserted: set to true if a node was created
+                  args:     the arguments for the constructor of the BSTNode
+  Result:         Returns the newly linked BSTNode, or the node already
+                  holding key
+  ****************************************************************************/
+  template<typename Key, typename... Args>
+  BSTNode<Data>* emplaceNode(const Key& key, bool& inserted, Args&&... args) {
+    return emplaceNear(fingerSearch ? finger : nullptr, key, inserted,
+                       std::forward<Args>(args)...);
+  }
+
+
+  /****************************************************************************
+  Function Name:  emplaceNear
+  Purpose:        This function finds or inserts the node of a key, starting
+                  from a node close to it
+  Description:    This function orders key against near and then climbs from
+                  near towards root. Climbing over a right child needs no
+                  comparison, since the parent is smaller than everything
+                  below it, so only the ancestors bounding the subtree we came
+                  from are compared. Once one of them bounds key, key belongs
+                  below the node we came from and we walk down from there.
+                  A key d positions away from near is thus found after about
+                  2 log d comparisons, and a key after the last node is linked
+                  in after two
+  Input:          near:     the node we start from, or nullptr to start from
+                            root
+                  key:      the key we are looking for
+                  inserted: set to true if a node was created
+                  args:     the arguments for the constructor of the BSTNode
+  Result:         Returns the newly linked BSTNode, or the node already
+                  holding key. It becomes the finger when finger search is on
+  ****************************************************************************/
+  template<typename Key, typename... Args>
+  BSTNode<Data>* emplaceNear(BSTNode<Data>* near, const Key& key,
+                             bool& inserted, Args&&... args) {
+    BSTNode<Data>* start = root;
+
+    /* If statement is executed when we have a node to start from */
+    if (near) {
+      int order = comp.order(key, near -> data);
+      start = near;
+
+      /* While loop is executed while key lies beyond the subtree of start */
+      while (order) {
+        BSTNode<Data>* bound = start;
+
+        /* If statement is executed when key is greater than start, so the
+         * first ancestor we are a left descendant of bounds us from above */
+        if (order > 0)
+          while (bound -> parent && bound -> parent -> right == bound)
+            bound = bound -> parent;
+
+        else
+          while (bound -> parent && bound -> parent -> left == bound)
+            bound = bound -> parent;
+
+        bound = bound -> parent;
+
+        /* If statement is executed when nothing bounds start on that side,
+         * so key belongs below start */
+        if (!bound)
+          break;
+
+        int boundOrder = comp.order(key, bound -> data);
+
+        /* If statement is executed when key is the bound itself */
+        if (!boundOrder) {
+          inserted = false;
+          return fingerSearch ? finger = bound : bound;
+        }
+
+        /* If statement is executed when key lies between start and the
+         * bound, so it belongs below start */
+        if ((boundOrder > 0) != (order > 0))
+          break;
+
+        start = bound;
+      }
+    }
+
+    BSTNode<Data>* found = emplaceBelow(start, key, inserted,
+                                        std::forward<Args>(args)...);
+    if (fingerSearch)
+      finger = found;
+
+    return found;
+  }
+
+
+  /****************************************************************************
+  Function Name:  emplaceBelow
+  Purpose:        This function finds or inserts the node of a key below a
+                  node whose subtree spans key
+  Description:    This function traverses down from current to find where key
+                  belongs and links a new leaf there, keeping isize, the ends
+                  and the subtree sizes up to date
+  Input:          current:  the node we walk down from, nullptr only when our
+                            BST is empty
+                  key:      the key we are looking for
+                  inserted: set to true if a node was created
+                  args:     the arguments for the constructor of the BSTNode
+  Result:         Returns the newly linked BSTNode, or the node already
+                  holding key
+  ****************************************************************************/
+  template<typename Key, typename... Args>
+  BSTNode<Data>* emplaceBelow(BSTNode<Data>* current, const Key& key,
+                              bool& inserted, Args&&... args) {
+    BSTNode<Data>* insertingNode;
+    inserted = false;
+
+    /* If statement is executed when current does not exist */
+    if (!current) {
+      insertingNode = root = leftmost = rightmost =
+        createNode(std::forward<Args>(args)...);
+      isize = 1;
+      inserted = true;
+      return insertingNode;
+    }
+
+    BST_STAT(unsigned long long levels = 0;)
+
+    /* While loop is executed until key is found or a leaf is reached */
+    while (true) {
+      int order = comp.order(key, current -> data);
+      BST_STAT(++levels;)
+
+      /* If statement is executed when data of current is less than key */
+      if (order > 0) {
+
+        /* If statement is executed when current's right child doesn't exist */
+        if (!current -> right) {
+          insertingNode = current -> right =
+            createNode(std::forward<Args>(args)...);
+          break;
+        }
+
+        /* We traverse down the right subtree */
+        current = current -> right;
+      }
+
+      /* Else if statement is executed when data of current is greater than
+       * key */
+      else if (order < 0) {
+
+        /* If statement is executed when current's left child doesn't exist */
+        if (!current -> left) {
+          insertingNode = current -> left =
+            createNode(std::forward<Args>(args)...);
+          break;
+        }
+
+        /* We traverse down the left subtree */
+        current = current -> left;
+      }
+
+      else {
+        BST_STAT(noteDescent(levels);)
+        return current;
+      }
+    }
+
+    BST_STAT(noteDescent(levels);)
+    inserted = true;
+    insertingNode -> parent = current;
+    ++isize;
+
+    /* If statement is executed when the new leaf comes before or after every
+     * other node */
+    if (current == leftmost && current -> left == insertingNode)
+      leftmost = insertingNode;
+
+    else if (current == rightmost && current -> right == insertingNode)
+      rightmost = insertingNode;
+
+#ifdef BST_ORDER_STATISTICS
+    /* Every ancestor of the new leaf gained one node */
+    for (; current; current = current -> parent)
+      ++current -> subtreeSize;
+#endif
+
+    return insertingNode;
+  }
+
+
+  /****************************************************************************
+  Function Name:  findNode
+  Purpose:        This function finds the node holding a key
+  Description:    This function orders key against the data of our current
+                  node and goes left or right whether key is less or greater
+                  than it, until key is found or we fall off a leaf
+  Input:          key:  the key we are looking for, a Data or any type
+                        Compare can order against Data
+  Result:         Returns the BSTNode holding key, or nullptr if not found
+  ****************************************************************************/
+  template<typename Key>
+  BSTNode<Data>* findNode(const Key& key) const {
+    BSTNode<Data>* current = root;
+    BST_STAT(unsigned long long levels = 0;)
+
+    /* While loop is executed when current exists */
+    while (current) {
+      int order = comp.order(key, current -> data);
+      BST_STAT(++levels;)
+
+      /* If statement is executed when key is less that the data of current */
+      if (order < 0)
+
+        /* We traverse down the left subtree */
+        current = current -> left;
+
+      /* Else if statement is executed when the data of current is less than
+       * key */
+      else if (order > 0)
+
+        /* We traverse down the right subtree */
+        current = current -> right;
+
+      else
+        break;
+    }
+
+    BST_STAT(noteDescent(levels);)
+    return current;
+  }
+
+
+  /** The number of descents findNodes walks in turns */
+  static const std::size_t BATCH_WIDTH = 16;
+
+
+  /****************************************************************************
+  Function Name:  findNodes
+  Purpose:        This function finds the nodes of many keys
+  Description:    This function first checks whether the keys increase,
+                  stopping at the first pair which does not, so an unsorted
+                  batch costs a comparison or two. Sorted batches are found
+                  by findSorted. Otherwise the keys are taken BATCH_WIDTH at a
+                  time and their descents advance one level each in turns.
+                  The child a descent moves to is prefetched, and by the time
+                  the other descents have had their turn it has arrived
+  Input:          first:  iterator to the first key
+                  last:   iterator past the last key
+                  found:  receives the node of every key, or nullptr
+  Result:         found holds a node per key, in the order of the keys
+  ****************************************************************************/
+  template<typename KeyIterator>
+  void findNodes(KeyIterator first, KeyIterator last,
+                 std::vector<BSTNode<Data>*>& found) const {
+    typedef typename std::iterator_traits<KeyIterator>::value_type Key;
+    std::vector<const Key*> keys;
+    for (; first != last; ++first)
+      keys.push_back(&*first);
+
+    found.assign(keys.size(), nullptr);
+    bool sorted = true;
+
+    for (std::size_t i = 1; i < keys.size() && sorted; ++i)
+      sorted = !comp.less(*keys[i], *keys[i - 1]);
+
+    /* If statement is executed when the search paths of neighbouring keys
+     * can be shared */
+    if (sorted) {
+      findSorted(root, keys, 0, keys.size(), 0, found);
+      return;
+    }
+
+    for (std::size_t start = 0; start < keys.size(); start += BATCH_WIDTH) {
+      std::size_t left = keys.size() - start;
+      std::size_t width = left < BATCH_WIDTH ? left : BATCH_WIDTH;
+      BSTNode<Data>* current[BATCH_WIDTH];
+      BST_STAT(unsigned long long levels[BATCH_WIDTH] = {};)
+      std::size_t active = width;
+
+      for (std::size_t j = 0; j < width; ++j)
+        current[j] = root;
+
+      /* While loop is executed while some descent has not ended */
+      while (active) {
+        for (std::size_t j = 0; j < width; ++j) {
+          BSTNode<Data>* n = current[j];
+
+          /* If statement is executed when this descent has ended */
+          if (!n)
+            continue;
+
+          int order = comp.order(*keys[start + j], n -> data);
+          BST_STAT(++levels[j];)
+          BSTNode<Data>* next = order < 0 ? n -> left : n -> right;
+
+          /* If statement is executed when the key was found */
+          if (!order) {
+            found[start + j] = n;
+            next = nullptr;
+          }
+
+          /* If statement is executed when the descent has ended */
+          if (!next) {
+            BST_STAT(noteDescent(levels[j]);)
+            --active;
+          }
+
+          else
+            prefetch(next);
+
+          current[j] = next;
+        }
+      }
+    }
+  }
+
+
+  /****************************************************************************
+  Function Name:  findSorted
+  Purpose:        This function finds a sorted run of keys below a node
+  Description:    This function splits the keys around the item of t with a
+                  binary search, so t is compared with about log k of the k
+                  keys instead of with all of them. Keys equal to the item
+                  found t, and the keys on either side continue into the
+                  matching subtree, whose roots are prefetched first. A
+                  single key simply walks down like findNode
+  Input:          t:      the node the keys have reached
+                  keys:   the keys of the batch, in increasing order
+                  lo:     the first key of the run
+                  hi:     one past the last key of the run
+                  depth:  the number of nodes above t
+                  found:  receives the node of every key, or nullptr
+  Result:         found holds the node of every key of the run
+  ****************************************************************************/
+  template<typename Key>
+  void findSorted(BSTNode<Data>* t, const std::vector<const Key*>& keys,
+                  std::size_t lo, std::size_t hi, unsigned long long depth,
+                  std::vector<BSTNode<Data>*>& found) const {
+
+    /* If statement is executed when a single key is left */
+    if (hi - lo == 1) {
+      BST_STAT(unsigned long long levels = depth;)
+
+      /* While loop is executed until the key is found or we fall off */
+      while (t) {
+        int order = comp.order(*keys[lo], t -> data);
+        BST_STAT(++levels;)
+
+        if (!order)
+          break;
+
+        t = order < 0 ? t -> left : t -> right;
+      }
+
+      BST_STAT(noteDescent(levels);)
+      found[lo] = t;
+      return;
+    }
+
+    /* If statement is executed when the run is empty or fell off a leaf */
+    if (lo == hi || !t) {
+      BST_STAT(for (std::size_t i = lo; i < hi; ++i) noteDescent(depth);)
+      return;
+    }
+
+    prefetch(t -> left);
+    prefetch(t -> right);
+
+    std::size_t below = lo;
+    std::size_t above = hi;
+
+    /* While loop is executed while the first key not below t is unknown */
+    while (below < above) {
+      std::size_t mid = below + (above - below) / 2;
+      if (comp.less(*keys[mid], t -> data))
+        below = mid + 1;
+      else
+        above = mid;
+    }
+
+    std::size_t equal = below;
+
+    /* While loop is executed while keys equal the item of t */
+    while (equal < hi && !comp.less(t -> data, *keys[equal])) {
+      BST_STAT(noteDescent(depth + 1);)
+      found[equal++] = t;
+    }
+
+    findSorted(t -> left, keys, lo, below, depth + 1, found);
+    findSorted(t -> right, keys, equal, hi, depth + 1, found);
+  }
+
+  /** Asks for the cache line of n to be loaded, if n exists */
+  static void prefetch(const BSTNode<Data>* n) {
+#if defined(__GNUC__)
+    __builtin_prefetch(n);
+#else
+    (void) n;
+#endif
+  }
+
+
+  /****************************************************************************
+  Function Name:  lowerNode
+  Purpose:        This function finds the first node not less than a key
+  Description:    This function walks down from root once, remembering the
+                  last node where it went left. Every level takes a single
+                  comparison
+  Input:          key:  the key we are looking for
+  Result:         Returns the first node not less than key, or nullptr
+  ****************************************************************************/
+  template<typename Key>
+  BSTNode<Data>* lowerNode(const Key& key) const {
+    BSTNode<Data>* current = root;
+    BSTNode<Data>* found = nullptr;
+
+    /* While loop is executed while current exists */
+    while (current) {
+
+      /* If statement is executed when current may be the answer, which can
+       * only be improved in its left subtree */
+      if (!comp.less(current -> data, key)) {
+        found = current;
+        current = current -> left;
+      }
+
+      else
+        current = current -> right;
+    }
+
+    return found;
+  }
+
+
+  /****************************************************************************
+  Function Name:  upperNode
+  Purpose:        This function finds the first node greater than a key
+  Input:          key:  the key we are looking for
+  Result:         Returns the first node greater than key, or nullptr
+  ****************************************************************************/
+  template<typename Key>
+  BSTNode<Data>* upperNode(const Key& key) const {
+    BSTNode<Data>* current = root;
+    BSTNode<Data>* found = nullptr;
+
+    /* While loop is executed while current exists */
+    while (current) {
+
+      /* If statement is executed when current is greater than key */
+      if (comp.less(key, current -> data)) {
+        found = current;
+        current = current -> left;
+      }
+
+      else
+        current = current -> right;
+    }
+
+    return found;
+  }
+
+
+  /****************************************************************************
+  Function Name:  floorNode
+  Purpose:        This function finds the last node not greater than a key
+  Input:          key:  the key we are looking for
+  Result:         Returns the last node not greater than key, or nullptr
+  ****************************************************************************/
+  template<typename Key>
+  BSTNode<Data>* floorNode(const Key& key) const {
+    BSTNode<Data>* current = root;
+    BSTNode<Data>* found = nullptr;
+
+    /* While loop is executed while current exists */
+    while (current) {
+
+      /* If statement is executed when current is greater than key */
+      if (comp.less(key, current -> data))
+        current = current -> left;
+
+      else {
+        found = current;
+        current = current -> right;
+      }
+    }
+
+    return found;
+  }
+
+
+  /****************************************************************************
+  Function Name:  equalNodes
+  Purpose:        This function finds the range of nodes equal to a key
+  Input:          key:  the key we are looking for
+  Result:         Returns iterators to the node of key and its successor, or
+                  twice the first node greater than key if key is missing
+  ****************************************************************************/
+  template<typename Key>
+  std::pair<iterator, iterator> equalNodes(const Key& key) const {
+    BSTNode<Data>* current = root;
+    BSTNode<Data>* greater = nullptr;
+
+    /* While loop is executed while current exists */
+    while (current) {
+      int order = comp.order(key, current -> data);
+
+      /* If statement is executed when current is less than key */
+      if (order > 0)
+        current = current -> right;
+
+      /* Else if statement is executed when current is greater than key */
+      else if (order < 0) {
+        greater = current;
+        current = current -> left;
+      }
+
+      else
+        return std::make_pair(iterator(current, &rightmost),
+                              iterator(current -> successor(), &rightmost));
+    }
+
+    return std::make_pair(iterator(greater, &rightmost),
+                          iterator(greater, &rightmost));
+  }
+
+
+  /****************************************************************************
+  Function Name:  deleteAll
+  Purpose:        This function deletes nodes in our BST
+  Description:    This function performs a postorder traversal, deleting nodes
+                  in our BST. It first checks to see if n exists. It then
+                  checks to see if left child of n exists, followed by checking
+                  to see if right child of n exists. It then deletes n
+  Input:          n:  then current node we are on
+  Result:         Deletes all of the the nodes in a BST starting from a
+                  specific node and returns how many were deleted
+  ****************************************************************************/
+  unsigned int deleteAll(BSTNode<Data>* n) {
+    unsigned int deleted = 0;
+
+    /* If statement is executed when n exists */
+    if (n) {
+
+      /* If statement is executed when n's left child exists */
+      if (n -> left)
+
+        /* Recursion is used to go down the left subtree */
+        deleted += deleteAll(n -> left);
+
+      /* If statement is executed when n's right child exists */
+      if (n -> right)
+
+        /* Recursion is used to go down the right subtree */
+        deleted += deleteAll(n -> right);
+
+      destroyNode(n);
+      ++deleted;
+    }
+    return deleted;
+  }
+
+
+  /****************************************************************************
+  Function Name:  nodeOf
+  Purpose:        This function finds the node an iterator points to
+  Input:          it: the iterator we are looking into
+  Result:         Returns the BSTNode of it, or nullptr for end()
+  ****************************************************************************/
+  static BSTNode<Data>* nodeOf(const iterator& it) {
+    return it.curr;
+  }
+
+
+  /****************************************************************************
+  Function Name:  findEnds
+  Purpose:        This function finds the first and last nodes again
+  Description:    This function walks both spines from root. Operations which
+                  replace root wholesale, such as RST::split, call it instead
+                  of tracking the ends themselves, so it also drops the finger
+  Result:         leftmost and rightmost are the ends of our BST
+  ****************************************************************************/
+  void findEnds() {
+    leftmost = first(root);
+    rightmost = last(root);
+    finger = nullptr;
+  }
+
+
 private:
 
 
@@ -349,36 +1424,26 @@ private:
 
 
   /****************************************************************************
-  Function Name:  deleteAll
-  Purpose:        This function deletes nodes in our BST
-  Description:    This function performs a postorder traversal, deleting nodes
-                  in our BST. It first checks to see if n exists. It then
-                  checks to see if left child of n exists, followed by checking
-                  to see if right child of n exists. It then deletes n
-  Input:          n:  then current node we are on
-  Result:         Deletes all of the the nodes in a BST starting from a
-                  specific node
+  Function Name:  last
+  Purpose:        This function finds the last element of the BST
+  Input:          root: the root of our BST
+  Result:         Returns 0 if root does not exist
+                  Returns the last element of the BST
   ****************************************************************************/
-  static void deleteAll(BSTNode<Data>* n) {
-
-    /* If statement is executed when n exists */
-    if (n) {
+  static BSTNode<Data>* last(BSTNode<Data>* root) {
 
-      /* If statement is executed when n's left child exists */
-      if (n -> left)
+    /* If statement is executed when root doesn't exist */
+    if(!root)
+      return 0;
 
-        /* Recursion is used to go down the left subtree */
-        deleteAll(n -> left);
+    /* While loop is executed when root's right child exists */
+    while(root -> right)
+      root = root -> right;
 
-      /* If statement is executed when n's right child exists */
-      if (n -> right)
+    return root;
+  }
 
-        /* Recursion is used to go down the right subtree */
-        deleteAll(n -> right);
 
-      delete n;
-    }
-  }
 };
 
 
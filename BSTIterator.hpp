@@ -2,7 +2,9 @@
 
 File Name:    BSTIterator.hpp
 Description:  This program creates a class called BSTIterator, creating an
-              iterator which will go through the elements in our BST
+              iterator which will go through the elements in our BST, and
+              a class called BSTRange, a view of the elements between two
+              such iterators
 
 ******************************************************************************/
 
@@ -10,6 +12,7 @@ Description:  This program creates a class called BSTIterator, creating an
 #ifndef BSTITERATOR_HPP
 #define BSTITERATOR_HPP
 #include "BSTNode.hpp"
+#include <cstddef>
 #include <list>
 #include <iterator>
 
@@ -18,27 +21,50 @@ Description:  This program creates a class called BSTIterator, creating an
 class BSTIterator
 
 Description: Creates a BSTIterator which will allow us to go through the
-    elements in our BST
+    elements in our BST in either direction. Stepping follows parent and
+    child pointers only, so it never compares items. Stepping back from
+    end() needs the last node of the tree, which the BST caches and lets us
+    look at through last.
+
+    last points into the BST object itself, so moving, swapping, splitting
+    or merging a BST invalidates every iterator taken from it: an iterator
+    may still be dereferenced while its node lives, but stepping back from
+    end() would read the old object. Take new iterators from the BST that
+    holds the nodes afterwards
 
 Data Fields:
-    curr (BSTNode<Data>*) - the current BSTNode we are working with
+    curr (BSTNode<Data>*)         - the current BSTNode we are working with
+    last (BSTNode<Data>* const*)  - the last node cached by our BST
 
 Public functions:
     BSTIterator - constructor for our BSTIterator class
     operator*   - overloaded operator using the * symbol
+    operator->  - overloaded operator using the -> symbol
     operator++  - overloaded operator using the ++ symbol
+    operator--  - overloaded operator using the -- symbol
     operator==  - overloaded operator using the == symbol
     operator!=  - overloaded operator using the != symbol
 ******************************************************************************/
 template<typename Data>
-class BSTIterator : public std::iterator<std::input_iterator_tag,Data> {
+class BSTIterator {
 
 private:
 
   BSTNode<Data>* curr;
+  BSTNode<Data>* const* last;
+
+  /** Our trees may look at the node of an iterator, e.g. to erase it */
+  template<typename, template<typename> class, typename, typename>
+  friend class BST;
 
 public:
 
+  typedef std::bidirectional_iterator_tag iterator_category;
+  typedef Data value_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef const Data* pointer;
+  typedef const Data& reference;
+
 
   /****************************************************************************
   Function Name:  BSTIterator
@@ -46,11 +72,15 @@ public:
   Description:    This function takes in a BSTNode as a parameter and
                   initializes the current BSTNode in the BSTIterator
   Input:          curr: the current BSTNode we are working on
+                  last: where our BST keeps its last node, needed to step
+                        back from end()
   Result:         We set the current node's curr to equal the curr in our
                   parameter
   ****************************************************************************/
-  BSTIterator(BSTNode<Data>* curr) {
+  BSTIterator(BSTNode<Data>* curr = nullptr,
+              BSTNode<Data>* const* last = nullptr) {
     this -> curr = curr;
+    this -> last = last;
   }
 
 
@@ -62,10 +92,14 @@ public:
                   dereferencing the node in the iterator
   Result:         Returns the data in curr
   ****************************************************************************/
-  Data operator*() const {
+  const Data& operator*() const {
     return curr -> data;
   }
 
+  const Data* operator->() const {
+    return &curr -> data;
+  }
+
 
   /****************************************************************************
   Function Name:  operator++
@@ -89,12 +123,38 @@ public:
   Result:         Returns our iterator before we increment
   ****************************************************************************/
   BSTIterator<Data> operator++(int) {
-    BSTIterator before = BSTIterator(curr);
+    BSTIterator before = *this;
     ++(*this);
     return before;
   }
 
 
+  /****************************************************************************
+  Function Name:  operator--
+  Purpose:        This function pre-decrements our current node
+  Description:    This function calls our predecessor method in BSTNode.hpp,
+                  or moves end() to the last node cached by our BST
+  Result:         Returns our iterator after we decrement
+  ****************************************************************************/
+  BSTIterator<Data>& operator--() {
+    curr = curr ? curr -> predecessor() : *last;
+    return *this;
+  }
+
+
+  /****************************************************************************
+  Function Name:  operator--
+  Purpose:        This function post-decrements our current node
+  Input:          an integer value
+  Result:         Returns our iterator before we decrement
+  ****************************************************************************/
+  BSTIterator<Data> operator--(int) {
+    BSTIterator before = *this;
+    --(*this);
+    return before;
+  }
+
+
   /****************************************************************************
   Function Name:  operator==
   Purpose:        This function overloads our == operator
@@ -121,4 +181,48 @@ public:
   }
 };
 
+
+/******************************************************************************
+class BSTRange
+
+Description: Creates a BSTRange, a view of the items between two iterators of
+    a BST, so a range of items can be used in a range based for loop. The
+    view holds no items of its own
+
+Data Fields:
+    first (BSTIterator<Data>) - the first item in the view
+    last (BSTIterator<Data>)  - the item after the last item in the view
+
+Public functions:
+    BSTRange - constructor for our BSTRange class
+    begin    - gives the first item in the view
+    end      - gives the item after the last item in the view
+    empty    - checks to see if the view is empty
+******************************************************************************/
+template<typename Data>
+class BSTRange {
+
+  BSTIterator<Data> first;
+  BSTIterator<Data> last;
+
+public:
+
+  typedef BSTIterator<Data> iterator;
+
+  BSTRange(BSTIterator<Data> first, BSTIterator<Data> last)
+      : first(first), last(last) {  }
+
+  iterator begin() const {
+    return first;
+  }
+
+  iterator end() const {
+    return last;
+  }
+
+  bool empty() const {
+    return first == last;
+  }
+};
+
 #endif //BSTITERATOR_HPP
@@ -9,8 +9,10 @@ Description:  This program creates a class called BSTNode, creating a node
 
 #ifndef BSTNODE_HPP
 #define BSTNODE_HPP
+#include <cstdint>
 #include <iostream>
 #include <iomanip>
+#include <utility>
 
 
 /******************************************************************************
@@ -20,16 +22,25 @@ Description: Creates a BSTNode, or binary search tree node, which will allow
     us to find a node's successor, if one exists, and print out the data of
     a specific node
 
+    When BST_ORDER_STATISTICS is defined before including our headers, every
+    node also counts the nodes of its subtree, which lets BST answer rank and
+    select queries in O(log n). Without it the field and all the work keeping
+    it up to date are compiled out
+
 Data Fields:
     left (BSTNode<Data>*)     - the left child of a node
     right (BSTNode<Data>*)    - the right child of a node
     parent (BSTNode<Data>*)   - the parent of a node
-    priority (int)            - the priority of a node for an RST 
-    data (Data const)         - the data contained within the node
+    priority (uint64_t)       - the priority of a node for an RST
+    data (Data)               - the data contained within the node
+    subtreeSize (unsigned)    - the number of nodes in the subtree of a node,
+                                only with BST_ORDER_STATISTICS
 
 Public functions:
-    BSTNode   - constructor for our BSTNode class
-    successor - finds the successor of a BSTNode, if one exists
+    BSTNode     - constructor for our BSTNode class
+    successor   - finds the successor of a BSTNode, if one exists
+    predecessor - finds the predecessor of a BSTNode, if one exists
+    updateSize  - recomputes subtreeSize from the children of a node
 ******************************************************************************/
 template<typename Data>
 class BSTNode {
@@ -41,20 +52,77 @@ public:
   Function Name:  BST
   Purpose:        This function initializes a node
   Description:    This function initializes a node by setting the data of our
-                  node to our given parameter and setting the left, right, and
-                  parent nodes to nullptr
+                  node to our given parameter, setting the left, right, and
+                  parent nodes to nullptr and the priority to 0
   Input:          d:  the data value of our created BSTNode
   Result:         A BSTNode with no left, right, or parent node is created
   ****************************************************************************/
-  BSTNode(const Data & d) : data(d) {
+  BSTNode(const Data & d) : priority(0), data(d) {
+    left = right = parent = nullptr;
+#ifdef BST_ORDER_STATISTICS
+    subtreeSize = 1;
+#endif
+  }
+
+  BSTNode(Data && d) : priority(0), data(std::move(d)) {
+    left = right = parent = nullptr;
+#ifdef BST_ORDER_STATISTICS
+    subtreeSize = 1;
+#endif
+  }
+
+
+  /****************************************************************************
+  Function Name:  BSTNode
+  Purpose:        This function initializes a node holding new data
+  Description:    This function constructs our data in place from args, so
+                  the data is never copied or moved into the node
+  Input:          args: the arguments passed on to the constructor of Data
+  Result:         A BSTNode with no left, right, or parent node is created
+  ****************************************************************************/
+  template<typename... Args>
+  BSTNode(std::in_place_t, Args&&... args)
+      : priority(0), data(std::forward<Args>(args)...) {
     left = right = parent = nullptr;
+#ifdef BST_ORDER_STATISTICS
+    subtreeSize = 1;
+#endif
   }
 
   BSTNode<Data>* left;
   BSTNode<Data>* right;
   BSTNode<Data>* parent;
-  int priority;
-  Data const data;   // the const Data in this node.
+  std::uint64_t priority;
+  Data data;   // the Data in this node, only handed out as const by BST.
+#ifdef BST_ORDER_STATISTICS
+  unsigned int subtreeSize;   // the number of nodes in this subtree.
+
+
+  /****************************************************************************
+  Function Name:  sizeOf
+  Purpose:        This function gives the size of a possibly empty subtree
+  Input:          n:  the root of the subtree, or nullptr
+  Result:         Returns the number of nodes in the subtree of n
+  ****************************************************************************/
+  static unsigned int sizeOf(const BSTNode<Data>* n) {
+    return n ? n -> subtreeSize : 0;
+  }
+#endif
+
+
+  /****************************************************************************
+  Function Name:  updateSize
+  Purpose:        This function recomputes the size of our subtree
+  Description:    This function adds up the sizes of our children, which must
+                  already be correct. It does nothing unless
+                  BST_ORDER_STATISTICS is defined
+  Result:         subtreeSize counts this node and its subtrees
+  ****************************************************************************/
+  void updateSize() {
+#ifdef BST_ORDER_STATISTICS
+    subtreeSize = 1 + sizeOf(left) + sizeOf(right);
+#endif
+  }
 
 
   /****************************************************************************
@@ -64,9 +132,9 @@ public:
                   current node exists. If so, then it goes to that node and
                   keeps traversing down the left subtree until we find the last
                   node, thus finding its successor. If no right child exists,
-                  we check to see if a parent exists we keep traversing up the
-                  tree until we find a node greater than our original node,
-                  thus finding its successor
+                  we climb while we are the right child of our parent. The
+                  first ancestor we reach from its left subtree is the
+                  successor. Only pointers are compared, never data
   Result:         Returns the successor of a BSTNode
                   Returns nullptr of no successor exists for a BSTNode
   ****************************************************************************/
@@ -86,25 +154,47 @@ public:
       return current;
     }
 
-    /* Else if statement is executed when parent exists */
-    else if (parent) {
-      BSTNode<Data>* currentParent = parent;
+    /* While loop is executed while current is the right child of its
+     * parent, meaning the parent comes before current */
+    while (current -> parent && current -> parent -> right == current)
+      current = current -> parent;
+
+    return current -> parent;
+  }
+
 
-      /* While loop is executed when the data of currentParent is less than
-       * the data of current */
-      while (currentParent -> data < current -> data) {
+  /****************************************************************************
+  Function Name:  predecessor
+  Purpose:        This function finds the predecessor of a BSTNode, if one
+                  exists
+  Description:    This function mirrors successor: it takes the last node of
+                  the left subtree, or else climbs while we are the left child
+                  of our parent
+  Result:         Returns the predecessor of a BSTNode
+                  Returns nullptr if no predecessor exists for a BSTNode
+  ****************************************************************************/
+  BSTNode<Data>* predecessor() {
+    BSTNode<Data>* current = this;
+
+    /* If statement is executed when left child exists */
+    if (left) {
+      current = current -> left;
 
-        /* If statement is executed when the parent of currentParent does not
-         * exist */
-        if (!currentParent -> parent)
-          return nullptr;
+      /* While loop is executed when current's right child exists */
+      while (current -> right)
 
-        /* We traverse up the tree */
-        currentParent = currentParent -> parent;
-      }
-      return currentParent;
+        /* We traverse down the right subtree */
+        current = current -> right;
+
+      return current;
     }
-    return nullptr;
+
+    /* While loop is executed while current is the left child of its parent,
+     * meaning the parent comes after current */
+    while (current -> parent && current -> parent -> left == current)
+      current = current -> parent;
+
+    return current -> parent;
   }
 }; 
 
@@ -0,0 +1,240 @@
+/******************************************************************************
+
+File Name:    BSTStats.hpp
+Description:  This program creates the instrumentation of our trees: the
+              counters kept on the hot paths when BST_STATS is defined, and
+              a summary of the shape of a tree which can be written as JSON
+
+******************************************************************************/
+
+
+#ifndef BSTSTATS_HPP
+#define BSTSTATS_HPP
+#include <atomic>
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+/** Expands to its argument only when BST_STATS is defined, so counting on
+ *  the hot paths compiles to nothing otherwise */
+#ifdef BST_STATS
+#define BST_STAT(...) __VA_ARGS__
+#else
+#define BST_STAT(...)
+#endif
+
+
+/******************************************************************************
+struct BSTStats
+
+Description: Creates a BSTStats, the counters of a tree since it was created
+    or its counters were last reset. Comparisons count the calls of the
+    comparator, so a three-way compare counts once. A descent is one walk
+    down from the root by find or insert, and its length is the number of
+    nodes it compared against
+
+Data Fields:
+    comparisons (unsigned long long)    - calls of the comparator
+    rotations (unsigned long long)      - single rotations
+    descents (unsigned long long)       - walks down from the root
+    descentNodes (unsigned long long)   - nodes visited by all descents
+    deepestDescent (unsigned long long) - nodes visited by the longest descent
+    allocations (unsigned long long)    - nodes created
+    deallocations (unsigned long long)  - nodes destroyed
+
+Public functions:
+    operator+=     - adds the counters of another tree
+    averageDescent - gives the average number of nodes visited per descent
+    toJSON         - writes the counters as a JSON object
+******************************************************************************/
+struct BSTStats {
+
+  unsigned long long comparisons = 0;
+  unsigned long long rotations = 0;
+  unsigned long long descents = 0;
+  unsigned long long descentNodes = 0;
+  unsigned long long deepestDescent = 0;
+  unsigned long long allocations = 0;
+  unsigned long long deallocations = 0;
+
+  /** Adds the counters of a tree which worked on part of ours */
+  BSTStats& operator+=(const BSTStats& o) {
+    comparisons += o.comparisons;
+    rotations += o.rotations;
+    descents += o.descents;
+    descentNodes += o.descentNodes;
+    deepestDescent = deepestDescent > o.deepestDescent ? deepestDescent
+                                                       : o.deepestDescent;
+    allocations += o.allocations;
+    deallocations += o.deallocations;
+    return *this;
+  }
+
+  double averageDescent() const {
+    return descents ? double(descentNodes) / descents : 0.0;
+  }
+
+  std::string toJSON() const {
+    std::ostringstream out;
+    out << "{\"comparisons\": " << comparisons
+        << ", \"rotations\": " << rotations
+        << ", \"descents\": " << descents
+        << ", \"average_descent\": " << averageDescent()
+        << ", \"deepest_descent\": " << deepestDescent
+        << ", \"allocations\": " << allocations
+        << ", \"deallocations\": " << deallocations << "}";
+    return out.str();
+  }
+};
+
+
+/******************************************************************************
+class StatCounter
+
+Description: Creates a StatCounter, one counter kept on the hot paths. Const
+    lookups count too, and those may run on several threads at once under a
+    shared lock, so the counter is atomic. It orders no other memory, so
+    every access is relaxed and costs no more than a plain add on x86
+
+Data Fields:
+    n (atomic<unsigned long long>) - the count
+
+Public functions:
+    StatCounter - constructor for StatCounter
+    operator++  - adds one to the count
+    operator+=  - adds to the count
+    raise       - raises the count to at least a value
+    load        - gives the count
+******************************************************************************/
+class StatCounter {
+
+  std::atomic<unsigned long long> n;
+
+public:
+
+  StatCounter(unsigned long long n = 0) : n(n) {  }
+
+  StatCounter(const StatCounter& other) : n(other.load()) {  }
+
+  StatCounter& operator=(const StatCounter& other) {
+    n.store(other.load(), std::memory_order_relaxed);
+    return *this;
+  }
+
+  void operator++() {
+    n.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void operator+=(unsigned long long k) {
+    n.fetch_add(k, std::memory_order_relaxed);
+  }
+
+  /** Keeps the larger of the count and k, retrying when another thread
+   *  changed the count in between */
+  void raise(unsigned long long k) {
+    unsigned long long seen = load();
+    while (seen < k &&
+           !n.compare_exchange_weak(seen, k, std::memory_order_relaxed)) {  }
+  }
+
+  unsigned long long load() const {
+    return n.load(std::memory_order_relaxed);
+  }
+};
+
+
+/******************************************************************************
+struct BSTCounters
+
+Description: Creates a BSTCounters, the live counters of a tree, which
+    BSTStats takes a snapshot of. Each field counts what the field of the
+    same name in BSTStats reports
+
+Public functions:
+    operator+= - adds the counters of another tree
+    snapshot   - gives the counters as a BSTStats
+******************************************************************************/
+struct BSTCounters {
+
+  StatCounter rotations;
+  StatCounter descents;
+  StatCounter descentNodes;
+  StatCounter deepestDescent;
+  StatCounter allocations;
+  StatCounter deallocations;
+
+  /** Adds the counters of a tree which worked on part of ours */
+  BSTCounters& operator+=(const BSTCounters& o) {
+    rotations += o.rotations.load();
+    descents += o.descents.load();
+    descentNodes += o.descentNodes.load();
+    deepestDescent.raise(o.deepestDescent.load());
+    allocations += o.allocations.load();
+    deallocations += o.deallocations.load();
+    return *this;
+  }
+
+  /** The counters as they are now, with comparisons counted elsewhere */
+  BSTStats snapshot(unsigned long long comparisons) const {
+    BSTStats s;
+    s.comparisons = comparisons;
+    s.rotations = rotations.load();
+    s.descents = descents.load();
+    s.descentNodes = descentNodes.load();
+    s.deepestDescent = deepestDescent.load();
+    s.allocations = allocations.load();
+    s.deallocations = deallocations.load();
+    return s;
+  }
+};
+
+
+/******************************************************************************
+struct BSTShape
+
+Description: Creates a BSTShape, a summary of the shape of a tree taken by
+    visiting every node. The root is at depth 0. A treap with good random
+    priorities has an average depth close to 2 ln n, so a ratio well above
+    1 means its priorities have degraded, for example through ties or a
+    poor generator
+
+Data Fields:
+    size (unsigned long)           - the number of nodes
+    height (unsigned int)          - the number of nodes on the longest path
+    averageDepth (double)          - the average depth of the nodes
+    expectedDepth (double)         - 2 ln n, the expected average depth of a
+                                     random treap
+    histogram (vector<unsigned long>) - the number of nodes at each depth
+
+Public functions:
+    depthRatio - gives averageDepth divided by expectedDepth
+    toJSON     - writes the shape as a JSON object
+******************************************************************************/
+struct BSTShape {
+
+  unsigned long size = 0;
+  unsigned int height = 0;
+  double averageDepth = 0;
+  double expectedDepth = 0;
+  std::vector<unsigned long> histogram;
+
+  double depthRatio() const {
+    return expectedDepth > 0 ? averageDepth / expectedDepth : 0.0;
+  }
+
+  std::string toJSON() const {
+    std::ostringstream out;
+    out << "{\"size\": " << size << ", \"height\": " << height
+        << ", \"average_depth\": " << averageDepth
+        << ", \"expected_depth\": " << expectedDepth
+        << ", \"depth_ratio\": " << depthRatio() << ", \"histogram\": [";
+    for (std::size_t d = 0; d < histogram.size(); ++d)
+      out << (d ? ", " : "") << histogram[d];
+    out << "]}";
+    return out.str();
+  }
+};
+
+#endif // BSTSTATS_HPP
@@ -0,0 +1,570 @@
+/******************************************************************************
+
+File Name:    CompactRST.hpp
+Description:  This program creates a class called CompactRST, a randomized
+              search tree whose nodes live in growable arrays and refer to
+              each other by 32-bit indices instead of pointers, along with the
+              two ways of laying those arrays out
+
+******************************************************************************/
+
+
+#ifndef COMPACTRST_HPP
+#define COMPACTRST_HPP
+#include "Priority.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+
+/******************************************************************************
+class PackedNodes
+
+Description: Stores every node of a CompactRST in one array of structs, so
+    the key, priority and both child indices of a node share a cache line.
+    For an int key a node takes 16 bytes instead of the 32 bytes of a
+    BSTNode
+
+Public functions:
+    key, priority - the item and priority of a node
+    left, right   - the indices of the children of a node
+    setLeft       - changes the left child of a node
+    setRight      - changes the right child of a node
+    add           - appends a node and returns its index
+    assign        - reuses the slot of a removed node
+    count         - gives the number of slots in use or free
+    reserve       - makes room for a number of nodes
+    clear         - removes every node
+    bytes         - gives the memory held by the arrays
+******************************************************************************/
+template<typename Data>
+class PackedNodes {
+
+  struct Node {
+    Data data;
+    std::uint32_t priority;
+    std::uint32_t left;
+    std::uint32_t right;
+  };
+
+  std::vector<Node> nodes;
+
+public:
+
+  const Data& key(std::uint32_t i) const { return nodes[i].data; }
+  std::uint32_t priority(std::uint32_t i) const { return nodes[i].priority; }
+  std::uint32_t left(std::uint32_t i) const { return nodes[i].left; }
+  std::uint32_t right(std::uint32_t i) const { return nodes[i].right; }
+  void setLeft(std::uint32_t i, std::uint32_t l) { nodes[i].left = l; }
+  void setRight(std::uint32_t i, std::uint32_t r) { nodes[i].right = r; }
+
+  std::uint32_t add(const Data& item, std::uint32_t priority,
+                    std::uint32_t none) {
+    nodes.push_back(Node{item, priority, none, none});
+    return static_cast<std::uint32_t>(nodes.size() - 1);
+  }
+
+  void assign(std::uint32_t i, const Data& item, std::uint32_t priority,
+              std::uint32_t none) {
+    nodes[i] = Node{item, priority, none, none};
+  }
+
+  std::size_t count() const { return nodes.size(); }
+  void reserve(std::size_t n) { nodes.reserve(n); }
+  void clear() { std::vector<Node>().swap(nodes); }
+  std::size_t bytes() const { return nodes.capacity() * sizeof(Node); }
+};
+
+
+/******************************************************************************
+class SplitNodes
+
+Description: Stores the keys, priorities, left and right indices of a
+    CompactRST in four separate arrays. A search only reads the keys and the
+    child indices, so it never pulls priorities or neighbouring fields it
+    does not need into the cache, and the key array stays dense even for
+    keys with awkward alignment
+
+Public functions:
+    Same as PackedNodes
+******************************************************************************/
+template<typename Data>
+class SplitNodes {
+
+  std::vector<Data> keys;
+  std::vector<std::uint32_t> priorities;
+  std::vector<std::uint32_t> lefts;
+  std::vector<std::uint32_t> rights;
+
+public:
+
+  const Data& key(std::uint32_t i) const { return keys[i]; }
+  std::uint32_t priority(std::uint32_t i) const { return priorities[i]; }
+  std::uint32_t left(std::uint32_t i) const { return lefts[i]; }
+  std::uint32_t right(std::uint32_t i) const { return rights[i]; }
+  void setLeft(std::uint32_t i, std::uint32_t l) { lefts[i] = l; }
+  void setRight(std::uint32_t i, std::uint32_t r) { rights[i] = r; }
+
+  std::uint32_t add(const Data& item, std::uint32_t priority,
+                    std::uint32_t none) {
+    keys.push_back(item);
+    priorities.push_back(priority);
+    lefts.push_back(none);
+    rights.push_back(none);
+    return static_cast<std::uint32_t>(keys.size() - 1);
+  }
+
+  void assign(std::uint32_t i, const Data& item, std::uint32_t priority,
+              std::uint32_t none) {
+    keys[i] = item;
+    priorities[i] = priority;
+    lefts[i] = none;
+    rights[i] = none;
+  }
+
+  std::size_t count() const { return keys.size(); }
+
+  void reserve(std::size_t n) {
+    keys.reserve(n);
+    priorities.reserve(n);
+    lefts.reserve(n);
+    rights.reserve(n);
+  }
+
+  void clear() {
+    std::vector<Data>().swap(keys);
+    std::vector<std::uint32_t>().swap(priorities);
+    std::vector<std::uint32_t>().swap(lefts);
+    std::vector<std::uint32_t>().swap(rights);
+  }
+
+  std::size_t bytes() const {
+    return keys.capacity() * sizeof(Data) +
+           (priorities.capacity() + lefts.capacity() + rights.capacity()) *
+           sizeof(std::uint32_t);
+  }
+};
+
+
+/******************************************************************************
+class CompactRST
+
+Description: Creates a CompactRST, a randomized search tree with the same
+    treap rules as RST whose nodes are stored by index in the arrays of a
+    Storage. Indices are 32 bits wide, so a tree holds up to about four
+    billion items, and there are no parent indices: insert and erase walk
+    down recursively and fix the links on the way back up. Removed slots are
+    chained through their left index and reused by later inserts. Priorities
+    are the top 32 bits of a Xoshiro256 of our own, so a node stays as small
+    as a 32-bit priority allows and no tree touches rand().
+
+    Data must be copy assignable, since slots are overwritten when reused
+
+Template Parameters:
+    Data    - the type of the items stored in our CompactRST
+    Storage - PackedNodes, the default, keeps each node together, while
+              SplitNodes keeps every field in its own array
+
+Data Fields:
+    nodes (Storage)          - the arrays holding our nodes
+    root (uint32_t)          - the index of our root, or NONE if empty
+    freeList (uint32_t)      - the most recently removed slot, or NONE
+    isize (unsigned int)     - the number of items in our CompactRST
+    priorities (Xoshiro256)  - the source of the priorities of our nodes
+
+Public functions:
+    CompactRST - constructor for CompactRST
+    seed       - restarts the priorities of our CompactRST from a seed
+    insert     - inserts an item if it is not there yet
+    erase      - removes an item
+    find       - finds an item
+    contains   - checks if an item is in our CompactRST
+    reserve    - makes room for a number of items
+    clear      - removes every item
+    size       - gives the number of items
+    empty      - checks to see if our CompactRST is empty
+    bytes      - gives the memory held by our nodes
+    begin      - creates iterator pointing to the first item
+    end        - creates iterator pointing past the last item
+******************************************************************************/
+template<typename Data, template<typename> class Storage = PackedNodes>
+class CompactRST {
+
+  /** The index standing for a missing child */
+  static const std::uint32_t NONE = ~std::uint32_t(0);
+
+  Storage<Data> nodes;
+  std::uint32_t root;
+  std::uint32_t freeList;
+  unsigned int isize;
+  Xoshiro256 priorities;
+
+public:
+
+
+  /****************************************************************************
+  class iterator
+
+  Description: Walks a CompactRST in order. Without parent indices, the
+      iterator keeps the path of nodes whose items are still to be visited.
+      Inserting or erasing items invalidates every iterator
+  ****************************************************************************/
+  class iterator {
+    const CompactRST* tree;
+    std::vector<std::uint32_t> path;
+
+    friend class CompactRST;
+
+    explicit iterator(const CompactRST* tree) : tree(tree) {  }
+
+    /** Pushes n and its left spine, the next items to visit */
+    void descend(std::uint32_t n) {
+      for (; n != NONE; n = tree -> nodes.left(n))
+        path.push_back(n);
+    }
+
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef Data value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const Data* pointer;
+    typedef const Data& reference;
+
+    const Data& operator*() const {
+      return tree -> nodes.key(path.back());
+    }
+
+    const Data* operator->() const {
+      return &tree -> nodes.key(path.back());
+    }
+
+    iterator& operator++() {
+      std::uint32_t n = path.back();
+      path.pop_back();
+      descend(tree -> nodes.right(n));
+      return *this;
+    }
+
+    iterator operator++(int) {
+      iterator before = *this;
+      ++(*this);
+      return before;
+    }
+
+    bool operator==(const iterator& other) const {
+      return path.empty() ? other.path.empty() :
+             !other.path.empty() && path.back() == other.path.back();
+    }
+
+    bool operator!=(const iterator& other) const {
+      return !(*this == other);
+    }
+  };
+
+
+  /****************************************************************************
+  Function Name:  CompactRST
+  Purpose:        This function initializes an empty CompactRST
+  Result:         An empty CompactRST is created
+  ****************************************************************************/
+  CompactRST() : root(NONE), freeList(NONE), isize(0) {  }
+
+
+  /****************************************************************************
+  Function Name:  seed
+  Purpose:        This function restarts the priorities of our CompactRST
+  Description:    Inserting the same items in the same order after the same
+                  seed always gives the same shape. Nodes already in our
+                  CompactRST keep their priorities
+  Input:          s:  the seed of our priority source
+  ****************************************************************************/
+  void seed(std::uint64_t s) {
+    priorities.seed(s);
+  }
+
+
+  /****************************************************************************
+  Function Name:  insert
+  Purpose:        This function inserts an item into our CompactRST
+  Description:    This function gives item a random priority and calls
+                  insertAt, which adds it as a leaf and rotates it up on the
+                  way back to the root
+  Input:          item: the data we are attempting to insert
+  Result:         true if item was inserted
+                  false if item was already in our CompactRST
+  ****************************************************************************/
+  bool insert(const Data& item) {
+    bool inserted = false;
+    root = insertAt(root, item,
+                    static_cast<std::uint32_t>(priorities() >> 32), inserted);
+    isize += inserted;
+    return inserted;
+  }
+
+
+  /****************************************************************************
+  Function Name:  erase
+  Purpose:        This function removes an item from our CompactRST
+  Description:    This function calls eraseAt, which replaces the node of item
+                  by the join of its subtrees and puts its slot on the free
+                  list
+  Input:          item: the data we are attempting to remove
+  Result:         true if item was found and removed
+                  false if item was not in our CompactRST
+  ****************************************************************************/
+  bool erase(const Data& item) {
+    bool erased = false;
+    root = eraseAt(root, item, erased);
+    isize -= erased;
+    return erased;
+  }
+
+
+  /****************************************************************************
+  Function Name:  find
+  Purpose:        This function finds an item in our CompactRST
+  Description:    This function walks down from root, remembering the nodes
+                  where it went left so the iterator can continue from there
+  Input:          item: the data we are looking for
+  Result:         Returns an iterator to item, or end() if it is not found
+  ****************************************************************************/
+  iterator find(const Data& item) const {
+    iterator it(this);
+
+    for (std::uint32_t n = root; n != NONE; ) {
+      if (item < nodes.key(n)) {
+        it.path.push_back(n);
+        n = nodes.left(n);
+      }
+
+      else if (nodes.key(n) < item)
+        n = nodes.right(n);
+
+      else {
+        it.path.push_back(n);
+        return it;
+      }
+    }
+
+    return end();
+  }
+
+
+  /****************************************************************************
+  Function Name:  contains
+  Purpose:        This function checks if an item is in our CompactRST
+  Description:    Unlike find, this function does not build an iterator, so
+                  the descent only reads keys and child indices
+  Input:          item: the data we are looking for
+  Result:         true if item is in our CompactRST
+                  false if it is not
+  ****************************************************************************/
+  bool contains(const Data& item) const {
+    std::uint32_t n = root;
+
+    /* While loop is executed until item is found or we fall off a leaf */
+    while (n != NONE) {
+      if (item < nodes.key(n))
+        n = nodes.left(n);
+
+      else if (nodes.key(n) < item)
+        n = nodes.right(n);
+
+      else
+        return true;
+    }
+
+    return false;
+  }
+
+
+  /****************************************************************************
+  Function Name:  reserve
+  Purpose:        This function makes room for a number of items
+  Description:    Growing the arrays copies every node, so reserving up front
+                  avoids both the copies and the spare capacity left behind
+                  by doubling
+  Input:          n:  the number of items we expect to hold
+  Result:         Our arrays hold at least n nodes without growing
+  ****************************************************************************/
+  void reserve(std::size_t n) {
+    nodes.reserve(n);
+  }
+
+
+  /****************************************************************************
+  Function Name:  clear
+  Purpose:        This function removes every item from our CompactRST
+  Description:    Nodes hold no resources of their own apart from their
+                  data, so dropping the arrays frees the whole tree at once
+  Result:         An empty CompactRST
+  ****************************************************************************/
+  void clear() {
+    nodes.clear();
+    root = NONE;
+    freeList = NONE;
+    isize = 0;
+  }
+
+  unsigned int size() const {
+    return isize;
+  }
+
+  bool empty() const {
+    return root == NONE;
+  }
+
+  std::size_t bytes() const {
+    return sizeof(*this) + nodes.bytes();
+  }
+
+  iterator begin() const {
+    iterator it(this);
+    it.descend(root);
+    return it;
+  }
+
+  iterator end() const {
+    return iterator(this);
+  }
+
+private:
+
+
+  /****************************************************************************
+  Function Name:  newNode
+  Purpose:        This function creates a node holding an item
+  Description:    This function takes the slot at the front of the free list
+                  if there is one and appends a slot otherwise. Appending may
+                  move every node, so callers only hold on to indices
+  Input:          item:     the data of the node
+                  priority: the priority of the node
+  Result:         Returns the index of the new node
+  ****************************************************************************/
+  std::uint32_t newNode(const Data& item, std::uint32_t priority) {
+
+    /* If statement is executed when a removed slot can be reused */
+    if (freeList != NONE) {
+      std::uint32_t n = freeList;
+      freeList = nodes.left(n);
+      nodes.assign(n, item, priority, NONE);
+      return n;
+    }
+
+    return nodes.add(item, priority, NONE);
+  }
+
+
+  /****************************************************************************
+  Function Name:  insertAt
+  Purpose:        This function adds an item below a node
+  Description:    This function adds item as a leaf and, on the way back up,
+                  rotates it above every ancestor with a larger priority
+  Input:          t:        the index of the root of the subtree
+                  item:     the data we are adding
+                  priority: the priority of the new node
+                  inserted: set to true if item was added
+  Result:         Returns the index of the new root of the subtree
+  ****************************************************************************/
+  std::uint32_t insertAt(std::uint32_t t, const Data& item,
+                         std::uint32_t priority, bool& inserted) {
+
+    /* If statement is executed when item becomes a leaf here */
+    if (t == NONE) {
+      inserted = true;
+      return newNode(item, priority);
+    }
+
+    /* If statement is executed when item belongs in the left subtree */
+    if (item < nodes.key(t)) {
+      std::uint32_t l = insertAt(nodes.left(t), item, priority, inserted);
+      nodes.setLeft(t, l);
+
+      /* If statement is executed when l must be rotated above t */
+      if (nodes.priority(l) < nodes.priority(t)) {
+        nodes.setLeft(t, nodes.right(l));
+        nodes.setRight(l, t);
+        return l;
+      }
+    }
+
+    /* Else if statement is executed when item belongs in the right subtree */
+    else if (nodes.key(t) < item) {
+      std::uint32_t r = insertAt(nodes.right(t), item, priority, inserted);
+      nodes.setRight(t, r);
+
+      /* If statement is executed when r must be rotated above t */
+      if (nodes.priority(r) < nodes.priority(t)) {
+        nodes.setRight(t, nodes.left(r));
+        nodes.setLeft(r, t);
+        return r;
+      }
+    }
+
+    return t;
+  }
+
+
+  /****************************************************************************
+  Function Name:  eraseAt
+  Purpose:        This function removes an item below a node
+  Input:          t:      the index of the root of the subtree
+                  item:   the data we are removing
+                  erased: set to true if item was found
+  Result:         Returns the index of the new root of the subtree
+  ****************************************************************************/
+  std::uint32_t eraseAt(std::uint32_t t, const Data& item, bool& erased) {
+
+    /* If statement is executed when item is not below t */
+    if (t == NONE)
+      return NONE;
+
+    if (item < nodes.key(t))
+      nodes.setLeft(t, eraseAt(nodes.left(t), item, erased));
+
+    else if (nodes.key(t) < item)
+      nodes.setRight(t, eraseAt(nodes.right(t), item, erased));
+
+    else {
+      erased = true;
+      std::uint32_t joined = joinAt(nodes.left(t), nodes.right(t));
+      nodes.setLeft(t, freeList);
+      freeList = t;
+      return joined;
+    }
+
+    return t;
+  }
+
+
+  /****************************************************************************
+  Function Name:  joinAt
+  Purpose:        This function joins two subtrees
+  Description:    This function merges the right spine of left with the left
+                  spine of right by priority
+  Input:          left:   the subtree holding the smaller items
+                  right:  the subtree holding the larger items
+  Result:         Returns the index of the root of the joined subtree
+  ****************************************************************************/
+  std::uint32_t joinAt(std::uint32_t left, std::uint32_t right) {
+
+    /* If statement is executed when either subtree does not exist */
+    if (left == NONE)
+      return right;
+
+    if (right == NONE)
+      return left;
+
+    /* If statement is executed when left becomes the root */
+    if (nodes.priority(left) < nodes.priority(right)) {
+      nodes.setRight(left, joinAt(nodes.right(left), right));
+      return left;
+    }
+
+    nodes.setLeft(right, joinAt(left, nodes.left(right)));
+    return right;
+  }
+};
+
+#endif // COMPACTRST_HPP
@@ -0,0 +1,418 @@
+/******************************************************************************
+
+File Name:    ConcurrentRST.hpp
+Description:  This program creates a class called ConcurrentRST, a randomized
+              search tree which many threads may insert into, search and erase
+              from at the same time. The keys are split into ranges, each held
+              by its own RST behind its own lock
+
+******************************************************************************/
+
+
+#ifndef CONCURRENTRST_HPP
+#define CONCURRENTRST_HPP
+#include "RST.hpp"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+
+/******************************************************************************
+class ConcurrentRST
+
+Description: Creates a ConcurrentRST, which partitions its keys into shards by
+    a sorted list of splitters. Shard i holds the keys from splitter i - 1 up
+    to but not including splitter i, so threads working on different ranges
+    of keys never wait for each other. Every shard is an RST guarded by a
+    reader/writer lock.
+
+    Keys are routed to their shards and ordered within them by Compare, so
+    the shards keep to the order of the RSTs inside them.
+
+    The splitters are picked from a sample of keys given to the constructor,
+    and picked again from the stored keys whenever one shard grows to twice
+    its fair share. Picking them again stops the world: it takes the layout
+    lock exclusively, which waits for every other operation to finish, and
+    then copies out and rebuilds every shard in O(n) before any thread may
+    go on. Automatic rebalances happen only after the total grew by a
+    quarter, so their cost is O(1) per insert on average, but a single
+    insert may stall every thread for the whole rebuild
+
+Template Parameters:
+    Data    - the type of the keys
+    Compare - the comparator ordering the keys
+
+Data Fields:
+    shards (std::unique_ptr<Shard[]>)      - the RST and lock of every shard
+    shardCount (unsigned int)              - the number of shards
+    splitters (std::vector<Data>)          - the keys separating the shards
+    layout (std::shared_mutex)             - guards splitters and the shards
+    comp (Compare)                         - the comparator ordering the keys
+    total (std::atomic<unsigned int>)      - the number of keys in all shards
+    balancedAt (std::atomic<unsigned int>) - total when we last rebalanced
+
+Public functions:
+    ConcurrentRST - constructor for ConcurrentRST
+    insert        - inserts an item into the shard of its range
+    find          - checks whether an item is stored
+    erase         - removes an item from the shard of its range
+    size          - gives the number of items in all shards
+    empty         - checks to see if no shard holds an item
+    for_each      - visits every item in ascending order
+    rebalance     - picks new splitters from the stored items
+******************************************************************************/
+template<typename Data, typename Compare = std::less<Data> >
+class ConcurrentRST {
+
+  typedef RST<Data, NodePool, Compare> Tree;
+
+  /** One range of keys and the lock guarding it */
+  struct Shard {
+    mutable std::shared_mutex lock;
+    Tree tree;
+  };
+
+  /** Shards per hardware thread when no count is given */
+  static const unsigned int SHARDS_PER_THREAD = 4;
+
+  /** Keys per shard before the first automatic rebalance */
+  static const unsigned int MIN_SHARD_SIZE = 64;
+
+  std::unique_ptr<Shard[]> shards;
+  unsigned int shardCount;
+  std::vector<Data> splitters;
+  mutable std::shared_mutex layout;
+  Compare comp;
+  std::atomic<unsigned int> total;
+  std::atomic<unsigned int> balancedAt;
+
+public:
+
+
+  /****************************************************************************
+  Function Name:  ConcurrentRST
+  Purpose:        This function initializes an empty ConcurrentRST
+  Description:    This function creates the shards. Until the first rebalance
+                  every key goes into the first shard
+  Input:          count:  the number of shards, or 0 for four per hardware
+                          thread
+                  comp:   the comparator ordering our keys
+  Result:         An empty ConcurrentRST is created
+  ****************************************************************************/
+  explicit ConcurrentRST(unsigned int count = 0,
+                         const Compare& comp = Compare())
+      : comp(comp), total(0), balancedAt(0) {
+    createShards(count);
+  }
+
+
+  /****************************************************************************
+  Function Name:  ConcurrentRST
+  Purpose:        This function initializes an empty ConcurrentRST whose
+                  splitters are chosen from a sample of keys
+  Description:    This function sorts a copy of the sample and takes evenly
+                  spaced keys from it as splitters, so each shard is expected
+                  to receive the same share of keys drawn like the sample
+  Input:          first:  iterator to the first key of the sample
+                  last:   iterator past the last key of the sample
+                  count:  the number of shards, or 0 for four per hardware
+                          thread
+                  comp:   the comparator ordering our keys
+  Result:         An empty ConcurrentRST is created
+  ****************************************************************************/
+  template<typename Iterator>
+  ConcurrentRST(Iterator first, Iterator last, unsigned int count = 0,
+                const Compare& comp = Compare())
+      : comp(comp), total(0), balancedAt(0) {
+    createShards(count);
+
+    std::vector<Data> sample(first, last);
+    std::sort(sample.begin(), sample.end(), comp);
+    sample.erase(std::unique(sample.begin(), sample.end(),
+                             [this](const Data& a, const Data& b) {
+                               return equivalent(a, b);
+                             }),
+                 sample.end());
+    pickSplitters(sample);
+  }
+
+  ConcurrentRST(const ConcurrentRST&) = delete;
+  ConcurrentRST& operator=(const ConcurrentRST&) = delete;
+
+
+  /****************************************************************************
+  Function Name:  insert
+  Purpose:        This function inserts an item into our ConcurrentRST
+  Description:    This function locks the layout for reading and the shard of
+                  item for writing, then inserts item into that shard. If the
+                  shard has grown to twice its fair share, the layout is
+                  locked for writing and the splitters are picked again
+  Input:          item: the data we are attempting to insert
+  Result:         true if the insert was performed successfully
+                  false if item was already stored
+  ****************************************************************************/
+  bool insert(const Data& item) {
+    bool inserted;
+    bool crowded = false;
+    {
+      std::shared_lock<std::shared_mutex> layoutGuard(layout);
+      Shard& shard = shards[shardOf(item)];
+      std::unique_lock<std::shared_mutex> guard(shard.lock);
+      inserted = shard.tree.insert(item);
+
+      /* If statement is executed when item was added to the shard */
+      if (inserted)
+        crowded = isCrowded(shard.tree.size(), ++total);
+    }
+
+    /* If statement is executed when the shard holds too many keys */
+    if (crowded) {
+      std::unique_lock<std::shared_mutex> layoutGuard(layout);
+
+      /* Another thread may have rebalanced while we waited for the lock */
+      if (isCrowded(largestShard(), total))
+        rebalanceLocked();
+    }
+
+    return inserted;
+  }
+
+
+  /****************************************************************************
+  Function Name:  find
+  Purpose:        This function checks whether an item is stored
+  Description:    This function locks the layout and the shard of item for
+                  reading, so any number of threads may search at once
+  Input:          item: the data we are looking for
+  Result:         true if item is in our ConcurrentRST
+                  false if it is not
+  ****************************************************************************/
+  bool find(const Data& item) const {
+    std::shared_lock<std::shared_mutex> layoutGuard(layout);
+    const Shard& shard = shards[shardOf(item)];
+    std::shared_lock<std::shared_mutex> guard(shard.lock);
+    return shard.tree.find(item) != shard.tree.end();
+  }
+
+
+  /****************************************************************************
+  Function Name:  erase
+  Purpose:        This function removes an item from our ConcurrentRST
+  Description:    This function locks the layout for reading and the shard of
+                  item for writing, then erases item from that shard
+  Input:          item: the data we are attempting to remove
+  Result:         true if item was found and removed
+                  false if item was not stored
+  ****************************************************************************/
+  bool erase(const Data& item) {
+    std::shared_lock<std::shared_mutex> layoutGuard(layout);
+    Shard& shard = shards[shardOf(item)];
+    std::unique_lock<std::shared_mutex> guard(shard.lock);
+
+    /* If statement is executed when item was removed from the shard */
+    if (shard.tree.erase(item)) {
+      --total;
+      return true;
+    }
+    return false;
+  }
+
+
+  /****************************************************************************
+  Function Name:  size
+  Purpose:        This function returns the number of items stored
+  Result:         Returns the number of items in all shards
+  ****************************************************************************/
+  unsigned int size() const {
+    return total;
+  }
+
+
+  /****************************************************************************
+  Function Name:  empty
+  Purpose:        This function checks if our ConcurrentRST is empty
+  Result:         true if no shard holds an item
+                  false otherwise
+  ****************************************************************************/
+  bool empty() const {
+    return total == 0;
+  }
+
+
+  /****************************************************************************
+  Function Name:  for_each
+  Purpose:        This function visits every item in ascending order
+  Description:    Since every shard holds a range of keys and the shards are
+                  in order, visiting the shards one after another visits the
+                  keys in ascending order. Each shard is locked for reading
+                  while it is visited, so the items of one shard are a
+                  consistent view, while shards visited later may already
+                  reflect newer inserts and erases
+  Input:          visit:  called with every item
+  Result:         visit has been called with every item in ascending order
+  ****************************************************************************/
+  template<typename Visitor>
+  void for_each(Visitor visit) const {
+    std::shared_lock<std::shared_mutex> layoutGuard(layout);
+
+    for (unsigned int i = 0; i < shardCount; ++i) {
+      std::shared_lock<std::shared_mutex> guard(shards[i].lock);
+      for (typename Tree::iterator it = shards[i].tree.begin();
+           it != shards[i].tree.end(); ++it)
+        visit(*it);
+    }
+  }
+
+
+  /****************************************************************************
+  Function Name:  rebalance
+  Purpose:        This function picks new splitters from the stored items
+  Description:    This function locks the layout for writing, which waits for
+                  every other operation, and redistributes the items evenly
+  Result:         Every shard holds about the same number of items
+  ****************************************************************************/
+  void rebalance() {
+    std::unique_lock<std::shared_mutex> layoutGuard(layout);
+    rebalanceLocked();
+  }
+
+private:
+
+
+  /****************************************************************************
+  Function Name:  equivalent
+  Purpose:        This function checks if two items are equal by comp
+  Result:         true if neither item comes before the other
+  ****************************************************************************/
+  bool equivalent(const Data& a, const Data& b) const {
+    return !comp(a, b) && !comp(b, a);
+  }
+
+
+  /****************************************************************************
+  Function Name:  createShards
+  Purpose:        This function creates the shards
+  Input:          count:  the number of shards, or 0 for four per hardware
+                          thread
+  Result:         count empty shards ordered by comp are created
+  ****************************************************************************/
+  void createShards(unsigned int count) {
+
+    /* If statement is executed when no count was given */
+    if (count == 0)
+      count = std::max(1u, std::thread::hardware_concurrency()) *
+              SHARDS_PER_THREAD;
+
+    shardCount = count;
+    shards.reset(new Shard[count]);
+    for (unsigned int i = 0; i < count; ++i)
+      shards[i].tree = Tree(comp);
+  }
+
+
+  /****************************************************************************
+  Function Name:  shardOf
+  Purpose:        This function finds the shard holding an item
+  Description:    This function performs a binary search on the splitters
+  Input:          item: the data whose shard we are looking for
+  Result:         Returns the index of the shard for item
+  ****************************************************************************/
+  unsigned int shardOf(const Data& item) const {
+    return std::upper_bound(splitters.begin(), splitters.end(), item, comp) -
+           splitters.begin();
+  }
+
+
+  /****************************************************************************
+  Function Name:  pickSplitters
+  Purpose:        This function picks splitters from sorted distinct keys
+  Description:    This function takes every (size / shardCount)-th key, so
+                  each shard covers the same number of the given keys
+  Input:          keys: sorted distinct keys to pick the splitters from
+  Result:         splitters holds at most shardCount - 1 increasing keys
+  ****************************************************************************/
+  void pickSplitters(const std::vector<Data>& keys) {
+    splitters.clear();
+
+    for (unsigned int i = 1; i < shardCount; ++i) {
+      std::size_t at = keys.size() * i / shardCount;
+
+      /* If statement is executed when this key was not picked already */
+      if (at > 0 && (splitters.empty() || comp(splitters.back(), keys[at])))
+        splitters.push_back(keys[at]);
+    }
+  }
+
+
+  /****************************************************************************
+  Function Name:  isCrowded
+  Purpose:        This function checks if a shard holds too many keys
+  Description:    A shard is crowded once it holds twice its fair share. To
+                  keep the cost of rebalancing low on average, we only
+                  rebalance again after the total grew by a quarter
+  Input:          shardSize:  the number of keys in the shard
+                  keys:       the number of keys in all shards
+  Result:         true if the splitters should be picked again
+  ****************************************************************************/
+  bool isCrowded(unsigned int shardSize, unsigned int keys) const {
+    return shardCount > 1 && keys >= MIN_SHARD_SIZE * shardCount &&
+           shardSize > 2 * (keys / shardCount) &&
+           keys >= balancedAt + balancedAt / 4;
+  }
+
+
+  /****************************************************************************
+  Function Name:  largestShard
+  Purpose:        This function finds the size of the largest shard
+  Description:    The layout must be locked for writing
+  Result:         Returns the number of keys in the largest shard
+  ****************************************************************************/
+  unsigned int largestShard() const {
+    unsigned int largest = 0;
+    for (unsigned int i = 0; i < shardCount; ++i)
+      largest = std::max(largest, shards[i].tree.size());
+    return largest;
+  }
+
+
+  /****************************************************************************
+  Function Name:  rebalanceLocked
+  Purpose:        This function redistributes the items among the shards
+  Description:    This function copies the items of every shard in order,
+                  picks new splitters from them and rebuilds every shard with
+                  RST::build_from_sorted, taking O(n) time in all. Each shard
+                  gets its own NodePool, so no two shards ever share blocks.
+                  The layout must be locked for writing
+  Result:         Every shard holds about the same number of items
+  ****************************************************************************/
+  void rebalanceLocked() {
+    std::vector<Data> items;
+    items.reserve(total);
+
+    for (unsigned int i = 0; i < shardCount; ++i) {
+      for (typename Tree::iterator it = shards[i].tree.begin();
+           it != shards[i].tree.end(); ++it)
+        items.push_back(*it);
+      shards[i].tree.clear();
+    }
+
+    pickSplitters(items);
+
+    typename std::vector<Data>::iterator from = items.begin();
+    for (unsigned int i = 0; i < shardCount; ++i) {
+      typename std::vector<Data>::iterator to = i < splitters.size() ?
+          std::lower_bound(from, items.end(), splitters[i], comp) :
+          items.end();
+      shards[i].tree = Tree::build_from_sorted(from, to, false, comp);
+      from = to;
+    }
+
+    balancedAt = items.size();
+  }
+};
+
+#endif // CONCURRENTRST_HPP
@@ -0,0 +1,283 @@
+/******************************************************************************
+
+File Name:    FrozenRST.hpp
+Description:  This program creates a class called FrozenRST, a read-only copy
+              of the items of an RST laid out for fast searching
+
+******************************************************************************/
+
+
+#ifndef FROZENRST_HPP
+#define FROZENRST_HPP
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+/******************************************************************************
+class FrozenRST
+
+Description: Creates a FrozenRST, an immutable set built once from sorted
+    items, usually by RST::freeze. The items are kept in sorted order and cut
+    into blocks of one cache line each. The largest item of every block is
+    copied into an index stored in Eytzinger order: the root at position 1
+    and the children of position k at 2k and 2k + 1, so the top levels of
+    the index share a few cache lines and the position of the next node is
+    computed rather than loaded.
+
+    A search walks the index without branching on the comparisons and
+    prefetches the cache line where the index nodes four levels further
+    down begin, whatever the size of the items. Then it counts the items
+    of the one block it found that are less than the key, which compiles
+    to SIMD compares for arithmetic keys. The index holds one item per
+    block, so for int it adds 1/16 to the memory of the items. Compare
+    orders the items, as in RST
+
+Data Fields:
+    keys (vector<Data>)      - the items in sorted order, with the last block
+                               padded by copies of the largest item
+    index (vector<Data>)     - the largest item of each block, in Eytzinger
+                               order starting at position 1
+    blockOf (vector<size_t>) - the block whose largest item is index[k]
+    count (size_t)           - the number of items
+    comp (Compare)           - the comparator ordering the items
+
+Public functions:
+    FrozenRST   - constructor for FrozenRST
+    find        - finds an item
+    lower_bound - finds the first item not less than a key
+    size        - gives the number of items
+    empty       - checks to see if FrozenRST is empty
+    begin       - creates iterator pointing to the first item
+    end         - creates iterator pointing past the last item
+******************************************************************************/
+template<typename Data, typename Compare = std::less<Data> >
+class FrozenRST {
+
+  /** The number of items per block, filling one 64 byte cache line */
+  static const std::size_t BLOCK = sizeof(Data) < 64 ? 64 / sizeof(Data) : 1;
+
+  /** The descendants of k four levels down start at LOOKAHEAD * k */
+  static const std::size_t LOOKAHEAD = 16;
+
+  std::vector<Data> keys;
+  std::vector<Data> index;
+  std::vector<std::size_t> blockOf;
+  std::size_t count;
+  Compare comp;
+
+public:
+
+  /** Items never change, so iterators walk the sorted items directly */
+  typedef typename std::vector<Data>::const_iterator iterator;
+
+
+  /****************************************************************************
+  Function Name:  FrozenRST
+  Purpose:        This function initializes an empty FrozenRST
+  Result:         An empty FrozenRST is created
+  ****************************************************************************/
+  FrozenRST(const Compare& comp = Compare()) : count(0), comp(comp) {  }
+
+
+  /****************************************************************************
+  Function Name:  FrozenRST
+  Purpose:        This function builds a FrozenRST from sorted items
+  Description:    This function copies the items, pads the last block and
+                  fills the index with an inorder walk of its positions, which
+                  visits the blocks in sorted order
+  Input:          first:  iterator to the first item
+                  last:   iterator past the last item
+                  comp:   the comparator the items are sorted by
+                  The items must be sorted and distinct
+  Result:         A FrozenRST holding the items
+  ****************************************************************************/
+  template<typename Iterator>
+  FrozenRST(Iterator first, Iterator last, const Compare& comp = Compare())
+      : keys(first, last), comp(comp) {
+    count = keys.size();
+
+    /* If statement is executed when there are no items */
+    if (!count)
+      return;
+
+    /* While loop is executed until the last block is full */
+    while (keys.size() % BLOCK)
+      keys.push_back(keys[count - 1]);
+
+    std::size_t blocks = keys.size() / BLOCK;
+    index.assign(blocks + 1, keys[0]);
+    blockOf.assign(blocks + 1, 0);
+
+    std::size_t next = 0;
+    fill(1, next);
+  }
+
+
+  /****************************************************************************
+  Function Name:  find
+  Purpose:        This function finds an item
+  Input:          item: the data we are looking for
+  Result:         Returns an iterator to item, or end() if it is not found
+  ****************************************************************************/
+  iterator find(const Data& item) const {
+    iterator it = lower_bound(item);
+
+    /* If statement is executed when the first item not less than item is
+     * item itself */
+    if (it != end() && !comp(item, *it))
+      return it;
+
+    return end();
+  }
+
+
+  /****************************************************************************
+  Function Name:  lower_bound
+  Purpose:        This function finds the first item not less than a key
+  Description:    This function descends the index, going right exactly when
+                  the node is less than key. Afterwards the last node where we
+                  went left is the first block whose largest item is not less
+                  than key; shifting off the trailing right turns recovers its
+                  position. Within that block we count the items less than key
+  Input:          key:  the data we are looking for
+  Result:         Returns an iterator to the first item not less than key, or
+                  end() if every item is less than key
+  ****************************************************************************/
+  iterator lower_bound(const Data& key) const {
+    std::size_t blocks = index.size() ? index.size() - 1 : 0;
+    std::size_t k = 1;
+
+    /* While loop is executed while k is a node of the index */
+    while (k <= blocks) {
+      prefetch(k * LOOKAHEAD);
+      k = 2 * k + comp(index[k], key);
+    }
+
+    /* Shift off the right turns after our last left turn, plus the left turn
+     * itself. k is zero if we never went left */
+    k >>= trailingOnes(k) + 1;
+
+    /* If statement is executed when every item is less than key */
+    if (!k)
+      return end();
+
+    std::size_t start = blockOf[k] * BLOCK;
+    return keys.begin() + start + countLess(&keys[start], key);
+  }
+
+
+  std::size_t size() const {
+    return count;
+  }
+
+  bool empty() const {
+    return !count;
+  }
+
+  iterator begin() const {
+    return keys.begin();
+  }
+
+  iterator end() const {
+    return keys.begin() + count;
+  }
+
+private:
+
+
+  /****************************************************************************
+  Function Name:  fill
+  Purpose:        This function fills the index below a position
+  Input:          k:    the position in the index
+                  next: the next block to place, in sorted order
+  Result:         index and blockOf hold the blocks below position k
+  ****************************************************************************/
+  void fill(std::size_t k, std::size_t& next) {
+
+    /* If statement is executed when k is past the end of the index */
+    if (k >= index.size())
+      return;
+
+    fill(2 * k, next);
+    index[k] = keys[next * BLOCK + BLOCK - 1];
+    blockOf[k] = next++;
+    fill(2 * k + 1, next);
+  }
+
+
+  /****************************************************************************
+  Function Name:  prefetch
+  Purpose:        This function asks for an index position to be cached
+  Description:    The address is computed as an integer, since k may be past
+                  the end of the index near the bottom of the descent, and a
+                  prefetch of such an address is simply ignored
+  Input:          k:  the position in the index
+  ****************************************************************************/
+  void prefetch(std::size_t k) const {
+#if defined(__GNUC__)
+    std::uintptr_t base = reinterpret_cast<std::uintptr_t>(index.data());
+    __builtin_prefetch(reinterpret_cast<const void*>(base + k * sizeof(Data)));
+#else
+    (void) k;
+#endif
+  }
+
+
+  /** The number of consecutive set bits at the bottom of k */
+  static unsigned int trailingOnes(std::size_t k) {
+#if defined(__GNUC__)
+    return ~k ? __builtin_ctzll(~static_cast<unsigned long long>(k)) : 64;
+#else
+    unsigned int ones = 0;
+    for (; k & 1; k >>= 1)
+      ++ones;
+    return ones;
+#endif
+  }
+
+
+  /****************************************************************************
+  Function Name:  countLess
+  Purpose:        This function counts the items of a block less than a key
+  Description:    The count is taken over the whole block without stopping
+                  early, so the compiler can turn it into SIMD compares for
+                  arithmetic keys. For int ordered by std::less on SSE2, four
+                  compares of four items each are written out directly
+  Input:          block:  the first item of the block
+                  key:    the data we are looking for
+  Result:         Returns the number of items in the block less than key
+  ****************************************************************************/
+  std::size_t countLess(const Data* block, const Data& key) const {
+#ifdef __SSE2__
+    if constexpr (std::is_same<Data, int>::value && BLOCK == 16 &&
+                  std::is_same<Compare, std::less<int> >::value) {
+      __m128i k = _mm_set1_epi32(key);
+      __m128i less = _mm_setzero_si128();
+
+      /* For loop subtracts -1 for every lane holding an item less than key */
+      for (std::size_t i = 0; i < BLOCK; i += 4) {
+        __m128i items = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(block + i));
+        less = _mm_sub_epi32(less, _mm_cmplt_epi32(items, k));
+      }
+
+      less = _mm_add_epi32(less, _mm_shuffle_epi32(less, 0x4E));
+      less = _mm_add_epi32(less, _mm_shuffle_epi32(less, 0xB1));
+      return static_cast<std::size_t>(_mm_cvtsi128_si32(less));
+    }
+#endif
+
+    std::size_t less = 0;
+    for (std::size_t i = 0; i < BLOCK; ++i)
+      less += comp(block[i], key);
+    return less;
+  }
+};
+
+#endif // FROZENRST_HPP
@@ -0,0 +1,226 @@
+/******************************************************************************
+
+File Name:    IntervalRST.hpp
+Description:  This program creates a class called IntervalRST, a randomized
+              search tree of closed intervals which finds every interval
+              overlapping a range or containing a point
+
+******************************************************************************/
+
+
+#ifndef INTERVALRST_HPP
+#define INTERVALRST_HPP
+#include "RST.hpp"
+#include <utility>
+
+
+/******************************************************************************
+struct Interval
+
+Description: Creates an Interval, the closed range of every x with
+    low <= x <= high. Intervals are ordered by low and then by high, so
+    intervals starting together are all kept
+
+Data Fields:
+    low (T)   - the first point of the interval
+    high (T)  - the last point of the interval
+******************************************************************************/
+template<typename T>
+struct Interval {
+  T low;
+  T high;
+};
+
+template<typename T>
+struct IntervalOrder {
+  bool operator()(const Interval<T>& a, const Interval<T>& b) const {
+    return a.low < b.low || (!(b.low < a.low) && a.high < b.high);
+  }
+};
+
+
+/******************************************************************************
+struct IntervalEnd
+
+Description: Creates an IntervalEnd, the aggregate policy of an IntervalRST.
+    The summary of a subtree points at the latest high of its intervals, or
+    is nullptr for no intervals. Nodes never move, so the pointer stays good
+    for as long as the node, and T needs nothing more than operator<
+******************************************************************************/
+template<typename T>
+struct IntervalEnd {
+  typedef const T* Value;
+
+  static Value identity() { return nullptr; }
+  static Value of(const Interval<T>& item) { return &item.high; }
+  static Value combine(Value a, Value b) {
+    return !a || (b && *a < *b) ? b : a;
+  }
+};
+
+
+/******************************************************************************
+class IntervalRST
+
+Description: Creates an IntervalRST, an interval tree whose intervals are
+    ordered by their low points in an RST. Through the aggregate policy
+    IntervalEnd every node knows the latest high below it, kept up to date
+    by the rotations of RST. A query skips every subtree whose latest high
+    comes before the range and stops going right at the first low after it,
+    so it visits only the paths down to the intervals it reports: O(log n)
+    nodes when nothing overlaps, and never more than O(log n) per interval
+    found
+
+Template Parameters:
+    T     - the type of the points, which only needs operator<
+    Alloc - the allocator creating and destroying our nodes
+
+Data Fields:
+    tree (Tree) - the RST holding our intervals
+
+Public functions:
+    IntervalRST - constructor for IntervalRST
+    insert      - inserts an interval if it is not there yet
+    erase       - removes an interval
+    contains    - checks if an interval is in our IntervalRST
+    overlapping - finds every interval overlapping a range
+    containing  - finds every interval containing a point
+    size        - gives the number of intervals
+    empty       - checks to see if our IntervalRST is empty
+    clear       - removes every interval
+    begin       - creates iterator pointing to the first interval
+    end         - creates iterator pointing past the last interval
+******************************************************************************/
+template<typename T, template<typename> class Alloc = NodePool>
+class IntervalRST {
+
+  typedef AggregateNode<Interval<T>, IntervalEnd<T> > Node;
+
+  /** Our RST, opening up the root the queries start from */
+  struct Tree : public RST<Interval<T>, Alloc, IntervalOrder<T>, Xoshiro256,
+                           IntervalEnd<T> > {
+    using RST<Interval<T>, Alloc, IntervalOrder<T>, Xoshiro256,
+              IntervalEnd<T> >::root;
+  };
+
+  Tree tree;
+
+public:
+
+  typedef Interval<T> value_type;
+  typedef typename Tree::iterator iterator;
+
+  IntervalRST() {  }
+
+
+  /****************************************************************************
+  Function Name:  insert
+  Purpose:        This function inserts an interval
+  Input:          low:  the first point of the interval
+                  high: the last point of the interval, not before low
+  Result:         true if the interval was inserted
+                  false if it was already in our IntervalRST
+  ****************************************************************************/
+  bool insert(const T& low, const T& high) {
+    return tree.insert(value_type{low, high});
+  }
+
+  bool erase(const T& low, const T& high) {
+    return tree.erase(value_type{low, high});
+  }
+
+  bool contains(const T& low, const T& high) const {
+    return tree.find(value_type{low, high}) != tree.end();
+  }
+
+
+  /****************************************************************************
+  Function Name:  overlapping
+  Purpose:        This function finds the intervals overlapping a range
+  Description:    This function calls collect from the root, which writes the
+                  intervals in order
+  Input:          low:  the first point of the range
+                  high: the last point of the range
+                  out:  receives every interval sharing a point with the range
+  Result:         Returns out advanced past the last interval written
+  ****************************************************************************/
+  template<typename OutIterator>
+  OutIterator overlapping(const T& low, const T& high, OutIterator out) const {
+    collect(tree.root, low, high, out);
+    return out;
+  }
+
+  /** Finds every interval containing point, like overlapping a single point */
+  template<typename OutIterator>
+  OutIterator containing(const T& point, OutIterator out) const {
+    return overlapping(point, point, out);
+  }
+
+  unsigned int size() const {
+    return tree.size();
+  }
+
+  bool empty() const {
+    return tree.empty();
+  }
+
+  void clear() {
+    tree.clear();
+  }
+
+  iterator begin() const {
+    return tree.begin();
+  }
+
+  iterator end() const {
+    return tree.end();
+  }
+
+private:
+
+
+  /****************************************************************************
+  Function Name:  collect
+  Purpose:        This function finds the intervals of a subtree overlapping
+                  a range
+  Description:    A subtree whose latest high comes before low holds nothing
+                  overlapping the range. Otherwise the left subtree is
+                  searched first, and unless t starts after high, t and its
+                  right subtree follow. Every interval to the right starts
+                  after t, so once t starts after high they can all be
+                  skipped
+  Input:          t:    the root of the subtree
+                  low:  the first point of the range
+                  high: the last point of the range
+                  out:  receives the intervals found, in order
+  Result:         out is advanced past every interval below t overlapping
+                  the range
+  ****************************************************************************/
+  template<typename OutIterator>
+  static void collect(const BSTNode<value_type>* t, const T& low,
+                      const T& high, OutIterator& out) {
+
+    /* While loop is executed while t may hold an overlapping interval */
+    while (t) {
+      const T* latest = Node::totalOf(t);
+
+      /* If statement is executed when every interval below t ends too soon */
+      if (*latest < low)
+        return;
+
+      collect(t -> left, low, high, out);
+
+      /* If statement is executed when t and everything after it start too
+       * late */
+      if (high < t -> data.low)
+        return;
+
+      if (!(t -> data.high < low))
+        *out++ = t -> data;
+
+      t = t -> right;
+    }
+  }
+};
+
+#endif // INTERVALRST_HPP
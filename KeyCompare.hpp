@@ -0,0 +1,159 @@
+/******************************************************************************
+
+File Name:    KeyCompare.hpp
+Description:  This program creates a class called KeyCompare, which wraps the
+              comparator of our trees and orders two keys with a single
+              comparison whenever the keys or the comparator allow it
+
+******************************************************************************/
+
+
+#ifndef KEYCOMPARE_HPP
+#define KEYCOMPARE_HPP
+#include "BSTStats.hpp"
+#include <functional>
+#include <type_traits>
+#include <utility>
+#if __cplusplus > 201703L && __has_include(<compare>)
+#include <compare>
+#include <concepts>
+#endif
+
+
+/** True if C is std::less of any type, which simply applies < */
+template<typename C>
+struct isStdLess : std::false_type {  };
+
+template<typename T>
+struct isStdLess< std::less<T> > : std::true_type {  };
+
+
+/** True if C has a member compare(a, b) ordering A against B in one call */
+template<typename C, typename A, typename B, typename = void>
+struct hasThreeWayComparator : std::false_type {  };
+
+template<typename C, typename A, typename B>
+struct hasThreeWayComparator<C, A, B, std::void_t<decltype(
+    int(std::declval<const C&>().compare(std::declval<const A&>(),
+                                         std::declval<const B&>())))> >
+    : std::true_type {  };
+
+
+/** True if a.compare(b) orders A against B, as std::string does */
+template<typename A, typename B, typename = void>
+struct hasCompareMember : std::false_type {  };
+
+template<typename A, typename B>
+struct hasCompareMember<A, B, std::void_t<decltype(
+    int(std::declval<const A&>().compare(std::declval<const B&>())))> >
+    : std::true_type {  };
+
+
+/******************************************************************************
+class KeyCompare
+
+Description: Creates a KeyCompare, the comparator of a tree. less simply calls
+    Compare. order tells whether a is less than, equal to or greater than b,
+    which a search needs at every level. Asking Compare twice would cost two
+    comparisons, so order uses the first of these that exists:
+
+      - a member compare(a, b) of Compare, for three-way comparators
+      - a.compare(b), when Compare is std::less and the keys provide it,
+        like std::string and std::string_view do
+      - a <=> b, when Compare is std::less and we are compiled as C++20
+      - less(a, b) followed by less(b, a) otherwise
+
+    A compare member of the keys must order them the same way as <. With
+    BST_STATS every call of the comparator is counted
+
+Data Fields:
+    comp (Compare)                - the comparator of our tree
+    calls (StatCounter)           - the calls of comp, only with BST_STATS
+
+Public functions:
+    KeyCompare - constructor for KeyCompare
+    less       - checks if a is less than b
+    order      - compares a and b once, returning a negative, zero or
+                 positive int
+    get        - gives the wrapped comparator
+    count      - gives the number of calls of comp, only with BST_STATS
+    resetCount - sets the number of calls back to zero, only with BST_STATS
+    addCount   - adds calls made by another comparator, only with BST_STATS
+******************************************************************************/
+template<typename Compare>
+class KeyCompare {
+
+  Compare comp;
+  BST_STAT(mutable StatCounter calls;)
+
+public:
+
+  KeyCompare(const Compare& comp = Compare()) : comp(comp) {  }
+
+  template<typename A, typename B>
+  bool less(const A& a, const B& b) const {
+    BST_STAT(++calls;)
+    return comp(a, b);
+  }
+
+
+  /****************************************************************************
+  Function Name:  order
+  Purpose:        This function orders two keys
+  Description:    This function picks the cheapest way to compare a and b at
+                  compile time, as described above
+  Input:          a:  the first key
+                  b:  the second key
+  Result:         Returns a negative int if a comes before b, zero if they
+                  are equivalent and a positive int if a comes after b
+  ****************************************************************************/
+  template<typename A, typename B>
+  int order(const A& a, const B& b) const {
+    BST_STAT(++calls;)
+
+    if constexpr (hasThreeWayComparator<Compare, A, B>::value)
+      return comp.compare(a, b);
+
+    else if constexpr (isStdLess<Compare>::value &&
+                       hasCompareMember<A, B>::value)
+      return a.compare(b);
+
+#if __cplusplus > 201703L && defined(__cpp_lib_three_way_comparison)
+    else if constexpr (isStdLess<Compare>::value &&
+                       std::three_way_comparable_with<A, B>) {
+      auto c = a <=> b;
+      return c < 0 ? -1 : (c > 0 ? 1 : 0);
+    }
+#endif
+
+    else {
+
+      /* If statement is executed when a comes first, settled in one call */
+      if (comp(a, b))
+        return -1;
+
+      BST_STAT(++calls;)
+      return comp(b, a) ? 1 : 0;
+    }
+  }
+
+  const Compare& get() const {
+    return comp;
+  }
+
+#ifdef BST_STATS
+  unsigned long long count() const {
+    return calls.load();
+  }
+
+  void resetCount() {
+    calls = 0;
+  }
+
+  void addCount(unsigned long long n) {
+    calls += n;
+  }
+#endif
+};
+
+#endif // KEYCOMPARE_HPP
@@ -0,0 +1,452 @@
+/******************************************************************************
+
+File Name:    NodePool.hpp
+Description:  This program creates the node allocators used by our BST and
+              RST classes. NodePool hands out nodes from contiguous blocks and
+              recycles them through a free list, while HeapAllocator simply
+              calls new and delete for every node
+
+******************************************************************************/
+
+
+#ifndef NODEPOOL_HPP
+#define NODEPOOL_HPP
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+
+/******************************************************************************
+class NodePool
+
+Description: Creates a slab allocator for nodes. Nodes are carved out of
+    blocks that hold many nodes next to each other, so a tree built from a
+    NodePool is far less scattered across the heap. Destroyed nodes are kept
+    on a free list and reused by the next create.
+
+    The blocks live in Arenas. Every NodePool adds the blocks it allocates to
+    an Arena of its own, and keeps a reference to every other Arena its
+    nodes may have come from. Trees produced by splitting one tree share its
+    Arenas through share, and absorb hands the Arenas of another NodePool
+    over when their trees are merged. An Arena is freed once the last
+    NodePool referring to it lets go, and the count of those is the only
+    thing NodePools share. Free lists and the newest block are kept by each
+    NodePool alone, so two trees sharing blocks may create and destroy nodes
+    on different threads at the same time
+
+Data Fields:
+    own (shared_ptr<Arena>)          - the Arena our new blocks go into, or
+                                       nullptr before we allocate a block
+    kept (vector<shared_ptr<Arena>>) - the other Arenas holding our nodes
+    freeList (Slot*)                 - the most recently destroyed slot
+    freeTail (Slot*)                 - the last slot on the free list
+    block (Slot*)                    - the block we take unused slots from
+    next (std::size_t)               - the next unused slot of block
+    blockSize (std::size_t)          - the number of slots in block
+
+Public functions:
+    NodePool  - constructor for NodePool
+    ~NodePool - destructor for NodePool
+    create    - constructs a node in a free slot
+    destroy   - destructs a node and puts its slot on the free list
+    reserve   - makes room for many nodes in one block
+    share     - creates another NodePool using the same blocks
+    absorb    - joins the blocks of another NodePool with our own
+    sole      - checks if no other NodePool uses our blocks
+    release   - lets go of our blocks, freeing them if we are the last user
+******************************************************************************/
+template<typename Node>
+class NodePool {
+
+  /** A slot either holds a live node or links to the next free slot */
+  union Slot {
+    Slot* nextFree;
+    alignas(Node) unsigned char storage[sizeof(Node)];
+  };
+
+  /** The number of slots in the first block and the largest block */
+  static const std::size_t FIRST_BLOCK = 32;
+  static const std::size_t MAX_BLOCK = 4096;
+
+  /** Blocks owned together by every NodePool referring to them. Only the
+   *  NodePool whose own Arena it is adds blocks, and the blocks are freed
+   *  when the last reference goes */
+  struct Arena {
+    std::vector<Slot*> blocks;
+
+    ~Arena() {
+      for (std::size_t i = 0; i < blocks.size(); ++i)
+        delete[] blocks[i];
+    }
+  };
+
+  std::shared_ptr<Arena> own;
+  std::vector< std::shared_ptr<Arena> > kept;
+  Slot* freeList;
+  Slot* freeTail;
+  Slot* block;
+  std::size_t next;
+  std::size_t blockSize;
+
+  void push(Slot* slot) {
+    slot -> nextFree = freeList;
+    if (!freeList)
+      freeTail = slot;
+    freeList = slot;
+  }
+
+  /** Allocates a block of size slots in our own Arena and takes slots from
+   *  it next */
+  void allocate(std::size_t size) {
+
+    /* If statement is executed when we have no Arena of our own yet */
+    if (!own)
+      own = std::make_shared<Arena>();
+
+    own -> blocks.reserve(own -> blocks.size() + 1);
+    own -> blocks.push_back(new Slot[size]);
+    block = own -> blocks.back();
+    blockSize = size;
+    next = 0;
+  }
+
+  /** Keeps a reference to a, unless we refer to it already */
+  void keep(std::shared_ptr<Arena>&& a) {
+    if (!a || a == own)
+      return;
+
+    for (std::size_t i = 0; i < kept.size(); ++i)
+      if (kept[i] == a)
+        return;
+
+    kept.push_back(std::move(a));
+  }
+
+public:
+
+  /** NodePool frees its blocks in one pass, so a tree whose nodes need no
+   *  destructor may skip visiting every node before calling release */
+  static const bool bulkRelease = true;
+
+
+  /****************************************************************************
+  Function Name:  NodePool
+  Purpose:        This function initializes an empty NodePool
+  Description:    No block is allocated until the first node is created
+  Result:         An empty NodePool is created
+  ****************************************************************************/
+  NodePool() : freeList(nullptr), freeTail(nullptr), block(nullptr), next(0),
+               blockSize(0) {  }
+
+  NodePool(const NodePool&) = delete;
+  NodePool& operator=(const NodePool&) = delete;
+
+
+  /****************************************************************************
+  Function Name:  NodePool
+  Purpose:        This function moves a NodePool
+  Description:    This function takes over the Arenas, free list and newest
+                  block of other, leaving other empty
+  Input:          other:  the NodePool we are taking the blocks of
+  Result:         A NodePool using the blocks of other
+  ****************************************************************************/
+  NodePool(NodePool&& other) noexcept : NodePool() {
+    swap(other);
+  }
+
+
+  /****************************************************************************
+  Function Name:  operator=
+  Purpose:        This function move assigns a NodePool
+  Description:    This function lets go of our own blocks and takes over the
+                  blocks of other
+  Input:          other:  the NodePool we are taking the blocks of
+  Result:         Returns this NodePool
+  ****************************************************************************/
+  NodePool& operator=(NodePool&& other) noexcept {
+    if (this != &other) {
+      release();
+      swap(other);
+    }
+    return *this;
+  }
+
+
+  /****************************************************************************
+  Function Name:  ~NodePool
+  Purpose:        This function deconstructs our NodePool
+  Description:    This function calls release. Nodes still living in the
+                  blocks are not destructed
+  Result:         Our blocks are freed if no other NodePool uses them
+  ****************************************************************************/
+  ~NodePool() {
+    release();
+  }
+
+
+  /****************************************************************************
+  Function Name:  create
+  Purpose:        This function constructs a node
+  Description:    This function takes a slot from the free list if one is
+                  available, otherwise the next unused slot of our newest
+                  block. A new, larger block is allocated when the newest
+                  block is full. The node is then constructed in the slot
+  Input:          args: the arguments passed on to the constructor of Node
+  Result:         Returns a pointer to the constructed node
+  ****************************************************************************/
+  template<typename... Args>
+  Node* create(Args&&... args) {
+    Slot* slot;
+
+    /* If statement is executed when a destroyed slot can be reused */
+    if (freeList) {
+      slot = freeList;
+      freeList = slot -> nextFree;
+      if (!freeList)
+        freeTail = nullptr;
+    }
+
+    else {
+
+      /* If statement is executed when the newest block is full */
+      if (next == blockSize) {
+        std::size_t size = blockSize ? blockSize * 2 : FIRST_BLOCK;
+        if (size > MAX_BLOCK)
+          size = MAX_BLOCK;
+        allocate(size);
+      }
+      slot = block + next++;
+    }
+
+    /* We put the slot back on the free list if the constructor throws */
+    try {
+      return new (slot -> storage) Node(std::forward<Args>(args)...);
+    }
+    catch (...) {
+      push(slot);
+      throw;
+    }
+  }
+
+
+  /****************************************************************************
+  Function Name:  destroy
+  Purpose:        This function destructs a node
+  Description:    This function calls the destructor of n and pushes its slot
+                  onto our free list so our next create can reuse it
+  Input:          n:  the node we are destroying, which must come from our
+                      blocks or from blocks we absorb before they are freed
+  Result:         n is destructed and its memory is ready for reuse
+  ****************************************************************************/
+  void destroy(Node* n) {
+    n -> ~Node();
+    push(reinterpret_cast<Slot*>(n));
+  }
+
+
+  /****************************************************************************
+  Function Name:  reserve
+  Purpose:        This function makes room for a number of nodes
+  Description:    This function allocates one block large enough for count
+                  nodes unless our newest block already has that many unused
+                  slots, so nodes created next lie next to each other in
+                  memory. The unused slots of a block that is too small are
+                  put on the free list
+  Input:          count:  the number of nodes about to be created
+  Result:         The next count nodes can be created without allocating
+  ****************************************************************************/
+  void reserve(std::size_t count) {
+
+    /* If statement is executed when the newest block has enough room */
+    if (blockSize - next >= count)
+      return;
+
+    for (; next < blockSize; ++next)
+      push(block + next);
+
+    allocate(count);
+  }
+
+
+  /****************************************************************************
+  Function Name:  share
+  Purpose:        This function creates another NodePool using our blocks
+  Description:    This function hands out a NodePool referring to every
+                  Arena of ours, with an empty free list. It allocates its
+                  blocks into an Arena of its own, so neither NodePool ever
+                  touches what the other changes
+  Result:         Returns a NodePool sharing our blocks
+  ****************************************************************************/
+  NodePool share() {
+    NodePool other;
+    other.kept = kept;
+    if (own)
+      other.kept.push_back(own);
+    return other;
+  }
+
+
+  /****************************************************************************
+  Function Name:  absorb
+  Purpose:        This function joins the blocks of other with our own
+  Description:    This function takes over every Arena of other we do not
+                  refer to yet, along with its free list and the unused slots
+                  of its newest block. The own Arena of other joins our own
+                  when no other NodePool refers to it, so merging trees back
+                  together keeps the number of Arenas small. Afterwards we
+                  may destroy nodes created by other, and other is empty
+  Input:          other:  the NodePool whose blocks we are joining with ours
+  Result:         We use the blocks of both NodePools
+  ****************************************************************************/
+  void absorb(NodePool& other) {
+
+    /* If statement is executed when other is us */
+    if (this == &other)
+      return;
+
+    /* The unused slots of the newest block of other go on our free list */
+    for (std::size_t i = other.next; i < other.blockSize; ++i)
+      push(other.block + i);
+
+    /* We put the free list of other in front of ours */
+    if (other.freeList) {
+      other.freeTail -> nextFree = freeList;
+      if (!freeList)
+        freeTail = other.freeTail;
+      freeList = other.freeList;
+    }
+
+    /* If statement is executed when only other refers to its own Arena,
+     * whose blocks then simply become ours */
+    if (other.own && other.own.use_count() == 1) {
+      if (!own)
+        own = std::move(other.own);
+
+      else {
+        std::vector<Slot*>& blocks = other.own -> blocks;
+        own -> blocks.insert(own -> blocks.end(), blocks.begin(),
+                             blocks.end());
+        blocks.clear();
+        other.own.reset();
+      }
+    }
+
+    keep(std::move(other.own));
+    for (std::size_t i = 0; i < other.kept.size(); ++i)
+      keep(std::move(other.kept[i]));
+
+    other.kept.clear();
+    other.own.reset();
+    other.freeList = other.freeTail = other.block = nullptr;
+    other.next = other.blockSize = 0;
+  }
+
+
+  /****************************************************************************
+  Function Name:  sole
+  Purpose:        This function checks if no other NodePool uses our blocks
+  Result:         true if we are the only NodePool using our blocks
+                  false if another NodePool uses them too
+  ****************************************************************************/
+  bool sole() const {
+    if (own && own.use_count() != 1)
+      return false;
+
+    for (std::size_t i = 0; i < kept.size(); ++i)
+      if (kept[i].use_count() != 1)
+        return false;
+
+    return true;
+  }
+
+
+  /****************************************************************************
+  Function Name:  release
+  Purpose:        This function lets go of our blocks
+  Description:    This function drops our references to our Arenas. Each
+                  Arena returns its blocks to the heap at once, without
+                  looking at the nodes inside them, when its last NodePool
+                  lets go. Any node that needs its destructor called must be
+                  destroyed before calling release
+  Result:         An empty NodePool
+  ****************************************************************************/
+  void release() {
+    own.reset();
+    kept.clear();
+    freeList = freeTail = block = nullptr;
+    next = blockSize = 0;
+  }
+
+
+  /****************************************************************************
+  Function Name:  swap
+  Purpose:        This function swaps the blocks of two NodePools
+  Input:          other:  the NodePool we are swapping with
+  Result:         Each pool uses the blocks of the other
+  ****************************************************************************/
+  void swap(NodePool& other) noexcept {
+    own.swap(other.own);
+    kept.swap(other.kept);
+    std::swap(freeList, other.freeList);
+    std::swap(freeTail, other.freeTail);
+    std::swap(block, other.block);
+    std::swap(next, other.next);
+    std::swap(blockSize, other.blockSize);
+  }
+};
+
+
+/******************************************************************************
+class HeapAllocator
+
+Description: Creates an allocator which calls new and delete for every node.
+    This is how our trees allocated their nodes before NodePool existed, and
+    it is kept as a baseline for comparison. Since every node is its own
+    allocation, sharing and joining HeapAllocators needs no work
+
+Public functions:
+    create  - allocates and constructs a node with new
+    destroy - deletes a node
+    reserve - does nothing
+    share   - returns another HeapAllocator
+    absorb  - does nothing
+    sole    - always false, since nodes are never freed in bulk
+    release - does nothing, since every node is deleted on its own
+******************************************************************************/
+template<typename Node>
+class HeapAllocator {
+
+public:
+
+  /** Every node must be deleted on its own before calling release */
+  static const bool bulkRelease = false;
+
+  template<typename... Args>
+  Node* create(Args&&... args) {
+    return new Node(std::forward<Args>(args)...);
+  }
+
+  void destroy(Node* n) {
+    delete n;
+  }
+
+  void reserve(std::size_t) {  }
+
+  HeapAllocator share() {
+    return HeapAllocator();
+  }
+
+  void absorb(HeapAllocator&) {  }
+
+  bool sole() const {
+    return false;
+  }
+
+  void release() {  }
+
+  void swap(HeapAllocator&) noexcept {  }
+};
+
+#endif // NODEPOOL_HPP
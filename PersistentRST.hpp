@@ -0,0 +1,478 @@
+/******************************************************************************
+
+File Name:    PersistentRST.hpp
+Description:  This program creates a class called PersistentRST, a randomized
+              search tree whose versions are never modified. Inserting or
+              erasing creates a new version sharing every untouched node with
+              the old one, so snapshots cost nothing to take or keep
+
+******************************************************************************/
+
+
+#ifndef PERSISTENTRST_HPP
+#define PERSISTENTRST_HPP
+#include "Priority.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+
+/******************************************************************************
+class PersistentRST
+
+Description: Creates a PersistentRST, a handle on one immutable version of a
+    randomized search tree. insert and erase leave this version alone and
+    return a new one. Only the nodes on the path from the root to the changed
+    item are copied, and rotations are only ever applied to those fresh
+    copies, so the new version shares all other nodes with the old one.
+
+    Nodes have no parent pointers, since a shared node has a different parent
+    in every version. Instead each node counts the versions and nodes
+    referring to it, and is deleted once that count drops to zero. The counts
+    are atomic, so readers on other threads may copy and drop versions while
+    a writer creates new ones.
+
+    Every version carries the state of its own Xoshiro256. insert draws the
+    priority of the new node from a copy of it and hands the copy on to the
+    new version, so no state is shared between threads and no version is
+    ever changed
+
+Data Fields:
+    root (Node*)               - the root of this version, or nullptr if empty
+    isize (unsigned int)       - the number of items in this version
+    priorities (Xoshiro256)    - the source of priorities for new versions
+
+Public functions:
+    PersistentRST  - constructor for an empty version, or a copy of a version
+    ~PersistentRST - destructor for PersistentRST
+    snapshot       - returns a handle on this version in O(1)
+    seed           - restarts the priorities of versions made from ours
+    insert         - returns a new version with an item added
+    erase          - returns a new version with an item removed
+    find           - finds an item in this version
+    size           - gives the number of items in this version
+    empty          - checks to see if this version is empty
+    begin          - creates iterator pointing to the first item
+    end            - creates iterator pointing past the last item
+******************************************************************************/
+template<typename Data>
+class PersistentRST {
+
+  /** A node shared by every version that can reach it */
+  struct Node {
+    Node(const Data& d, std::uint64_t p, Node* l, Node* r)
+        : left(l), right(r), priority(p), refs(1), data(d) {  }
+
+    Node* left;
+    Node* right;
+    std::uint64_t priority;
+    std::atomic<unsigned int> refs;   // versions and nodes referring to us
+    Data const data;
+  };
+
+  Node* root;
+  unsigned int isize;
+  Xoshiro256 priorities;
+
+  PersistentRST(Node* root, unsigned int isize, const Xoshiro256& priorities)
+      : root(root), isize(isize), priorities(priorities) {  }
+
+public:
+
+
+  /****************************************************************************
+  class iterator
+
+  Description: Walks a version in order. Without parent pointers, the
+      iterator keeps the path of nodes whose items are still to be visited
+  ****************************************************************************/
+  class iterator {
+    std::vector<const Node*> path;
+
+    friend class PersistentRST;
+
+    /** Pushes n and its left spine, the next items to visit */
+    void descend(const Node* n) {
+      for (; n; n = n -> left)
+        path.push_back(n);
+    }
+
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef Data value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const Data* pointer;
+    typedef const Data& reference;
+
+    const Data& operator*() const {
+      return path.back() -> data;
+    }
+
+    const Data* operator->() const {
+      return &path.back() -> data;
+    }
+
+    iterator& operator++() {
+      const Node* n = path.back();
+      path.pop_back();
+      descend(n -> right);
+      return *this;
+    }
+
+    iterator operator++(int) {
+      iterator before = *this;
+      ++(*this);
+      return before;
+    }
+
+    bool operator==(const iterator& other) const {
+      return path.empty() ? other.path.empty() :
+             !other.path.empty() && path.back() == other.path.back();
+    }
+
+    bool operator!=(const iterator& other) const {
+      return !(*this == other);
+    }
+  };
+
+
+  /****************************************************************************
+  Function Name:  PersistentRST
+  Purpose:        This function initializes an empty version
+  Result:         An empty PersistentRST is created
+  ****************************************************************************/
+  PersistentRST() : root(nullptr), isize(0) {  }
+
+
+  /****************************************************************************
+  Function Name:  PersistentRST
+  Purpose:        This function copies a version
+  Description:    This function shares the root of other, so it takes O(1)
+                  time no matter how large the version is
+  Input:          other:  the version we are copying
+  Result:         A handle on the same version as other
+  ****************************************************************************/
+  PersistentRST(const PersistentRST& other)
+      : root(retain(other.root)), isize(other.isize),
+        priorities(other.priorities) {  }
+
+  PersistentRST(PersistentRST&& other) noexcept
+      : root(other.root), isize(other.isize), priorities(other.priorities) {
+    other.root = nullptr;
+    other.isize = 0;
+  }
+
+
+  /****************************************************************************
+  Function Name:  operator=
+  Purpose:        This function makes our handle refer to another version
+  Input:          other:  the version we are switching to
+  Result:         Returns this PersistentRST
+  ****************************************************************************/
+  PersistentRST& operator=(PersistentRST other) {
+    std::swap(root, other.root);
+    std::swap(isize, other.isize);
+    std::swap(priorities, other.priorities);
+    return *this;
+  }
+
+
+  /****************************************************************************
+  Function Name:  ~PersistentRST
+  Purpose:        This function drops our handle on a version
+  Description:    This function releases our root. Nodes no other version
+                  can reach are deleted
+  Result:         Our version is freed if no one else refers to it
+  ****************************************************************************/
+  ~PersistentRST() {
+    release(root);
+  }
+
+
+  /****************************************************************************
+  Function Name:  snapshot
+  Purpose:        This function returns a handle on this version
+  Description:    Since versions never change, a snapshot is simply a copy of
+                  our handle, which takes O(1) time
+  Result:         Returns a PersistentRST for this version
+  ****************************************************************************/
+  PersistentRST snapshot() const {
+    return *this;
+  }
+
+
+  /****************************************************************************
+  Function Name:  seed
+  Purpose:        This function restarts the priorities of new versions
+  Description:    The versions made from ours, and the ones made from them,
+                  then take their priorities from the sequence of s, so the
+                  same inserts give the same shapes
+  Input:          s:  the seed of the sequence
+  Result:         Our handle holds a freshly seeded Xoshiro256
+  ****************************************************************************/
+  void seed(std::uint64_t s) {
+    priorities.seed(s);
+  }
+
+
+  /****************************************************************************
+  Function Name:  insert
+  Purpose:        This function creates a version with an item added
+  Description:    This function copies the nodes on the path to where item
+                  belongs, adds item as a leaf with the next priority of a
+                  copy of our Xoshiro256 and rotates it up through the copies
+                  until the treap property holds. The new version keeps the
+                  advanced copy. Our version is not changed
+  Input:          item: the data we are adding
+  Result:         Returns the new version, or this version if item was
+                  already in it
+  ****************************************************************************/
+  PersistentRST insert(const Data& item) const {
+    bool inserted = false;
+    Xoshiro256 next = priorities;
+    Node* n = insertNode(root, item, next(), inserted);
+
+    /* If statement is executed when item was already in our version */
+    if (!inserted)
+      return *this;
+
+    return PersistentRST(n, isize + 1, next);
+  }
+
+
+  /****************************************************************************
+  Function Name:  erase
+  Purpose:        This function creates a version with an item removed
+  Description:    This function copies the nodes on the path to item and
+                  replaces the node of item by the join of its subtrees, which
+                  copies the nodes on the inner spines of those subtrees. Our
+                  version is not changed
+  Input:          item: the data we are removing
+  Result:         Returns the new version, or this version if item was not
+                  in it
+  ****************************************************************************/
+  PersistentRST erase(const Data& item) const {
+    bool erased = false;
+    Node* n = eraseNode(root, item, erased);
+
+    /* If statement is executed when item was not in our version */
+    if (!erased)
+      return *this;
+
+    return PersistentRST(n, isize - 1, priorities);
+  }
+
+
+  /****************************************************************************
+  Function Name:  find
+  Purpose:        This function finds an item in this version
+  Description:    This function walks down from root, remembering the nodes
+                  where it went left so the iterator can continue from there
+  Input:          item: the data we are looking for
+  Result:         Returns an iterator to item, or end() if it is not found
+  ****************************************************************************/
+  iterator find(const Data& item) const {
+    iterator it;
+
+    for (const Node* n = root; n; ) {
+      if (item < n -> data) {
+        it.path.push_back(n);
+        n = n -> left;
+      }
+
+      else if (n -> data < item)
+        n = n -> right;
+
+      else {
+        it.path.push_back(n);
+        return it;
+      }
+    }
+
+    return end();
+  }
+
+
+  unsigned int size() const {
+    return isize;
+  }
+
+  bool empty() const {
+    return !root;
+  }
+
+  iterator begin() const {
+    iterator it;
+    it.descend(root);
+    return it;
+  }
+
+  iterator end() const {
+    return iterator();
+  }
+
+private:
+
+
+  /****************************************************************************
+  Function Name:  retain
+  Purpose:        This function adds a reference to a node
+  Input:          n:  the node, or nullptr
+  Result:         Returns n
+  ****************************************************************************/
+  static Node* retain(Node* n) {
+    if (n)
+      n -> refs.fetch_add(1, std::memory_order_relaxed);
+    return n;
+  }
+
+
+  /****************************************************************************
+  Function Name:  release
+  Purpose:        This function drops a reference to a node
+  Description:    This function deletes n once nothing refers to it, which in
+                  turn drops the references n held on its children
+  Input:          n:  the node, or nullptr
+  Result:         n is deleted if it became unreachable
+  ****************************************************************************/
+  static void release(Node* n) {
+
+    /* While loop is executed while the last reference to n was dropped */
+    while (n && n -> refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      Node* right = n -> right;
+      release(n -> left);
+      delete n;
+      n = right;
+    }
+  }
+
+
+  /****************************************************************************
+  Function Name:  insertNode
+  Purpose:        This function adds an item below a node
+  Description:    This function works on a borrowed node and returns a new
+                  node owned by the caller. Copies are fresh and referred to
+                  by nothing else, so rotating them in place is safe
+  Input:          t:        the root of the subtree, which is not changed
+                  item:     the data we are adding
+                  priority: the priority of the new node
+                  inserted: set to true if item was added
+  Result:         Returns the root of the new subtree, or nullptr if item was
+                  already below t
+  ****************************************************************************/
+  static Node* insertNode(Node* t, const Data& item, std::uint64_t priority,
+                          bool& inserted) {
+
+    /* If statement is executed when item becomes a leaf here */
+    if (!t) {
+      inserted = true;
+      return new Node(item, priority, nullptr, nullptr);
+    }
+
+    /* If statement is executed when item belongs in the left subtree */
+    if (item < t -> data) {
+      Node* left = insertNode(t -> left, item, priority, inserted);
+      if (!inserted)
+        return nullptr;
+
+      Node* copy = new Node(t -> data, t -> priority, left,
+                            retain(t -> right));
+
+      /* If statement is executed when left must be rotated above copy */
+      if (left -> priority < copy -> priority) {
+        copy -> left = left -> right;
+        left -> right = copy;
+        return left;
+      }
+      return copy;
+    }
+
+    /* Else if statement is executed when item belongs in the right subtree */
+    else if (t -> data < item) {
+      Node* right = insertNode(t -> right, item, priority, inserted);
+      if (!inserted)
+        return nullptr;
+
+      Node* copy = new Node(t -> data, t -> priority, retain(t -> left),
+                            right);
+
+      /* If statement is executed when right must be rotated above copy */
+      if (right -> priority < copy -> priority) {
+        copy -> right = right -> left;
+        right -> left = copy;
+        return right;
+      }
+      return copy;
+    }
+
+    return nullptr;
+  }
+
+
+  /****************************************************************************
+  Function Name:  eraseNode
+  Purpose:        This function removes an item below a node
+  Input:          t:      the root of the subtree, which is not changed
+                  item:   the data we are removing
+                  erased: set to true if item was found
+  Result:         Returns the root of the new subtree, owned by the caller
+  ****************************************************************************/
+  static Node* eraseNode(Node* t, const Data& item, bool& erased) {
+
+    /* If statement is executed when item is not below t */
+    if (!t)
+      return nullptr;
+
+    /* If statement is executed when item is in the left subtree */
+    if (item < t -> data) {
+      Node* left = eraseNode(t -> left, item, erased);
+      if (!erased)
+        return nullptr;
+      return new Node(t -> data, t -> priority, left, retain(t -> right));
+    }
+
+    /* Else if statement is executed when item is in the right subtree */
+    else if (t -> data < item) {
+      Node* right = eraseNode(t -> right, item, erased);
+      if (!erased)
+        return nullptr;
+      return new Node(t -> data, t -> priority, retain(t -> left), right);
+    }
+
+    erased = true;
+    return joinNodes(t -> left, t -> right);
+  }
+
+
+  /****************************************************************************
+  Function Name:  joinNodes
+  Purpose:        This function joins two borrowed subtrees
+  Description:    This function copies the nodes on the right spine of left
+                  and the left spine of right that are merged by priority,
+                  and shares every other node
+  Input:          left:   the subtree holding the smaller items
+                  right:  the subtree holding the larger items
+  Result:         Returns the root of the joined subtree, owned by the caller
+  ****************************************************************************/
+  static Node* joinNodes(Node* left, Node* right) {
+
+    /* If statement is executed when either subtree does not exist */
+    if (!left)
+      return retain(right);
+
+    if (!right)
+      return retain(left);
+
+    /* If statement is executed when left becomes the root */
+    if (left -> priority < right -> priority)
+      return new Node(left -> data, left -> priority, retain(left -> left),
+                      joinNodes(left -> right, right));
+
+    return new Node(right -> data, right -> priority,
+                    joinNodes(left, right -> left), retain(right -> right));
+  }
+};
+
+#endif // PERSISTENTRST_HPP
@@ -0,0 +1,247 @@
+/******************************************************************************
+
+File Name:    Priority.hpp
+Description:  This program creates the priority sources of an RST: small
+              random number generators, each owned by one tree, which hand
+              out the priorities of new nodes, and a hash of the items
+              which gives every set of items a single shape
+
+******************************************************************************/
+
+
+#ifndef PRIORITY_HPP
+#define PRIORITY_HPP
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <stdlib.h>
+
+
+/******************************************************************************
+Function Name:  splitmix64
+Purpose:        This function scrambles a 64-bit value
+Description:    This function advances state by a fixed odd constant and mixes
+                the result, so consecutive states give unrelated outputs. It
+                turns one seed into the full state of a larger generator
+Input:          state:  the state to advance
+Result:         Returns the next output of the sequence
+******************************************************************************/
+inline std::uint64_t splitmix64(std::uint64_t& state) {
+  std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+
+/******************************************************************************
+Function Name:  nextTreeSeed
+Purpose:        This function gives a seed to a tree that was not seeded
+Description:    This function numbers the trees in the order they are created
+                and scrambles the number, so every tree draws a different
+                sequence and a program creating its trees in the same order
+                gets the same shapes on every run
+Result:         Returns a seed for a new priority source
+******************************************************************************/
+inline std::uint64_t nextTreeSeed() {
+  static std::atomic<std::uint64_t> trees(0);
+  std::uint64_t state = trees.fetch_add(1, std::memory_order_relaxed);
+  return splitmix64(state);
+}
+
+
+/******************************************************************************
+class Xoshiro256
+
+Description: Creates a Xoshiro256, the xoshiro256** generator of Blackman and
+    Vigna. Its 256 bits of state are filled from the seed by splitmix64. Each
+    priority takes a few shifts, rotations and two multiplications, without
+    locks or shared state. This is the default priority source of RST
+
+Data Fields:
+    s (uint64_t[4]) - the state of the generator
+
+Public functions:
+    Xoshiro256 - constructor for Xoshiro256
+    seed       - restarts the sequence from a seed
+    fork       - creates a generator with an unrelated sequence
+    operator() - gives the next priority
+******************************************************************************/
+class Xoshiro256 {
+
+  std::uint64_t s[4];
+
+  static std::uint64_t rotl(std::uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+  }
+
+public:
+
+  explicit Xoshiro256(std::uint64_t seed = nextTreeSeed()) {
+    this -> seed(seed);
+  }
+
+  void seed(std::uint64_t seed) {
+    for (int i = 0; i < 4; ++i)
+      s[i] = splitmix64(seed);
+  }
+
+  Xoshiro256 fork() {
+    return Xoshiro256((*this)());
+  }
+
+  std::uint64_t operator()() {
+    std::uint64_t result = rotl(s[1] * 5, 7) * 9;
+    std::uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+  }
+};
+
+
+/******************************************************************************
+class WyRand
+
+Description: Creates a WyRand, the generator of Wang Yi's wyhash. It keeps a
+    single 64-bit counter and folds the 128-bit product of the counter with
+    itself, so it is the smallest and usually the fastest of our sources
+
+Data Fields:
+    state (uint64_t) - the counter of the generator
+
+Public functions:
+    WyRand     - constructor for WyRand
+    seed       - restarts the sequence from a seed
+    fork       - creates a generator with an unrelated sequence
+    operator() - gives the next priority
+******************************************************************************/
+class WyRand {
+
+  std::uint64_t state;
+
+  /** The high and low halves of a * b, xored together */
+  static std::uint64_t mum(std::uint64_t a, std::uint64_t b) {
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+    return static_cast<std::uint64_t>(r >> 64) ^ static_cast<std::uint64_t>(r);
+#else
+    std::uint64_t ha = a >> 32, hb = b >> 32;
+    std::uint64_t la = a & 0xFFFFFFFFull, lb = b & 0xFFFFFFFFull;
+    std::uint64_t hh = ha * hb, hl = ha * lb, lh = la * hb, ll = la * lb;
+    std::uint64_t mid = (ll >> 32) + (hl & 0xFFFFFFFFull) +
+                        (lh & 0xFFFFFFFFull);
+    std::uint64_t lo = (ll & 0xFFFFFFFFull) | (mid << 32);
+    std::uint64_t hi = hh + (hl >> 32) + (lh >> 32) + (mid >> 32);
+    return hi ^ lo;
+#endif
+  }
+
+public:
+
+  explicit WyRand(std::uint64_t seed = nextTreeSeed()) : state(seed) {  }
+
+  void seed(std::uint64_t seed) {
+    state = seed;
+  }
+
+  WyRand fork() {
+    return WyRand((*this)());
+  }
+
+  std::uint64_t operator()() {
+    state += 0xA0761D6478BD642Full;
+    return mum(state, state ^ 0xE7037ED1A0B428DBull);
+  }
+};
+
+
+/******************************************************************************
+class RandPriority
+
+Description: Creates a RandPriority, which takes priorities from rand() like
+    RST used to. rand() is shared by the whole program, takes a lock in
+    glibc and gives only 31 bits, so equal priorities grow common in large
+    trees. It is kept to compare against and to reproduce old shapes
+
+Public functions:
+    RandPriority - constructor for RandPriority
+    seed         - calls srand, reseeding rand() for the whole program
+    fork         - creates another RandPriority, sharing rand()
+    operator()   - gives the next priority
+******************************************************************************/
+class RandPriority {
+
+public:
+
+  RandPriority() {  }
+
+  explicit RandPriority(std::uint64_t seed) {
+    this -> seed(seed);
+  }
+
+  void seed(std::uint64_t seed) {
+    srand(static_cast<unsigned int>(seed));
+  }
+
+  RandPriority fork() {
+    return RandPriority();
+  }
+
+  std::uint64_t operator()() {
+    return static_cast<std::uint64_t>(rand());
+  }
+};
+
+
+/******************************************************************************
+class HashPriority
+
+Description: Creates a HashPriority, which derives the priority of a node
+    from its item: std::hash of the item, xored with the seed and mixed by
+    splitmix64. A treap with distinct priorities has exactly one shape for
+    its set of items, so trees with equal seeds holding the same items are
+    identical node for node, whatever order they were inserted, erased,
+    split or merged in. splitmix64 is a bijection, so items with distinct
+    64-bit hashes, like all integers, never share a priority. Hashing costs
+    more than drawing a random number, and an adversary who knows the seed
+    can choose items forming a deep tree
+
+Data Fields:
+    salt (uint64_t) - the seed, mixed into every hash
+
+Public functions:
+    HashPriority - constructor for HashPriority
+    seed         - picks another family of shapes
+    fork         - copies our HashPriority, keeping shapes canonical
+    operator()   - gives the priority of an item
+******************************************************************************/
+class HashPriority {
+
+  std::uint64_t salt;
+
+public:
+
+  explicit HashPriority(std::uint64_t seed = 0) : salt(seed) {  }
+
+  void seed(std::uint64_t seed) {
+    salt = seed;
+  }
+
+  HashPriority fork() const {
+    return *this;
+  }
+
+  template<typename Key>
+  std::uint64_t operator()(const Key& item) const {
+    std::uint64_t z = static_cast<std::uint64_t>(std::hash<Key>()(item)) ^ salt;
+    return splitmix64(z);
+  }
+};
+
+#endif // PRIORITY_HPP
@@ -1,10 +1,27 @@
 #include "RST.hpp"
+#include "ConcurrentRST.hpp"
+#include "PersistentRST.hpp"
+#include "CompactRST.hpp"
+#include "RSTMap.hpp"
+#include "IntervalRST.hpp"
+#include "RSTSequence.hpp"
+#include "RSTMultiset.hpp"
+#include <string>
+#include <string_view>
 #include "countint.hpp"
 #include <cmath>
 #include <iostream>
 #include <algorithm>
 #include <vector>
 #include <set>
+#include <iterator>
+#include <limits>
+#include <utility>
+#include <thread>
+#include <stdexcept>
+#if __cplusplus > 201703L
+#include <compare>
+#endif
 
 using namespace std;
 
@@ -216,6 +233,2521 @@ int test_RST_insert(int N) {
   return 0;
 }
 
+/**
+ * Inserts every key twice into an RST using the given allocator, clears it
+ * and inserts the keys again, checking the size of the RST after each step.
+ */
+template<template<typename> class Alloc>
+int test_RST_allocator(const vector<countint>& v, const char* name) {
+
+  cout << "Inserting " << v.size() << " keys twice with " << name << "...";
+  RST<countint, Alloc> r;
+  for(int pass=0; pass<2; pass++) {
+    for(size_t i=0; i<v.size(); i++) {
+      // only the first pass inserts new keys
+      if(r.insert(v[i]) != (pass == 0)) {
+        cout << endl << "Incorrect return value when inserting " << v[i] << endl;
+        return -1;
+      }
+    }
+  }
+  if(r.size() != v.size()) {
+    cout << endl << "Incorrect size after inserting duplicates." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Clearing and refilling the RST...";
+  r.clear();
+  if(!r.empty() || r.size() != 0 || r.begin() != r.end()) {
+    cout << endl << "RST not empty after clear." << endl;
+    return -1;
+  }
+  for(size_t i=0; i<v.size(); i++) {
+    r.insert(v[i]);
+  }
+  if(r.size() != v.size()) {
+    cout << endl << "Incorrect size after refilling." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+  return 0;
+}
+
+int test_RST_allocators(int N) {
+
+  cout << "### Testing RST node allocators ..." << endl << endl;
+
+  vector<countint> v;
+  for(int i=0; i<N; i++) {
+    v.push_back(i);
+  }
+  srand ( unsigned ( 149 ) );
+  std::random_shuffle ( v.begin(), v.end(), myrandom);
+
+  if(test_RST_allocator<NodePool>(v, "NodePool") != 0) return -1;
+  if(test_RST_allocator<HeapAllocator>(v, "HeapAllocator") != 0) return -1;
+
+  cout << endl << "### ALLOCATOR TESTS PASSED ####" << endl << endl;
+
+  return 0;
+}
+
+/**
+ * Checks that iterating r visits exactly the items of expected, in order,
+ * and that r reports the right size.
+ */
+template<typename Tree>
+bool check_contents(const Tree& r, const vector<countint>& expected) {
+  vector<countint>::const_iterator vit = expected.begin();
+  int i = 0;
+  for(typename Tree::iterator it = r.begin(); it != r.end(); ++it) {
+    if(vit == expected.end() || *it != *vit) {
+      cout << endl << "Incorrect inorder iteration of RST." << endl;
+      return false;
+    }
+    ++i;
+    ++vit;
+  }
+  if(vit != expected.end()) {
+    cout << endl << "Early termination during inorder iteration of RST." << endl;
+    return false;
+  }
+  if(r.size() != expected.size()) {
+    cout << endl << "Incorrect size " << r.size() << ", expected "
+         << expected.size() << endl;
+    return false;
+  }
+  return true;
+}
+
+/** An RST holding the keys 0, step, 2*step, ... below N in random order */
+void fill_multiples(RST<countint>& r, int N, int step, vector<countint>& keys) {
+  vector<countint> v;
+  for(int i=0; i<N; i+=step) {
+    v.push_back(i);
+  }
+  keys = v;
+  std::random_shuffle ( v.begin(), v.end(), myrandom);
+  for(size_t i=0; i<v.size(); i++) {
+    r.insert(v[i]);
+  }
+}
+
+int test_RST_split_merge(int N) {
+
+  cout << "### Testing RST split and merge ..." << endl << endl;
+
+  srand ( unsigned ( 149 ) );
+  RST<countint> r;
+  vector<countint> all;
+  fill_multiples(r, N, 1, all);
+
+  cout << "Splitting at " << N/2 << "...";
+  pair<RST<countint>, RST<countint> > halves = r.split(N/2);
+  vector<countint> low(all.begin(), all.begin() + N/2);
+  vector<countint> high(all.begin() + N/2, all.end());
+  if(!r.empty() || !check_contents(halves.first, low) ||
+     !check_contents(halves.second, high)) {
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Merging the halves back together...";
+  RST<countint> merged = RST<countint>::merge(std::move(halves.first),
+                                              std::move(halves.second));
+  if(!halves.first.empty() || !halves.second.empty() ||
+     !check_contents(merged, all)) {
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Inserting into the merged RST...";
+  if(merged.insert(N/2) || !merged.insert(N) || merged.size() != (unsigned)N+1) {
+    cout << endl << "Incorrect insert after merge." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Merging RSTs with their own blocks and inserting more...";
+  RST<countint> low_keys, high_keys;
+  all.clear();
+  for(int i=0; i<3*N; i++) {
+    all.push_back(i);
+    if(i < N) low_keys.insert(i);
+    else if(i < 2*N) high_keys.insert(i);
+  }
+  merged = RST<countint>::merge(std::move(low_keys), std::move(high_keys));
+  for(int i=2*N; i<3*N; i++) {
+    merged.insert(i);
+  }
+  if(!check_contents(merged, all)) {
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Changing both halves of splits on two threads...";
+  for(int round=0; round<4; round++) {
+    halves = merged.split(3*N/2);
+    vector<countint> expected[2];
+    pair<RST<countint>, RST<countint> >* shared = &halves;
+    auto change = [shared, &expected, N](int side) {
+      RST<countint>& half = side ? shared->second : shared->first;
+      int base = side ? 3*N : -N;
+      for(int i=0; i<N; i++) {
+        half.insert(base + i);
+      }
+      int first = side*3*N/2, last = side ? 3*N : 3*N/2;
+      for(int i=first; i<last; i+=2) {
+        half.erase(i);
+      }
+      for(int i=0; i<N && !side; i++) {
+        expected[side].push_back(base + i);
+      }
+      for(int i=first+1; i<last; i+=2) {
+        expected[side].push_back(i);
+      }
+      for(int i=0; i<N && side; i++) {
+        expected[side].push_back(base + i);
+      }
+    };
+    thread low_side(change, 0), high_side(change, 1);
+    low_side.join();
+    high_side.join();
+    if(!check_contents(halves.first, expected[0]) ||
+       !check_contents(halves.second, expected[1])) {
+      return -1;
+    }
+    // the halves let go of their shared blocks on two threads as well
+    thread drop_low([shared] { shared->first.clear(); });
+    thread drop_high([shared] { shared->second.clear(); });
+    drop_low.join();
+    drop_high.join();
+    if(!halves.first.empty() || !halves.second.empty()) {
+      cout << endl << "clear left items behind." << endl;
+      return -1;
+    }
+    for(int i=0; i<3*N; i++) {
+      merged.insert(i);
+    }
+  }
+  if(!check_contents(merged, all)) {
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << endl << "### SPLIT AND MERGE TESTS PASSED ####" << endl << endl;
+
+  return 0;
+}
+
+int test_RST_set_operations(int N) {
+
+  cout << "### Testing RST union, intersection and difference ..." << endl << endl;
+
+  srand ( unsigned ( 149 ) );
+  for(int op=0; op<3; op++) {
+    RST<countint> twos, threes;
+    vector<countint> two_keys, three_keys, expected;
+    fill_multiples(twos, N, 2, two_keys);
+    fill_multiples(threes, N, 3, three_keys);
+
+    if(op == 0) {
+      cout << "Uniting multiples of 2 and 3...";
+      set_union(two_keys.begin(), two_keys.end(), three_keys.begin(),
+                three_keys.end(), back_inserter(expected));
+      twos.union_with(std::move(threes));
+    } else if(op == 1) {
+      cout << "Intersecting multiples of 2 and 3...";
+      set_intersection(two_keys.begin(), two_keys.end(), three_keys.begin(),
+                       three_keys.end(), back_inserter(expected));
+      twos.intersect_with(std::move(threes));
+    } else {
+      cout << "Subtracting multiples of 3 from multiples of 2...";
+      set_difference(two_keys.begin(), two_keys.end(), three_keys.begin(),
+                     three_keys.end(), back_inserter(expected));
+      twos.difference_with(std::move(threes));
+    }
+
+    if(!threes.empty() || !check_contents(twos, expected)) {
+      return -1;
+    }
+    cout << " OK." << endl;
+  }
+
+  cout << endl << "### SET OPERATION TESTS PASSED ####" << endl << endl;
+
+  return 0;
+}
+
+int test_RST_build_from_sorted(int N) {
+
+  cout << "### Testing RST build_from_sorted ..." << endl << endl;
+
+  vector<countint> v;
+  for(int i=0; i<N; i++) {
+    v.push_back(i);
+  }
+
+  cout << "Building an RST from " << N << " sorted keys...";
+  countint::clearcount();
+  RST<countint> r = RST<countint>::build_from_sorted(v.begin(), v.end());
+  unsigned long comps = countint::getcount();
+  if(!check_contents(r, v)) {
+    return -1;
+  }
+  if(comps >= (unsigned long)N) {
+    cout << endl << "Building took " << comps << " comparisons." << endl;
+    return -1;
+  }
+  if(!r.insert(N) || r.insert(N/2)) {
+    cout << endl << "Incorrect insert after building." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Building an RST from sorted keys with duplicates...";
+  vector<countint> doubled;
+  for(int i=0; i<N; i++) {
+    doubled.push_back(i);
+    doubled.push_back(i);
+  }
+  RST<countint> d = RST<countint>::build_from_sorted(doubled.begin(), doubled.end());
+  if(!check_contents(d, v)) {
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Building an RST from unsorted keys...";
+  vector<countint> shuffled = v;
+  srand ( unsigned ( 149 ) );
+  std::random_shuffle ( shuffled.begin(), shuffled.end(), myrandom);
+  RST<countint> u = RST<countint>::build_from_sorted(shuffled.begin(), shuffled.end());
+  if(!check_contents(u, v)) {
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Building an RST from trusted sorted keys...";
+  countint::clearcount();
+  RST<countint> t = RST<countint>::build_from_sorted(v.begin(), v.end(), false);
+  if(countint::getcount() != 0 || !check_contents(t, v)) {
+    cout << endl << "Trusted build compared keys." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << endl << "### BUILD TESTS PASSED ####" << endl << endl;
+
+  return 0;
+}
+
+int test_RST_erase(int N) {
+
+  cout << "### Testing RST erase ..." << endl << endl;
+
+  srand ( unsigned ( 149 ) );
+  RST<countint> r;
+  vector<countint> all;
+  fill_multiples(r, N, 1, all);
+
+  cout << "Erasing every odd key...";
+  vector<countint> shuffled = all;
+  std::random_shuffle ( shuffled.begin(), shuffled.end(), myrandom);
+  vector<countint> evens;
+  for(size_t i=0; i<shuffled.size(); i++) {
+    if(shuffled[i].getval() % 2 && !r.erase(shuffled[i])) {
+      cout << endl << "Incorrect return value when erasing " << shuffled[i] << endl;
+      return -1;
+    }
+  }
+  for(int i=0; i<N; i+=2) {
+    evens.push_back(i);
+  }
+  if(r.erase(1) || !check_contents(r, evens)) {
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Erasing every other key through iterators...";
+  vector<countint> kept;
+  BST<countint>::iterator it = r.begin();
+  for(int i=0; it != r.end(); i++) {
+    if(i % 2) {
+      kept.push_back(*it);
+      ++it;
+    } else {
+      it = r.erase(it);
+    }
+  }
+  if(!check_contents(r, kept)) {
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Erasing a range of keys...";
+  BST<countint>::iterator first = r.begin();
+  BST<countint>::iterator last = r.begin();
+  for(size_t i=0; i<kept.size()/4; i++) {
+    ++first;
+  }
+  for(size_t i=0; i<kept.size()*3/4; i++) {
+    ++last;
+  }
+  vector<countint> outer(kept.begin(), kept.begin() + kept.size()/4);
+  outer.insert(outer.end(), kept.begin() + kept.size()*3/4, kept.end());
+  if(r.erase(first, last) != last || !check_contents(r, outer)) {
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Erasing the rest of the keys...";
+  r.erase(r.begin(), r.end());
+  if(!r.empty() || !check_contents(r, vector<countint>())) {
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << endl << "### ERASE TESTS PASSED ####" << endl << endl;
+
+  return 0;
+}
+
+int test_RST_order_statistics(int N) {
+
+  cout << "### Testing RST rank, select and count_range ..." << endl << endl;
+
+#ifdef BST_ORDER_STATISTICS
+  srand ( unsigned ( 149 ) );
+  RST<countint> r;
+  vector<countint> evens;
+  fill_multiples(r, 2*N, 2, evens);
+
+  cout << "Checking rank and select of every key...";
+  for(int i=0; i<N; i++) {
+    if(r.rank(2*i) != (unsigned)i || r.rank(2*i+1) != (unsigned)i+1 ||
+       *r.select(i) != evens[i]) {
+      cout << endl << "Incorrect rank or select of " << 2*i << endl;
+      return -1;
+    }
+  }
+  if(r.select(N) != r.end()) {
+    cout << endl << "select past the end should return end()." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Counting keys in ranges after erasing...";
+  for(int i=0; i<N; i+=4) {
+    r.erase(2*i);
+  }
+  RST<countint> high = r.split(N).second;
+  for(int lo=-1; lo<N; lo+=7) {
+    unsigned int expected = 0;
+    for(BST<countint>::iterator it = high.begin(); it != high.end(); ++it) {
+      if(lo + N <= (*it).getval() && (*it).getval() < lo + N + 11) {
+        ++expected;
+      }
+    }
+    if(high.count_range(lo + N, lo + N + 11) != expected) {
+      cout << endl << "Incorrect count_range starting at " << lo + N << endl;
+      return -1;
+    }
+  }
+  cout << " OK." << endl;
+
+  cout << endl << "### ORDER STATISTICS TESTS PASSED ####" << endl << endl;
+#else
+  (void)N;
+  cout << "BST_ORDER_STATISTICS is not defined, skipping." << endl << endl;
+#endif
+
+  return 0;
+}
+
+int test_ConcurrentRST(int N) {
+
+  cout << "### Testing ConcurrentRST ..." << endl << endl;
+
+  const int THREADS = 4;
+  ConcurrentRST<int> c(8);
+
+  cout << "Inserting " << N << " keys from " << THREADS << " threads...";
+  vector<thread> threads;
+  for(int t=0; t<THREADS; t++) {
+    threads.push_back(thread([&c, N, t]() {
+      for(int i=t; i<N; i+=THREADS) {
+        c.insert(i);
+      }
+    }));
+  }
+  for(int t=0; t<THREADS; t++) {
+    threads[t].join();
+  }
+  threads.clear();
+  if(c.size() != (unsigned)N || c.insert(0)) {
+    cout << endl << "Incorrect size after concurrent inserts." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Erasing odd keys while finding even keys...";
+  bool found_all = true;
+  for(int t=0; t<THREADS; t++) {
+    threads.push_back(thread([&c, &found_all, N, t]() {
+      for(int i=t; i<N; i+=THREADS) {
+        if(i % 2) {
+          c.erase(i);
+        } else if(!c.find(i)) {
+          found_all = false;
+        }
+      }
+    }));
+  }
+  for(int t=0; t<THREADS; t++) {
+    threads[t].join();
+  }
+  if(!found_all) {
+    cout << endl << "An even key was not found." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Checking ordered traversal across shards...";
+  c.rebalance();
+  int expected = 0;
+  bool ordered = true;
+  c.for_each([&expected, &ordered](int item) {
+    ordered = ordered && item == expected;
+    expected += 2;
+  });
+  if(!ordered || expected != 2 * ((N + 1) / 2) || c.size() != (unsigned)(N + 1) / 2) {
+    cout << endl << "Incorrect traversal of ConcurrentRST." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Checking a descending ConcurrentRST...";
+  vector<int> sample_keys;
+  for(int i=0; i<N; i+=3) {
+    sample_keys.push_back(i);
+  }
+  ConcurrentRST<int, std::greater<int> > down(sample_keys.begin(),
+                                              sample_keys.end(), 8);
+  for(int i=0; i<N; i++) {
+    down.insert(i);
+  }
+  down.rebalance();
+  expected = N - 1;
+  down.for_each([&expected, &ordered](int item) {
+    ordered = ordered && item == expected;
+    --expected;
+  });
+  if(!ordered || expected != -1 || !down.find(N - 1) || down.find(N) ||
+     down.erase(N) || !down.erase(0) || down.size() != (unsigned)N - 1) {
+    cout << endl << "Incorrect order in descending ConcurrentRST." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << endl << "### CONCURRENT TESTS PASSED ####" << endl << endl;
+
+  return 0;
+}
+
+/** An int which keeps track of how many copies of it are alive */
+struct tracked {
+  static int live;
+  int i;
+  tracked(int i) : i(i) { ++live; }
+  tracked(const tracked& o) : i(o.i) { ++live; }
+  ~tracked() { --live; }
+  bool operator<(const tracked& o) const { return i < o.i; }
+};
+int tracked::live = 0;
+
+/** Checks that a version holds exactly the keys of expected, in order */
+bool check_version(const PersistentRST<tracked>& v, const vector<int>& expected) {
+  vector<int> found;
+  for(PersistentRST<tracked>::iterator it = v.begin(); it != v.end(); ++it) {
+    found.push_back(it->i);
+  }
+  if(found != expected || v.size() != expected.size()) {
+    cout << endl << "Incorrect contents of PersistentRST version." << endl;
+    return false;
+  }
+  return true;
+}
+
+int test_PersistentRST(int N) {
+
+  cout << "### Testing PersistentRST ..." << endl << endl;
+
+  vector<int> v;
+  for(int i=0; i<N; i++) {
+    v.push_back(i);
+  }
+  srand ( unsigned ( 149 ) );
+  std::random_shuffle ( v.begin(), v.end(), myrandom);
+  {
+    cout << "Inserting " << N << " keys, taking a snapshot halfway...";
+    PersistentRST<tracked> current, half;
+    vector<int> first_half;
+    for(int i=0; i<N; i++) {
+      if(i == N/2) {
+        half = current.snapshot();
+      }
+      if(i < N/2) {
+        first_half.push_back(v[i]);
+      }
+      current = current.insert(v[i]);
+    }
+    sort(first_half.begin(), first_half.end());
+    vector<int> sorted_v = v;
+    sort(sorted_v.begin(), sorted_v.end());
+    if(!check_version(half, first_half) || !check_version(current, sorted_v)) {
+      return -1;
+    }
+    cout << " OK." << endl;
+
+    cout << "Erasing odd keys from a new version...";
+    PersistentRST<tracked> evens = current;
+    vector<int> even_keys;
+    for(int i=0; i<N; i++) {
+      if(v[i] % 2) {
+        evens = evens.erase(v[i]);
+      }
+    }
+    for(int i=0; i<N; i+=2) {
+      even_keys.push_back(i);
+    }
+    if(!check_version(evens, even_keys) || !check_version(current, sorted_v) ||
+       evens.find(1) != evens.end() || current.find(1)->i != 1 ||
+       (N > 2 && (++current.find(1))->i != 2)) {
+      return -1;
+    }
+    cout << " OK." << endl;
+  }
+
+  cout << "Checking that dropped versions freed their nodes...";
+  if(tracked::live != 0) {
+    cout << endl << tracked::live << " keys were not freed." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Inserting from several threads without touching rand()...";
+  srand(5);
+  int expected_rand = rand();
+  srand(5);
+  PersistentRST<int> base;
+  base.seed(11);
+  for(int i=0; i<N; i+=2) {
+    base = base.insert(i);
+  }
+  const int THREADS = 4;
+  vector< PersistentRST<int> > branches(THREADS);
+  vector<thread> threads;
+  for(int t=0; t<THREADS; t++) {
+    threads.push_back(thread([&branches, &base, N, t]() {
+      PersistentRST<int> mine = base.snapshot();
+      for(int i=1; i<N; i+=2) {
+        mine = mine.insert(i + t);
+      }
+      branches[t] = mine;
+    }));
+  }
+  for(int t=0; t<THREADS; t++) {
+    threads[t].join();
+  }
+  for(int t=0; t<THREADS; t++) {
+    set<int> keys;
+    for(int i=0; i<N; i+=2) keys.insert(i);
+    for(int i=1; i<N; i+=2) keys.insert(i + t);
+    if(!equal(branches[t].begin(), branches[t].end(), keys.begin()) ||
+       branches[t].size() != keys.size()) {
+      cout << endl << "Incorrect branch of thread " << t << endl;
+      return -1;
+    }
+  }
+  if(rand() != expected_rand || base.size() != (unsigned) (N + 1) / 2) {
+    cout << endl << "PersistentRST drew its priorities from rand()." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << endl << "### PERSISTENT TESTS PASSED ####" << endl << endl;
+
+  return 0;
+}
+
+/**
+ * Inserts every key twice into a CompactRST with the given storage, erases
+ * the odd keys and inserts them again into the freed slots, checking the
+ * contents after each step.
+ */
+template<template<typename> class Storage>
+int test_CompactRST_storage(const vector<countint>& v, const char* name) {
+
+  cout << "Inserting " << v.size() << " keys twice with " << name << "...";
+  CompactRST<countint, Storage> r;
+  r.reserve(v.size());
+  for(int pass=0; pass<2; pass++) {
+    for(size_t i=0; i<v.size(); i++) {
+      // only the first pass inserts new keys
+      if(r.insert(v[i]) != (pass == 0)) {
+        cout << endl << "Incorrect return value when inserting " << v[i] << endl;
+        return -1;
+      }
+    }
+  }
+  vector<countint> sorted_v = v;
+  sort(sorted_v.begin(), sorted_v.end());
+  if(!check_contents(r, sorted_v)) {
+    return -1;
+  }
+  if(r.bytes() - sizeof(r) >= v.size() * sizeof(BSTNode<countint>)) {
+    cout << endl << "CompactRST uses " << r.bytes() << " bytes, no less than "
+         << "the pointer layout." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Erasing odd keys and inserting them again...";
+  vector<countint> evens;
+  for(size_t i=0; i<v.size(); i++) {
+    // erasing a key a second time must fail
+    if(v[i].getval() % 2 == 1 && (!r.erase(v[i]) || r.erase(v[i]))) {
+      cout << endl << "Incorrect return value when erasing " << v[i] << endl;
+      return -1;
+    }
+  }
+  for(size_t i=0; i<sorted_v.size(); i+=2) {
+    evens.push_back(sorted_v[i]);
+  }
+  if(!check_contents(r, evens) || r.contains(1) || (r.size() > 1 && !r.contains(2))) {
+    return -1;
+  }
+  std::size_t before = r.bytes();
+  for(size_t i=0; i<v.size(); i++) {
+    r.insert(v[i]);
+  }
+  if(!check_contents(r, sorted_v) || r.bytes() != before ||
+     (r.size() > 3 && *++r.find(2) != 3)) {
+    cout << endl << "Freed slots were not reused." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+  return 0;
+}
+
+int test_CompactRST(int N) {
+
+  cout << "### Testing CompactRST ..." << endl << endl;
+
+  vector<countint> v;
+  for(int i=0; i<N; i++) {
+    v.push_back(i);
+  }
+  srand ( unsigned ( 149 ) );
+  std::random_shuffle ( v.begin(), v.end(), myrandom);
+
+  if(test_CompactRST_storage<PackedNodes>(v, "PackedNodes") != 0) return -1;
+  if(test_CompactRST_storage<SplitNodes>(v, "SplitNodes") != 0) return -1;
+
+  cout << "Checking that rand() is left alone...";
+  srand(5);
+  int first = rand();
+  srand(5);
+  CompactRST<countint> seeded;
+  seeded.seed(7);
+  for(int i=0; i<N; i++) {
+    seeded.insert(v[i]);
+  }
+  if(rand() != first || seeded.size() != (unsigned) N) {
+    cout << endl << "Inserting into a CompactRST drew from rand()." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << endl << "### COMPACT TESTS PASSED ####" << endl << endl;
+
+  return 0;
+}
+
+/**
+ * Freezes an RST holding the even keys below 2N and compares find and
+ * lower_bound of the FrozenRST against std::lower_bound for every key from
+ * -1 to 2N.
+ */
+template<typename T>
+int test_FrozenRST_keys(int N, const char* name) {
+
+  cout << "Freezing " << N << " even " << name << " keys...";
+  vector<int> v;
+  vector<T> sorted_v;
+  for(int i=0; i<N; i++) {
+    v.push_back(2 * i);
+    sorted_v.push_back(2 * i);
+  }
+  std::random_shuffle ( v.begin(), v.end(), myrandom);
+  RST<T> r;
+  for(int i=0; i<N; i++) {
+    r.insert(v[i]);
+  }
+  FrozenRST<T> f = r.freeze();
+  if(f.size() != sorted_v.size() || !equal(f.begin(), f.end(), sorted_v.begin())) {
+    cout << endl << "Incorrect contents of FrozenRST." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Checking find and lower_bound against std::lower_bound...";
+  for(int i=-1; i<=2*N; i++) {
+    typename vector<T>::iterator expected =
+      std::lower_bound(sorted_v.begin(), sorted_v.end(), T(i));
+    typename FrozenRST<T>::iterator found = f.lower_bound(i);
+    if(found - f.begin() != expected - sorted_v.begin() ||
+       (f.find(i) != f.end()) != (i >= 0 && i < 2*N && i % 2 == 0)) {
+      cout << endl << "Incorrect lower_bound or find for " << i << endl;
+      return -1;
+    }
+  }
+  cout << " OK." << endl;
+  return 0;
+}
+
+int test_FrozenRST(int N) {
+
+  cout << "### Testing FrozenRST ..." << endl << endl;
+
+  srand ( unsigned ( 149 ) );
+  if(test_FrozenRST_keys<int>(N, "int") != 0) return -1;
+  if(test_FrozenRST_keys<countint>(N, "countint") != 0) return -1;
+
+  cout << "Freezing an empty RST...";
+  FrozenRST<int> empty = RST<int>().freeze();
+  if(!empty.empty() || empty.begin() != empty.end() ||
+     empty.find(0) != empty.end() || empty.lower_bound(0) != empty.end()) {
+    cout << endl << "Empty FrozenRST is not empty." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << endl << "### FROZEN TESTS PASSED ####" << endl << endl;
+
+  return 0;
+}
+
+int test_RST_iterators(int N) {
+
+  cout << "### Testing RST bidirectional iterators ..." << endl << endl;
+
+  RST<countint> r;
+  vector<countint> keys;
+  srand ( unsigned ( 149 ) );
+  fill_multiples(r, N, 1, keys);
+
+  cout << "Iterating forwards without comparing keys...";
+  countint::clearcount();
+  if(!check_contents(r, keys) || countint::getcount() != (unsigned long) N) {
+    cout << endl << "Iteration compared keys " << countint::getcount() - N
+         << " times." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Iterating backwards with -- and reverse iterators...";
+  countint::clearcount();
+  RST<countint>::iterator it = r.end();
+  for(int i=N-1; i>=0; i--) {
+    --it;
+    if(it->getval() != i) {
+      cout << endl << "Incorrect backward iteration at " << i << endl;
+      return -1;
+    }
+  }
+  if(it != r.begin() || countint::getcount() != 0) {
+    cout << endl << "Backward iteration did not end at begin()." << endl;
+    return -1;
+  }
+  vector<countint> reversed(r.rbegin(), r.rend());
+  if(!equal(reversed.begin(), reversed.end(), keys.rbegin())) {
+    cout << endl << "Incorrect reverse iteration." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Keeping the ends up to date while erasing and splitting...";
+  for(int i=0; i<N/4; i++) {
+    r.erase(i);
+    r.erase(N-1-i);
+    if(N-2-2*i > 0 && (r.begin()->getval() != i+1 || (--r.end())->getval() != N-2-i)) {
+      cout << endl << "Incorrect ends after erasing " << i << endl;
+      return -1;
+    }
+  }
+  pair<RST<countint>, RST<countint> > halves = r.split(N/2);
+  r = RST<countint>::merge(std::move(halves.first), std::move(halves.second));
+  r.insert(-1);
+  r.insert(N);
+  if(r.begin()->getval() != -1 || (--r.end())->getval() != N ||
+     r.rbegin()->getval() != N) {
+    cout << endl << "Incorrect ends after merging." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Taking new iterators after moving and swapping...";
+  RST<countint> moved(std::move(r));
+  RST<countint> other;
+  other.insert(N + 1);
+  std::swap(moved, other);
+  if(!r.empty() || r.begin() != r.end() ||
+     (--other.end())->getval() != N || other.rbegin()->getval() != N ||
+     (--moved.end())->getval() != N + 1 || moved.begin()->getval() != N + 1) {
+    cout << endl << "Incorrect ends after moving and swapping." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << endl << "### ITERATOR TESTS PASSED ####" << endl << endl;
+
+  return 0;
+}
+
+int test_RST_bounds(int N) {
+
+  cout << "### Testing RST lower_bound, upper_bound and ranges ..." << endl << endl;
+
+  RST<countint> r;
+  vector<countint> keys;
+  srand ( unsigned ( 149 ) );
+  fill_multiples(r, N, 3, keys);
+
+  cout << "Checking bounds of every key against std::lower_bound...";
+  for(int i=-1; i<=N+1; i++) {
+    size_t lower = std::lower_bound(keys.begin(), keys.end(), countint(i)) - keys.begin();
+    size_t upper = std::upper_bound(keys.begin(), keys.end(), countint(i)) - keys.begin();
+    RST<countint>::iterator lo = r.lower_bound(i);
+    RST<countint>::iterator hi = r.upper_bound(i);
+    pair<RST<countint>::iterator, RST<countint>::iterator> eq = r.equal_range(i);
+    RST<countint>::iterator fl = r.floor(i);
+    if((lower == keys.size() ? lo != r.end() : *lo != keys[lower]) ||
+       (upper == keys.size() ? hi != r.end() : *hi != keys[upper]) ||
+       eq.first != lo || eq.second != hi || r.ceiling(i) != lo ||
+       (upper == 0 ? fl != r.end() : *fl != keys[upper - 1])) {
+      cout << endl << "Incorrect bounds for " << i << endl;
+      return -1;
+    }
+  }
+  cout << " OK." << endl;
+
+  cout << "Scanning ranges without comparing keys after positioning...";
+  for(int lo=-1; lo<=N+1; lo+=max(1, N/37)) {
+    for(int hi=lo-3; hi<=N+4; hi+=max(1, N/29)) {
+      vector<countint> expected;
+      for(size_t k=0; k<keys.size(); k++) {
+        if(!(keys[k] < countint(lo)) && keys[k] < countint(hi)) {
+          expected.push_back(keys[k]);
+        }
+      }
+      BSTRange<countint> view = r.range(lo, hi);
+      countint::clearcount();
+      vector<countint> found(view.begin(), view.end());
+      if(countint::getcount() != 0 || found.size() != expected.size() ||
+         !equal(found.begin(), found.end(), expected.begin()) ||
+         view.empty() != expected.empty()) {
+        cout << endl << "Incorrect range [" << lo << ", " << hi << ")" << endl;
+        return -1;
+      }
+    }
+  }
+  cout << " OK." << endl;
+
+  cout << endl << "### BOUNDS TESTS PASSED ####" << endl << endl;
+
+  return 0;
+}
+
+/** A large value which counts how often it is built, copied and moved */
+struct record {
+  static int built, copies, moves;
+  string payload;
+  record() : payload(200, ' ') { ++built; }
+  record(const string& p) : payload(p) { ++built; }
+  record(const record& o) : payload(o.payload) { ++copies; }
+  record(record&& o) : payload(std::move(o.payload)) { ++moves; }
+  record& operator=(const record& o) { payload = o.payload; ++copies; return *this; }
+  record& operator=(record&& o) { payload = std::move(o.payload); ++moves; return *this; }
+};
+int record::built = 0;
+int record::copies = 0;
+int record::moves = 0;
+
+int test_RSTMap(int N) {
+
+  cout << "### Testing RSTMap ..." << endl << endl;
+
+  vector<int> v;
+  for(int i=0; i<N; i++) {
+    v.push_back(i);
+  }
+  srand ( unsigned ( 149 ) );
+  std::random_shuffle ( v.begin(), v.end(), myrandom);
+
+  RSTMap<countint, record> m;
+  cout << "Inserting " << N << " values with try_emplace...";
+  for(int i=0; i<N; i++) {
+    if(!m.try_emplace(v[i], to_string(v[i])).second ||
+       m.try_emplace(v[i], "duplicate").second) {
+      cout << endl << "Incorrect return value when inserting " << v[i] << endl;
+      return -1;
+    }
+  }
+  if(m.size() != (unsigned) N || record::built != N || record::copies != 0 ||
+     record::moves != 0) {
+    cout << endl << "try_emplace built " << record::built << " records, copied "
+         << record::copies << " and moved " << record::moves << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Looking up and changing values in place...";
+  for(int i=0; i<N; i++) {
+    RSTMap<countint, record>::iterator it = m.find(v[i]);
+    if(it == m.end() || it->second.payload != to_string(v[i]) ||
+       m.at(v[i]).payload != to_string(v[i])) {
+      cout << endl << "Incorrect value for " << v[i] << endl;
+      return -1;
+    }
+    it->second.payload += "!";
+    m[v[i]].payload += "?";
+  }
+  int expected = 0;
+  for(RSTMap<countint, record>::iterator it = m.begin(); it != m.end(); ++it) {
+    if(it->first.getval() != expected || it->second.payload != to_string(expected) + "!?") {
+      cout << endl << "Incorrect entry at " << expected << endl;
+      return -1;
+    }
+    ++expected;
+  }
+  if(record::built != N || record::copies != 0 || m.find(N) != m.end() || m.contains(-1)) {
+    cout << endl << "Lookups built or copied records." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Checking insert_or_assign, emplace, rvalue insert and erase...";
+  record replacement("replaced");
+  if(m.insert_or_assign(0, std::move(replacement)).second ||
+     m.at(0).payload != "replaced" || record::moves != 1 ||
+     !m.insert_or_assign(N, record("new")).second || m.at(N).payload != "new" ||
+     !m.emplace(N + 1, "emplaced").second || m.emplace(N + 1, "again").second ||
+     !m.insert(RSTMapEntry<countint, record>(N + 2, "moved")).second ||
+     m.at(N + 2).payload != "moved" || record::copies != 0 ||
+     m[N + 3].payload.size() != 200 || m.size() != (unsigned) N + 4) {
+    cout << endl << "Incorrect insert_or_assign, emplace or insert." << endl;
+    return -1;
+  }
+  for(int i=0; i<N; i+=2) {
+    if(!m.erase(i) || m.erase(i)) {
+      cout << endl << "Incorrect return value when erasing " << i << endl;
+      return -1;
+    }
+  }
+  RSTMap<countint, record>::iterator next = m.erase(m.find(N + 3));
+  if(next != m.end() || m.size() != (unsigned) (N / 2 + 3) ||
+     (N > 1 && m.begin()->first.getval() != 1)) {
+    cout << endl << "Incorrect contents after erasing." << endl;
+    return -1;
+  }
+  bool thrown = false;
+  try {
+    m.at(0);
+  } catch(const out_of_range&) {
+    thrown = true;
+  }
+  if(!thrown) {
+    cout << endl << "at did not throw for a missing key." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Reading a const RSTMap through const_iterator...";
+  const RSTMap<countint, record>& cm = m;
+  static_assert(std::is_same<decltype(*cm.find(1)),
+                             const RSTMapEntry<countint, record>&>::value,
+                "a const RSTMap must not hand out mutable entries");
+  static_assert(std::is_same<decltype(cm.begin()->second),
+                             record>::value &&
+                std::is_const<typename std::remove_reference<
+                  decltype(*cm.begin())>::type>::value,
+                "a const RSTMap must not hand out mutable values");
+  static_assert(std::is_same<std::iterator_traits<
+                  RSTMap<countint, record>::const_iterator>::reference,
+                  const RSTMapEntry<countint, record>&>::value &&
+                std::is_same<std::iterator_traits<
+                  RSTMap<countint, record>::iterator>::pointer,
+                  RSTMapEntry<countint, record>*>::value,
+                "iterator_traits must agree with what the iterators hand out");
+  RSTMap<countint, record>::const_iterator first = m.begin();
+  size_t seen = 0;
+  for(RSTMap<countint, record>::const_iterator it = cm.begin();
+      it != cm.end(); ++it) {
+    ++seen;
+  }
+  if(seen != cm.size() || first != cm.begin() || m.begin() != cm.begin() ||
+     (N > 1 && (cm.find(1) == cm.end() || cm.at(1).payload.empty())) ||
+     cm.find(0) != m.end()) {
+    cout << endl << "Incorrect const iteration." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << endl << "### MAP TESTS PASSED ####" << endl << endl;
+
+  return 0;
+}
+
+// orders countints with < alone, hiding their three-way compare
+struct less_only {
+  bool operator()(const countint& a, const countint& b) const {
+    return a < b;
+  }
+};
+
+#if __cplusplus > 201703L && defined(__cpp_lib_three_way_comparison)
+// an int counting how often it is ordered by < and by <=>
+struct spaceship {
+  static unsigned long less_calls, three_way_calls;
+  int i;
+  bool operator<(const spaceship& o) const { ++less_calls; return i < o.i; }
+  bool operator==(const spaceship& o) const { return i == o.i; }
+  std::strong_ordering operator<=>(const spaceship& o) const {
+    ++three_way_calls;
+    return i <=> o.i;
+  }
+};
+unsigned long spaceship::less_calls = 0;
+unsigned long spaceship::three_way_calls = 0;
+#endif
+
+int test_RST_compare(int N) {
+
+  cout << "### Testing RST comparators ..." << endl << endl;
+
+  vector<int> v;
+  for(int i=0; i<N; i++) {
+    v.push_back(i);
+  }
+  srand ( unsigned ( 149 ) );
+  std::random_shuffle ( v.begin(), v.end(), myrandom);
+
+  /* The same shuffled keys and priorities, ordered with and without the
+   * three-way compare of countint */
+  RST<countint> three;
+  RST<countint, NodePool, less_only> two;
+  cout << "Inserting " << N << " shuffled keys...";
+  three.seed(7);
+  countint::clearcount();
+  for(int i=0; i<N; i++) {
+    three.insert(v[i]);
+  }
+  double threeway = countint::getcount() / (double) N;
+  two.seed(7);
+  countint::clearcount();
+  for(int i=0; i<N; i++) {
+    two.insert(v[i]);
+  }
+  double twoway = countint::getcount() / (double) N;
+  cout << " done." << endl;
+  cout << "That took " << threeway << " average comparisons per key with "
+       << "compare, " << twoway << " with < alone" << endl;
+  if(N > 1 && !(threeway < twoway)) {
+    cout << "The three-way comparison did not save comparisons." << endl;
+    return -1;
+  }
+
+  cout << "Checking a descending RST...";
+  RST<int, NodePool, std::greater<int> > down;
+  for(int i=0; i<N; i++) {
+    down.insert(v[i]);
+  }
+  int expected = N - 1;
+  for(RST<int, NodePool, std::greater<int> >::iterator it = down.begin();
+      it != down.end(); ++it, --expected) {
+    if(*it != expected) {
+      cout << endl << "Incorrect descending iteration." << endl;
+      return -1;
+    }
+  }
+  if(expected != -1 || (N > 2 && (*down.lower_bound(N / 2) != N / 2 ||
+                                  *down.upper_bound(N / 2) != N / 2 - 1 ||
+                                  *down.freeze().lower_bound(N / 2) != N / 2))) {
+    cout << endl << "Incorrect bounds in a descending RST." << endl;
+    return -1;
+  }
+  std::pair<RST<int, NodePool, std::greater<int> >,
+            RST<int, NodePool, std::greater<int> > > halves =
+      down.split(N / 2);
+  if(halves.first.size() != (unsigned) (N - N / 2 - 1) ||
+     (N > 1 && *halves.second.begin() != N / 2)) {
+    cout << endl << "Incorrect split of a descending RST." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Checking lookups by string_view...";
+  RST<string, NodePool, std::less<> > words;
+  for(int i=0; i<N; i++) {
+    words.insert(to_string(v[i]));
+  }
+  for(int i=0; i<N; i++) {
+    string key = to_string(i);
+    if(words.find(string_view(key)) == words.end() ||
+       *words.lower_bound(string_view(key)) != key) {
+      cout << endl << "Could not find " << key << " by string_view." << endl;
+      return -1;
+    }
+  }
+  if(words.find(string_view("-1")) != words.end()) {
+    cout << endl << "Found a missing string_view." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Checking a descending RSTMap...";
+  RSTMap<int, int, NodePool, std::greater<int> > m;
+  for(int i=0; i<N; i++) {
+    m[v[i]] = 2 * v[i];
+  }
+  expected = N - 1;
+  for(RSTMap<int, int, NodePool, std::greater<int> >::iterator it = m.begin();
+      it != m.end(); ++it, --expected) {
+    if(it->first != expected || it->second != 2 * expected ||
+       m.at(expected) != 2 * expected) {
+      cout << endl << "Incorrect descending RSTMap." << endl;
+      return -1;
+    }
+  }
+  cout << " OK." << endl;
+
+#if __cplusplus > 201703L && defined(__cpp_lib_three_way_comparison)
+  cout << "Searching with operator<=> alone...";
+  RST<spaceship> ordered;
+  for(int i=0; i<N; i++) {
+    ordered.insert(spaceship{v[i]});
+  }
+  spaceship::less_calls = spaceship::three_way_calls = 0;
+  for(int i=-1; i<=N; i++) {
+    if((ordered.find(spaceship{i}) != ordered.end()) != (i >= 0 && i < N)) {
+      cout << endl << "Incorrect find of " << i << " with <=>." << endl;
+      return -1;
+    }
+  }
+  if(spaceship::less_calls != 0 || spaceship::three_way_calls == 0) {
+    cout << endl << "find called < " << spaceship::less_calls
+         << " times instead of <=>." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+#else
+  cout << "Not compiled as C++20, skipping operator<=>." << endl;
+#endif
+
+  cout << endl << "### COMPARATOR TESTS PASSED ####" << endl << endl;
+
+  return 0;
+}
+
+// an RST which reports its shape, one preorder list of items and depths
+template<typename Priority>
+struct shaped : public RST<int, NodePool, std::less<int>, Priority> {
+  void layout(BSTNode<int>* n, int depth, vector<int>& out) const {
+    if(!n) return;
+    out.push_back(n->data);
+    out.push_back(depth);
+    layout(n->left, depth + 1, out);
+    layout(n->right, depth + 1, out);
+  }
+  vector<int> layout() const {
+    vector<int> out;
+    layout(this->root, 0, out);
+    return out;
+  }
+  int height() const {
+    return this->shape().height;
+  }
+};
+
+template<typename Priority>
+int test_RST_priority_source(const string& name, const vector<int>& v) {
+  int N = v.size();
+  shaped<Priority> a, b, c;
+  // filled one after another, since RandPriority shares rand()
+  a.seed(42);
+  for(int i=0; i<N; i++) a.insert(v[i]);
+  b.seed(42);
+  for(int i=0; i<N; i++) b.insert(v[i]);
+  c.seed(43);
+  for(int i=0; i<N; i++) c.insert(v[i]);
+  if(a.layout() != b.layout() || (N > 16 && a.layout() == c.layout())) {
+    cout << endl << name << " did not reproduce shapes by seed." << endl;
+    return -1;
+  }
+  // a treap of N keys is this deep with overwhelming probability
+  if(a.height() > 4 * log2(N + 1) + 4) {
+    cout << endl << name << " gave a tree of height " << a.height() << endl;
+    return -1;
+  }
+  return 0;
+}
+
+int test_RST_priorities(int N) {
+
+  cout << "### Testing RST priority sources ..." << endl << endl;
+
+  vector<int> v;
+  for(int i=0; i<N; i++) {
+    v.push_back(i);
+  }
+  srand ( unsigned ( 149 ) );
+  std::random_shuffle ( v.begin(), v.end(), myrandom);
+
+  cout << "Checking seeded shapes...";
+  if(test_RST_priority_source<Xoshiro256>("Xoshiro256", v) ||
+     test_RST_priority_source<WyRand>("WyRand", v) ||
+     test_RST_priority_source<RandPriority>("RandPriority", v)) {
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Checking canonical shapes from hashed priorities...";
+  if(test_RST_priority_source<HashPriority>("HashPriority", v)) {
+    return -1;
+  }
+  shaped<HashPriority> shuffled, sorted_in, erased, unioned, odds;
+  for(int i=0; i<N; i++) {
+    shuffled.insert(v[i]);
+    sorted_in.insert(i);
+    erased.insert(2 * N - 1 - i);
+    erased.insert(i);
+    (i % 2 ? odds : unioned).insert(v[i]);
+  }
+  for(int i=N; i<2*N; i++) {
+    erased.erase(i);
+  }
+  unioned.union_with(std::move(odds));
+  if(shuffled.layout() != sorted_in.layout() ||
+     shuffled.layout() != erased.layout() ||
+     shuffled.layout() != unioned.layout()) {
+    cout << endl << "The same items gave different shapes." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Checking that rand() is left alone...";
+  srand ( unsigned ( 5 ) );
+  int first = rand();
+  srand ( unsigned ( 5 ) );
+  RST<int> r;
+  for(int i=0; i<N; i++) {
+    r.insert(v[i]);
+  }
+  if(rand() != first) {
+    cout << endl << "Inserting into an RST drew from rand()." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Checking sorted insertion with sorted splits...";
+  shaped<Xoshiro256> sorted;
+  sorted.seed(1);
+  for(int i=0; i<N; i++) {
+    sorted.insert(i);
+  }
+  std::pair<RST<int>, RST<int> > halves = sorted.split(N / 2);
+  for(int i=N; i<2*N; i++) {
+    halves.first.insert(i);
+  }
+  if(halves.first.size() != (unsigned) (N / 2 + N) ||
+     halves.second.size() != (unsigned) (N - N / 2)) {
+    cout << endl << "Incorrect sizes after inserting into a split." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << endl << "### PRIORITY TESTS PASSED ####" << endl << endl;
+
+  return 0;
+}
+
+int test_RST_stats(int N) {
+
+  cout << "### Testing RST stats and shape ..." << endl << endl;
+
+  vector<countint> v;
+  for(int i=0; i<N; i++) {
+    v.push_back(i);
+  }
+  srand ( unsigned ( 149 ) );
+  std::random_shuffle ( v.begin(), v.end(), myrandom);
+
+  RST<countint> r;
+#ifdef BST_STATS
+  cout << "Counting inserts and finds...";
+  countint::clearcount();
+  for(int i=0; i<N; i++) {
+    r.insert(v[i]);
+  }
+  BSTStats s = r.stats();
+  // countint's compare makes every comparison one call at one level
+  if(s.comparisons != countint::getcount() || s.allocations != (unsigned) N ||
+     s.descents != (unsigned) N - 1 || s.descentNodes != s.comparisons ||
+     s.rotations > 3 * (unsigned) N || (N > 16 && !s.rotations)) {
+    cout << endl << "Incorrect counters after inserting: " << s.toJSON() << endl;
+    return -1;
+  }
+  // an insert may walk deeper than the tree is once its leaf rotates up,
+  // so only the finds have to reach exactly the height
+  r.reset_stats();
+  for(int i=0; i<N; i++) {
+    r.find(v[i]);
+  }
+  if(r.stats().descents != (unsigned) N ||
+     r.stats().deepestDescent != (unsigned) r.shape().height) {
+    cout << endl << "Incorrect counters after finding: " << r.stats().toJSON()
+         << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Counting finds from 4 threads...";
+  const int READERS = 4;
+  const RST<countint>& shared = r;
+  r.reset_stats();
+  vector<thread> readers;
+  for(int t=0; t<READERS; t++) {
+    readers.emplace_back([&shared, &v, N]() {
+      for(int i=0; i<N; i++) {
+        shared.find(v[i]);
+      }
+    });
+  }
+  for(thread& t : readers) {
+    t.join();
+  }
+  if(r.stats().descents != (unsigned) (READERS * N) ||
+     r.stats().descentNodes != r.stats().comparisons) {
+    cout << endl << "Lost counts finding from several threads: "
+         << r.stats().toJSON() << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Counting erases and clear...";
+  for(int i=0; i<N/2; i++) {
+    r.erase(v[i]);
+  }
+  if(r.stats().deallocations != (unsigned) N/2) {
+    cout << endl << "Incorrect counters after erasing." << endl;
+    return -1;
+  }
+  r.clear();
+  if(r.stats().deallocations != (unsigned) N) {
+    cout << endl << "Incorrect counters after clear." << endl;
+    return -1;
+  }
+  r.reset_stats();
+  if(r.stats().toJSON() != BSTStats().toJSON()) {
+    cout << endl << "reset_stats did not reset." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+#else
+  cout << "BST_STATS is not defined, skipping the counters." << endl;
+#endif
+
+  cout << "Analyzing the shape...";
+  for(int i=0; i<N; i++) {
+    r.insert(v[i]);
+  }
+  BSTShape shape = r.shape();
+  unsigned long total = 0;
+  for(size_t d=0; d<shape.histogram.size(); d++) {
+    total += shape.histogram[d];
+  }
+  if(shape.size != (unsigned) N || total != (unsigned) N ||
+     shape.height != shape.histogram.size() || shape.histogram[0] != 1 ||
+     (N >= 100 && (shape.depthRatio() < 0.3 || shape.depthRatio() > 1.5)) ||
+     shape.toJSON().find("\"histogram\": [1") == string::npos) {
+    cout << endl << "Incorrect shape: " << shape.toJSON() << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+  if(N <= 100) cout << shape.toJSON() << endl;
+
+  cout << endl << "### STATS TESTS PASSED ####" << endl << endl;
+
+  return 0;
+}
+
+int test_countint(int N) {
+
+  cout << "### Testing countint counters ..." << endl << endl;
+
+  cout << "Counting comparisons from 4 threads...";
+  const int THREADS = 4;
+  countint::clearcount();
+  vector<keycounts> spent(THREADS);
+  vector<thread> threads;
+  for(int t=0; t<THREADS; t++) {
+    threads.push_back(thread([&spent, N, t]() {
+      countscope scope(&spent[t]);
+      countint a(t), b(t + 1);
+      for(int i=0; i<N; i++) {
+        if(!(a < b)) return;
+      }
+    }));
+  }
+  for(int t=0; t<THREADS; t++) {
+    threads[t].join();
+  }
+  keycounts all = countint::counts();
+  for(int t=0; t<THREADS; t++) {
+    if(spent[t].comparisons != (unsigned long) N || spent[t].destructions != 2) {
+      cout << endl << "Thread " << t << " counted " << spent[t].comparisons
+           << " comparisons." << endl;
+      return -1;
+    }
+  }
+  if(all.comparisons != (unsigned long) THREADS * N ||
+     all.destructions != 2 * THREADS) {
+    cout << endl << "Counted " << all.comparisons << " comparisons in all." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Clearing the counts while another thread counts...";
+  const unsigned long BUMPS = 200000;
+  std::atomic<unsigned long> done(0);
+  thread counter([&done, BUMPS]() {
+    countint a(0), b(1);
+    for(unsigned long i=0; i<BUMPS; i++) {
+      if(!(a < b)) return;
+      done.store(i + 1, std::memory_order_relaxed);
+    }
+  });
+  while(done.load(std::memory_order_relaxed) < BUMPS / 2) {
+    this_thread::yield();
+  }
+  // at least this many comparisons came before the clear
+  unsigned long before = done.load(std::memory_order_relaxed);
+  countint::clearcount();
+  counter.join();
+  if(countint::counts().comparisons > BUMPS - before) {
+    cout << endl << "Counted " << countint::counts().comparisons
+         << " comparisons after clearing, at most " << BUMPS - before
+         << " were made." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  vector<countint> v;
+  for(int i=0; i<N; i++) {
+    v.push_back(i);
+  }
+
+  cout << "Counting copies of inserts and bulk loads...";
+  keycounts copied, moved, bulk;
+  RST<countint> a, b;
+  {
+    countscope scope(&copied);
+    for(int i=0; i<N; i++) {
+      a.insert(v[i]);
+    }
+  }
+  {
+    countscope scope(&moved);
+    for(int i=0; i<N; i++) {
+      b.insert(countint(v[i].getval()));
+    }
+  }
+  {
+    countscope scope(&bulk);
+    RST<countint> c = RST<countint>::build_from_sorted(v.begin(), v.end());
+  }
+  // inserts keep their copy or move in the tree and only destroy the
+  // temporaries passed in; a bulk load copies each key once, compares each
+  // with the one before and destroys the copies with the tree
+  if(copied.copies != (unsigned long) N || copied.moves != 0 ||
+     copied.destructions != 0 ||
+     moved.copies != 0 || moved.moves != (unsigned long) N ||
+     moved.destructions != (unsigned long) N ||
+     bulk.copies != (unsigned long) N || bulk.moves != 0 ||
+     bulk.comparisons != (unsigned long) N - 1 ||
+     bulk.destructions != (unsigned long) N) {
+    cout << endl << "Incorrect copies: " << copied.copies << " by const&, "
+         << moved.copies << " by &&, " << bulk.copies << " in bulk." << endl
+         << "Incorrect moves: " << copied.moves << " by const&, "
+         << moved.moves << " by &&, " << bulk.moves << " in bulk." << endl
+         << "Incorrect destructions: " << copied.destructions
+         << " by const&, " << moved.destructions << " by &&, "
+         << bulk.destructions << " in bulk." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Counting copies of RSTMap values...";
+  RSTMap<int, counted<string> > m;
+  keycounts emplaced, looked_up, assigned;
+  {
+    countscope scope(&emplaced);
+    for(int i=0; i<N; i++) {
+      m.try_emplace(i, 20, 'x');
+    }
+  }
+  {
+    countscope scope(&looked_up);
+    for(int i=0; i<N; i++) {
+      if(m[i].get().size() != 20) return -1;
+    }
+  }
+  {
+    countscope scope(&assigned);
+    counted<string> y(20, 'y');
+    for(int i=0; i<N; i++) {
+      m.insert_or_assign(i, y);
+    }
+  }
+  // values are built in place, found by reference and assigned in place
+  if(emplaced.copies != 0 || emplaced.moves != 0 ||
+     looked_up.copies != 0 || looked_up.moves != 0 ||
+     assigned.copies != 0 || assigned.assignments != (unsigned long) N) {
+    cout << endl << "RSTMap copied or moved its values." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << endl << "### COUNTINT TESTS PASSED ####" << endl << endl;
+
+  return 0;
+}
+
+int test_RST_hints(int N) {
+
+  cout << "### Testing RST hinted and finger insertion ..." << endl << endl;
+
+  vector<countint> v;
+  for(int i=0; i<N; i++) {
+    v.push_back(2*i);
+  }
+
+  cout << "Appending " << N << " sorted keys at end()...";
+  RST<countint> plain, hinted;
+  keycounts from_root, from_end;
+  {
+    countscope scope(&from_root);
+    for(int i=0; i<N; i++) {
+      plain.insert(v[i]);
+    }
+  }
+  {
+    countscope scope(&from_end);
+    for(int i=0; i<N; i++) {
+      RST<countint>::iterator it = hinted.insert(hinted.end(), v[i]);
+      if(it == hinted.end() || it->getval() != 2*i) {
+        cout << endl << "insert did not point at " << v[i] << endl;
+        return -1;
+      }
+    }
+  }
+  if(!check_contents(hinted, v)) return -1;
+#ifdef BST_ORDER_STATISTICS
+  for(int i=0; i<N; i++) {
+    if(hinted.rank(2*i) != (unsigned)i) {
+      cout << endl << "Incorrect rank of " << 2*i << endl;
+      return -1;
+    }
+  }
+#endif
+  // an append compares against the last key and links below it
+  double per_key = (double) from_end.comparisons / N;
+  if(per_key > 2 || (N > 16 && from_end.comparisons >= from_root.comparisons) ||
+     (N > 100 && hinted.shape().depthRatio() > 1.5)) {
+    cout << endl << "That took " << per_key << " average comparisons per key, "
+         << (double) from_root.comparisons / N << " from the root." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+  if(N > 16) cout << "That took " << per_key << " average comparisons per key, "
+                  << (double) from_root.comparisons / N << " from the root"
+                  << endl;
+
+  cout << "Inserting odd keys next to their neighbours...";
+  vector<countint> all;
+  for(int i=0; i<2*N; i++) {
+    all.push_back(i);
+  }
+  keycounts near_hint;
+  {
+    countscope scope(&near_hint);
+    for(int i=0; i<N; i++) {
+      hinted.insert(hinted.find(2*i), countint(2*i+1));
+    }
+  }
+  if(!check_contents(hinted, all)) return -1;
+  RST<countint>::iterator dup = hinted.insert(hinted.begin(), countint(N));
+  if(*dup != N || hinted.size() != all.size()) {
+    cout << endl << "Inserted a duplicate next to a hint." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Inserting near-sorted keys with finger search...";
+  RST<countint> fingered, unfingered;
+  fingered.finger_search(true);
+  keycounts with_finger, without_finger;
+  {
+    countscope scope(&with_finger);
+    for(int i=0; i<N; i++) {
+      fingered.insert(countint(i ^ 1));
+    }
+  }
+  {
+    countscope scope(&without_finger);
+    for(int i=0; i<N; i++) {
+      unfingered.insert(countint(i ^ 1));
+    }
+  }
+  vector<countint> firsts(all.begin(), all.begin() + (N & ~1));
+  if(N % 2) firsts.push_back(N);
+  if(!check_contents(fingered, firsts) ||
+     (N > 100 && with_finger.comparisons >= without_finger.comparisons)) {
+    cout << endl << "Finger search took " << with_finger.comparisons
+         << " comparisons, " << without_finger.comparisons
+         << " without it." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+  if(N > 100) cout << "That took " << (double) with_finger.comparisons / N
+                   << " average comparisons per key, "
+                   << (double) without_finger.comparisons / N
+                   << " from the root" << endl;
+
+  cout << "Dropping the finger when its node goes...";
+  fingered.erase(countint(firsts.back()));
+  fingered.insert(countint(firsts.back()));
+  fingered.erase(countint(firsts.back()));
+  std::pair< RST<countint>, RST<countint> > halves = fingered.split(N / 2);
+  halves.second.finger_search(true);
+  std::random_shuffle(all.begin(), all.end(), myrandom);
+  for(size_t i=0; i<all.size(); i++) {
+    halves.second.insert(all[i]);
+  }
+  std::sort(all.begin(), all.end());
+  if(!check_contents(halves.second, all)) return -1;
+  halves.second.clear();
+  halves.second.insert(countint(1));
+  if(!check_contents(halves.second, vector<countint>(1, 1))) return -1;
+  cout << " OK." << endl;
+
+  cout << endl << "### HINT TESTS PASSED ####" << endl << endl;
+
+  return 0;
+}
+
+/** Checks that every subtree size is right, through rank and select */
+bool check_ranks(const RST<countint>& r) {
+#ifdef BST_ORDER_STATISTICS
+  unsigned i = 0;
+  for(RST<countint>::iterator it = r.begin(); it != r.end(); ++it, ++i) {
+    if(r.rank(*it) != i || *r.select(i) != *it) {
+      cout << endl << "Incorrect rank or select of " << *it << endl;
+      return false;
+    }
+  }
+#else
+  (void)r;
+#endif
+  return true;
+}
+
+int test_RST_parallel(int N) {
+
+  cout << "### Testing RST bulk operations on a TaskPool ..." << endl << endl;
+
+  TaskPool pool(4, 16), alone(1);
+  TaskPool* pools[] = { &pool, &alone };
+  const char* names[] = { "4 threads", "1 thread" };
+
+  for(int p=0; p<2; p++) {
+    cout << "Building from shuffled keys with duplicates on " << names[p] << "...";
+    vector<countint> v, keys, expected;
+    for(int i=0; i<N; i++) {
+      v.push_back(i);
+      v.push_back(i);
+      keys.push_back(i);
+    }
+    srand ( unsigned ( 149 ) );
+    std::random_shuffle ( v.begin(), v.end(), myrandom);
+    RST<countint> built = RST<countint>::build_parallel(v.begin(), v.end(),
+                                                        *pools[p]);
+    if(!check_contents(built, keys) || !check_ranks(built) ||
+       (N > 100 && built.shape().depthRatio() > 1.5)) {
+      return -1;
+    }
+    cout << " OK." << endl;
+
+    for(int op=0; op<3; op++) {
+      RST<countint> twos, threes;
+      vector<countint> two_keys, three_keys;
+      fill_multiples(twos, N, 2, two_keys);
+      fill_multiples(threes, N, 3, three_keys);
+      expected.clear();
+#ifdef BST_STATS
+      twos.reset_stats();
+#endif
+      countint::clearcount();
+
+      if(op == 0) {
+        cout << "Uniting multiples of 2 and 3 on " << names[p] << "...";
+        set_union(two_keys.begin(), two_keys.end(), three_keys.begin(),
+                  three_keys.end(), back_inserter(expected));
+        countint::clearcount();
+        twos.union_with(std::move(threes), *pools[p]);
+      } else if(op == 1) {
+        cout << "Intersecting multiples of 2 and 3 on " << names[p] << "...";
+        set_intersection(two_keys.begin(), two_keys.end(), three_keys.begin(),
+                         three_keys.end(), back_inserter(expected));
+        countint::clearcount();
+        twos.intersect_with(std::move(threes), *pools[p]);
+      } else {
+        cout << "Subtracting multiples of 3 from multiples of 2 on "
+             << names[p] << "...";
+        set_difference(two_keys.begin(), two_keys.end(), three_keys.begin(),
+                       three_keys.end(), back_inserter(expected));
+        countint::clearcount();
+        twos.difference_with(std::move(threes), *pools[p]);
+      }
+
+#ifdef BST_STATS
+      // every thread counts into its own helper tree and the counts of the
+      // helpers are added up
+      unsigned long counted = countint::getcount();
+      if(twos.stats().comparisons != counted) {
+        cout << endl << "Counted " << twos.stats().comparisons
+             << " comparisons, countint counted " << counted << endl;
+        return -1;
+      }
+#endif
+      if(!threes.empty() || !check_contents(twos, expected) ||
+         !check_ranks(twos)) {
+        return -1;
+      }
+      cout << " OK." << endl;
+    }
+
+    cout << "Filtering and mapping on " << names[p] << "...";
+    vector<countint> evens, halves;
+    for(int i=0; i<N; i++) {
+      if(i % 2 == 0) evens.push_back(i);
+      if(i % 2 == 0) halves.push_back(i / 2);
+    }
+    RST<countint> filtered = built.filter([](const countint& c) {
+      return c.getval() % 2 == 0;
+    }, *pools[p]);
+    RST<countint> mapped = built.map([](const countint& c) {
+      return countint(c.getval() / 2);
+    }, *pools[p]);
+    if(!check_contents(built, keys) || !check_contents(filtered, evens) ||
+       !check_ranks(filtered) || !check_contents(mapped, halves) ||
+       !check_ranks(mapped)) {
+      return -1;
+    }
+    cout << " OK." << endl;
+
+    cout << "Mapping into descending trees on " << names[p] << "...";
+    typedef RST<countint, NodePool, std::greater<countint> > Descending;
+    Descending down = built.map<Descending>([](const countint& c) {
+      return countint(c.getval() / 2);
+    }, *pools[p]);
+    // keeping the type of the items keeps the order of the tree
+    auto again = down.map([](const countint& c) { return c; }, *pools[p]);
+    static_assert(std::is_same<decltype(again), Descending>::value,
+                  "map should keep the comparator");
+    vector<countint> reversed(halves.rbegin(), halves.rend());
+    if(!check_contents(down, reversed) || !check_contents(again, reversed)) {
+      return -1;
+    }
+    cout << " OK." << endl;
+  }
+
+  cout << "Passing exceptions back through invoke...";
+  bool caught = false;
+  try {
+    pool.invoke([] {}, [] { throw std::runtime_error("stolen"); });
+  } catch(const std::runtime_error&) {
+    caught = true;
+  }
+  if(!caught) {
+    cout << endl << "invoke lost an exception." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << endl << "### PARALLEL TESTS PASSED ####" << endl << endl;
+
+  return 0;
+}
+
+int test_RST_batch(int N) {
+
+  cout << "### Testing RST find_batch and contains_batch ..." << endl << endl;
+
+  cout << "Finding " << 2*N << " shuffled keys, half of them missing...";
+  RST<countint> r;
+  vector<countint> keys;
+  for(int i=0; i<N; i++) {
+    r.insert(2*i);
+  }
+  for(int i=0; i<2*N; i++) {
+    keys.push_back(i);
+  }
+  srand ( unsigned ( 151 ) );
+  std::random_shuffle ( keys.begin(), keys.end(), myrandom);
+  vector<RST<countint>::iterator> found;
+  vector<bool> present;
+  r.find_batch(keys.begin(), keys.end(), back_inserter(found));
+  r.contains_batch(keys.begin(), keys.end(), back_inserter(present));
+  if(found.size() != keys.size() || present.size() != keys.size()) {
+    cout << endl << "Wrote " << found.size() << " iterators and "
+         << present.size() << " bools for " << keys.size() << " keys" << endl;
+    return -1;
+  }
+  for(size_t i=0; i<keys.size(); i++) {
+    if(found[i] != r.find(keys[i]) || present[i] != (found[i] != r.end())) {
+      cout << endl << "Incorrect result for " << keys[i] << endl;
+      return -1;
+    }
+  }
+  cout << " OK." << endl;
+
+  cout << "Finding sorted keys along shared paths...";
+  std::sort(keys.begin(), keys.end());
+  keys.insert(keys.begin() + N, 3, countint(N));
+  keycounts batched, looped;
+  vector<RST<countint>::iterator> sorted_found;
+  {
+    countscope scope(&batched);
+    r.find_batch(keys.begin(), keys.end(), back_inserter(sorted_found));
+  }
+  {
+    countscope scope(&looped);
+    for(size_t i=0; i<keys.size(); i++) {
+      r.find(keys[i]);
+    }
+  }
+  for(size_t i=0; i<keys.size(); i++) {
+    int k = keys[i].getval();
+    if((k % 2 == 0) != (sorted_found[i] != r.end()) ||
+       (k % 2 == 0 && sorted_found[i]->getval() != k)) {
+      cout << endl << "Incorrect result for " << k << endl;
+      return -1;
+    }
+  }
+  if(N > 100 && batched.comparisons >= looped.comparisons) {
+    cout << endl << "The sorted batch took " << batched.comparisons
+         << " comparisons, " << looped.comparisons << " one by one" << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+  if(N > 100) cout << "That took " << (double) batched.comparisons / keys.size()
+                   << " average comparisons per key, "
+                   << (double) looped.comparisons / keys.size()
+                   << " one by one" << endl;
+
+  cout << "Finding in an empty RST and an empty batch...";
+  RST<countint> empty;
+  present.clear();
+  empty.contains_batch(keys.begin(), keys.end(), back_inserter(present));
+  if(std::count(present.begin(), present.end(), true) ||
+     present.size() != keys.size() ||
+     r.find_batch(keys.end(), keys.end(), found.begin()) != found.begin()) {
+    cout << endl << "Found keys which are not there." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << endl << "### BATCH TESTS PASSED ####" << endl << endl;
+
+  return 0;
+}
+
+/** A reading taken at some time, ordered by its time alone */
+struct reading {
+  int time;
+  int value;
+};
+
+struct reading_before {
+  bool operator()(const reading& a, const reading& b) const {
+    return a.time < b.time;
+  }
+};
+
+/** Sums the values of readings and keeps the first and last time in order,
+ *  so summaries combined in the wrong order are caught */
+struct reading_summary {
+  struct Value {
+    long long sum;
+    int first;
+    int last;
+  };
+  static Value identity() { return Value{0, -1, -1}; }
+  static Value of(const reading& s) { return Value{s.value, s.time, s.time}; }
+  static Value combine(const Value& a, const Value& b) {
+    return Value{a.sum + b.sum, a.first < 0 ? b.first : a.first,
+                 b.last < 0 ? a.last : b.last};
+  }
+};
+
+typedef RST<reading, NodePool, reading_before, Xoshiro256, reading_summary>
+  ReadingRST;
+
+/** Summarizes the readings with lo <= time < hi one by one, where values
+ *  holds the value at every time or -1 */
+reading_summary::Value summarize(const vector<int>& values, int lo, int hi) {
+  reading_summary::Value v = reading_summary::identity();
+  for(int t=max(lo, 0); t<hi && t<(int)values.size(); t++) {
+    if(values[t] >= 0) {
+      v = reading_summary::combine(v, reading_summary::of(reading{t, values[t]}));
+    }
+  }
+  return v;
+}
+
+/** Checks aggregate on the whole tree and on random ranges, and that a
+ *  range takes no more comparisons than a few walks down the tree */
+bool check_summaries(ReadingRST& r, const vector<int>& values) {
+  int n = values.size();
+  reading_summary::Value all = summarize(values, 0, n), whole = r.aggregate();
+  if(whole.sum != all.sum || whole.first != all.first || whole.last != all.last) {
+    cout << endl << "Incorrect summary of the whole RST" << endl;
+    return false;
+  }
+#ifdef BST_STATS
+  unsigned height = r.shape().height;
+#endif
+  for(int i=0; i<200; i++) {
+    int lo = rand() % (n + 2) - 1;
+    int hi = i % 10 ? lo + rand() % (n / 4 + 2) : rand() % (n + 2) - 1;
+    reading_summary::Value expected = summarize(values, lo, hi);
+#ifdef BST_STATS
+    r.reset_stats();
+#endif
+    reading_summary::Value found = r.aggregate(reading{lo, 0}, reading{hi, 0});
+    if(found.sum != expected.sum || found.first != expected.first ||
+       found.last != expected.last) {
+      cout << endl << "Incorrect summary of [" << lo << ", " << hi << ")" << endl;
+      return false;
+    }
+#ifdef BST_STATS
+    if(r.stats().comparisons > 4 * height + 4) {
+      cout << endl << "Summarizing [" << lo << ", " << hi << ") took "
+           << r.stats().comparisons << " comparisons, height " << height << endl;
+      return false;
+    }
+#endif
+  }
+  return true;
+}
+
+int test_RST_aggregate(int N) {
+
+  cout << "### Testing RST aggregates ..." << endl << endl;
+
+  cout << "Summarizing " << N << " shuffled readings over random ranges...";
+  vector<int> times;
+  vector<int> values(2*N, -1);
+  for(int i=0; i<N; i++) {
+    times.push_back(2*i);
+  }
+  srand ( unsigned ( 157 ) );
+  std::random_shuffle ( times.begin(), times.end(), myrandom);
+  ReadingRST r;
+  for(int i=0; i<N; i++) {
+    values[times[i]] = times[i] * 7 % 13;
+    r.insert(reading{times[i], values[times[i]]});
+  }
+  if(!check_summaries(r, values)) return -1;
+  cout << " OK." << endl;
+
+  cout << "Erasing readings one by one and by range...";
+  for(int t=0; t<2*N; t+=6) {
+    r.erase(reading{t, 0});
+    values[t] = -1;
+  }
+  r.erase(r.lower_bound(reading{N/2, 0}), r.lower_bound(reading{N, 0}));
+  for(int t=N/2; t<N; t++) {
+    values[t] = -1;
+  }
+  if(!check_summaries(r, values)) return -1;
+  cout << " OK." << endl;
+
+  cout << "Inserting next to hints and rotating...";
+  for(int t=1; t<2*N; t+=4) {
+    values[t] = t % 5;
+    r.insert(r.end(), reading{t, values[t]});
+  }
+  for(int t=0; t<2*N; t+=3) {
+    r.findAndRotate(reading{t, 0}, t % 2);
+  }
+  if(!check_summaries(r, values)) return -1;
+  cout << " OK." << endl;
+
+  cout << "Splitting, merging and uniting...";
+  std::pair<ReadingRST, ReadingRST> halves = r.split(reading{N, 0});
+  vector<int> low(values.begin(), values.begin() + N);
+  if(!check_summaries(halves.first, low) ||
+     halves.second.aggregate().sum != summarize(values, N, 2*N).sum) {
+    return -1;
+  }
+  r = ReadingRST::merge(std::move(halves.first), std::move(halves.second));
+  ReadingRST more;
+  for(int t=3; t<2*N; t+=8) {
+    values[t] = 1;
+    more.insert(reading{t, 1});
+  }
+  r.union_with(std::move(more));
+  if(!check_summaries(r, values)) return -1;
+  cout << " OK." << endl;
+
+  cout << "Building from sorted readings and filtering...";
+  vector<reading> sorted;
+  for(int t=0; t<2*N; t++) {
+    if(values[t] >= 0) sorted.push_back(reading{t, values[t]});
+  }
+  ReadingRST built = ReadingRST::build_from_sorted(sorted.begin(), sorted.end());
+  if(!check_summaries(built, values)) return -1;
+  ReadingRST filtered = built.filter([](const reading& s) { return s.time % 2; });
+  for(int t=0; t<2*N; t+=2) {
+    values[t] = -1;
+  }
+  if(!check_summaries(filtered, values)) return -1;
+  cout << " OK." << endl;
+
+  cout << "Finding minima and maxima...";
+  RST<int, NodePool, std::less<int>, Xoshiro256, MinAggregate<int> > mins;
+  RST<int, NodePool, std::less<int>, Xoshiro256, MaxAggregate<int> > maxes;
+  for(int i=0; i<N; i++) {
+    mins.insert(times[i]);
+    maxes.insert(times[i]);
+  }
+  for(int i=0; i<100; i++) {
+    int lo = rand() % (2*N), hi = lo + rand() % N;
+    int first = lo + lo % 2, last = min(hi, 2*N) - 1;
+    last -= last % 2;
+    if(first >= min(hi, 2*N)) {
+      if(mins.aggregate(lo, hi) != std::numeric_limits<int>::max() ||
+         maxes.aggregate(lo, hi) != std::numeric_limits<int>::lowest()) {
+        cout << endl << "Found an item in the empty range [" << lo << ", "
+             << hi << ")" << endl;
+        return -1;
+      }
+    } else if(mins.aggregate(lo, hi) != first || maxes.aggregate(lo, hi) != last) {
+      cout << endl << "Incorrect minimum or maximum of [" << lo << ", " << hi
+           << ")" << endl;
+      return -1;
+    }
+  }
+  cout << " OK." << endl;
+
+  cout << endl << "### AGGREGATE TESTS PASSED ####" << endl << endl;
+
+  return 0;
+}
+
+/** Checks overlapping and containing against a scan of every interval,
+ *  returning false on a mismatch and adding up the comparisons of both */
+bool check_intervals(const IntervalRST<countint>& r,
+                     const set< pair<int, int> >& all, int lo, int hi,
+                     unsigned long& searched, unsigned long& scanned) {
+  vector< Interval<countint> > found;
+  vector< pair<int, int> > expected;
+  keycounts search, scan;
+  {
+    countscope scope(&search);
+    if(lo == hi) r.containing(lo, back_inserter(found));
+    else r.overlapping(lo, hi, back_inserter(found));
+  }
+  {
+    countscope scope(&scan);
+    for(set< pair<int, int> >::const_iterator it = all.begin();
+        it != all.end(); ++it) {
+      if(!(countint(it->second) < countint(lo)) &&
+         !(countint(hi) < countint(it->first))) {
+        expected.push_back(*it);
+      }
+    }
+  }
+  searched += search.comparisons;
+  scanned += scan.comparisons;
+  bool same = found.size() == expected.size();
+  for(size_t i=0; same && i<found.size(); i++) {
+    same = found[i].low.getval() == expected[i].first &&
+           found[i].high.getval() == expected[i].second;
+  }
+  if(!same) {
+    cout << endl << "Found " << found.size() << " intervals overlapping ["
+         << lo << ", " << hi << "], expected " << expected.size() << endl;
+  }
+  return same;
+}
+
+int test_RST_intervals(int N) {
+
+  cout << "### Testing IntervalRST ..." << endl << endl;
+
+  cout << "Inserting " << N << " random intervals...";
+  srand ( unsigned ( 163 ) );
+  IntervalRST<countint> r;
+  set< pair<int, int> > all;
+  for(int i=0; i<N; i++) {
+    int low = rand() % (4*N);
+    int high = low + (i % 10 ? rand() % 8 : rand() % (N + 1));
+    if(r.insert(low, high) != all.insert(make_pair(low, high)).second) {
+      cout << endl << "Incorrect return value when inserting [" << low << ", "
+           << high << "]" << endl;
+      return -1;
+    }
+  }
+  if(r.size() != all.size() || !r.contains(all.begin()->first,
+                                           all.begin()->second)) {
+    cout << endl << "Holding " << r.size() << " intervals, expected "
+         << all.size() << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Finding intervals containing points and overlapping ranges...";
+  unsigned long searched = 0, scanned = 0;
+  for(int i=0; i<100; i++) {
+    int point = rand() % (4*N + 20) - 10;
+    if(!check_intervals(r, all, point, point, searched, scanned)) return -1;
+  }
+  if(N > 100 && searched * 4 > scanned) {
+    cout << endl << "Stabbing took " << searched << " comparisons, "
+         << scanned << " scanning" << endl;
+    return -1;
+  }
+  double per_stab = searched / 100.0, per_scan = scanned / 100.0;
+  for(int i=0; i<100; i++) {
+    int lo = rand() % (4*N + 20) - 10;
+    int hi = lo + rand() % (i % 2 ? 10 : 2*N);
+    if(!check_intervals(r, all, lo, hi, searched, scanned)) return -1;
+  }
+  cout << " OK." << endl;
+  if(N > 100) cout << "Stabbing took " << per_stab
+                   << " average comparisons per point, " << per_scan
+                   << " scanning" << endl;
+
+  cout << "Erasing every other interval...";
+  bool odd = false;
+  for(set< pair<int, int> >::iterator it = all.begin(); it != all.end(); ) {
+    if((odd = !odd)) {
+      if(!r.erase(it->first, it->second)) {
+        cout << endl << "Could not erase [" << it->first << ", "
+             << it->second << "]" << endl;
+        return -1;
+      }
+      all.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+  for(int i=0; i<100; i++) {
+    int lo = rand() % (4*N + 20) - 10;
+    int hi = lo + rand() % 10;
+    if(!check_intervals(r, all, lo, hi, searched, scanned)) return -1;
+  }
+  r.clear();
+  all.clear();
+  if(!check_intervals(r, all, 0, 4*N, searched, scanned)) return -1;
+  cout << " OK." << endl;
+
+  cout << endl << "### INTERVAL TESTS PASSED ####" << endl << endl;
+
+  return 0;
+}
+
+/** Checks every element of an RSTSequence against a vector */
+bool check_sequence(const RSTSequence<int>& s, const vector<int>& v) {
+  vector<int> items = s.to_vector();
+  if(s.size() != v.size() || items != v) {
+    cout << endl << "Holding " << s.size() << " elements, expected "
+         << v.size() << endl;
+    return false;
+  }
+  for(size_t i=0; i<v.size(); i+=v.size()/16+1) {
+    if(s[i] != v[i]) {
+      cout << endl << "Incorrect element at " << i << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+int test_RST_sequence(int N) {
+
+  cout << "### Testing RSTSequence ..." << endl << endl;
+
+  cout << "Building from " << N << " elements and inserting and erasing...";
+  vector<int> v;
+  for(int i=0; i<N; i++) {
+    v.push_back(i);
+  }
+  RSTSequence<int> s(v.begin(), v.end());
+  if(!check_sequence(s, v)) return -1;
+  srand ( unsigned ( 167 ) );
+  for(int i=0; i<N; i++) {
+    unsigned pos = rand() % (v.size() + 1);
+    s.insert_at(pos, -i);
+    v.insert(v.begin() + pos, -i);
+    if(i % 3 == 0) {
+      pos = rand() % v.size();
+      s.erase_at(pos);
+      v.erase(v.begin() + pos);
+    }
+  }
+  if(!check_sequence(s, v)) return -1;
+  cout << " OK." << endl;
+
+  cout << "Reversing and adding to ranges...";
+  for(int i=0; i<N; i++) {
+    unsigned first = rand() % (v.size() + 1);
+    unsigned last = first + rand() % (v.size() - first + 1);
+    if(i % 2) {
+      s.reverse(first, last);
+      std::reverse(v.begin() + first, v.begin() + last);
+    } else {
+      s.add(first, last, i);
+      for(unsigned j=first; j<last; j++) {
+        v[j] += i;
+      }
+    }
+    if(i % 64 == 0) {
+      s[first % v.size()] += 1;
+      v[first % v.size()] += 1;
+    }
+  }
+  if(!check_sequence(s, v)) return -1;
+  cout << " OK." << endl;
+
+  cout << "Reading tagged ranges from 4 threads...";
+  const RSTSequence<int>& shared = s;
+  vector< vector<int> > read(4);
+  vector<thread> readers;
+  for(int t=0; t<4; t++) {
+    readers.emplace_back([&shared, &read, t]() {
+      read[t] = shared.to_vector();
+      for(unsigned i=t; i<shared.size(); i+=4) {
+        read[t][i] = shared.at(i);
+      }
+    });
+  }
+  for(thread& t : readers) {
+    t.join();
+  }
+  for(int t=0; t<4; t++) {
+    if(read[t] != v) {
+      cout << endl << "Thread " << t << " read the wrong elements." << endl;
+      return -1;
+    }
+  }
+  // the tags the readers left alone still reach the elements when pushed
+  if(!check_sequence(s, v)) return -1;
+  for(unsigned i=0; i<v.size(); i+=v.size()/8+1) {
+    if(s[i] != v[i]) {
+      cout << endl << "Incorrect element at " << i << " after pushing." << endl;
+      return -1;
+    }
+  }
+  cout << " OK." << endl;
+
+  cout << "Reversing elements which cannot be added to...";
+  vector< pair<int, int> > pairs;
+  for(int i=0; i<N; i++) {
+    pairs.push_back(make_pair(i, -i));
+  }
+  RSTSequence< pair<int, int> > ps(pairs.begin(), pairs.end());
+  for(int i=0; i<20; i++) {
+    unsigned first = rand() % (pairs.size() + 1);
+    unsigned last = first + rand() % (pairs.size() - first + 1);
+    ps.reverse(first, last);
+    std::reverse(pairs.begin() + first, pairs.begin() + last);
+  }
+  const RSTSequence< pair<int, int> >& cps = ps;
+  if(cps.to_vector() != pairs || cps.at(N / 2) != pairs[N / 2]) {
+    cout << endl << "Incorrect elements after reversing." << endl;
+    return -1;
+  }
+  cout << " OK." << endl;
+
+  cout << "Cutting and pasting ranges with split_at and concat...";
+  for(int i=0; i<20; i++) {
+    unsigned first = rand() % (v.size() + 1);
+    unsigned last = first + rand() % (v.size() - first + 1);
+    std::pair< RSTSequence<int>, RSTSequence<int> > front = s.split_at(first);
+    std::pair< RSTSequence<int>, RSTSequence<int> > back =
+      front.second.split_at(last - first);
+    // move the middle part to the front, reversed
+    back.first.reverse(0, back.first.size());
+    s = RSTSequence<int>::concat(
+      RSTSequence<int>::concat(std::move(back.first), std::move(front.first)),
+      std::move(back.second));
+    vector<int> middle(v.begin() + first, v.begin() + last);
+    std::reverse(middle.begin(), middle.end());
+    v.erase(v.begin() + first, v.begin() + last);
+    v.insert(v.begin(), middle.begin(), middle.end());
+    if(!front.first.empty() || !front.second.empty()) {
+      cout << endl << "split_at or concat left elements behind." << endl;
+      return -1;
+    }
+  }
+  if(!check_sequence(s, v)) return -1;
+  cout << " OK." << endl;
+
+  cout << "Rejecting positions past the end...";
+  bool caught = false;
+  try {
+    s.insert_at(v.size() + 1, 0);
+  } catch(const std::out_of_range&) {
+    caught = true;
+  }
+  try {
+    s.erase_at(v.size());
+    caught = false;
+  } catch(const std::out_of_range&) {
+  }
+  if(!caught || !check_sequence(s, v)) {
+    cout << endl << "An invalid position was accepted." << endl;
+    return -1;
+  }
+  s.clear();
+  if(!check_sequence(s, vector<int>())) return -1;
+  cout << " OK." << endl;
+
+  cout << endl << "### SEQUENCE TESTS PASSED ####" << endl << endl;
+
+  return 0;
+}
+
+/** Checks both ways through an RSTMultiset against a std::multiset */
+bool check_multiset(const RSTMultiset<int>& m, const multiset<int>& model) {
+  vector<int> copies(m.begin(), m.end());
+  vector<int> distinct;
+  for(RSTMultiset<int>::distinct_iterator it = m.distinct_begin();
+      it != m.distinct_end(); ++it) {
+    distinct.push_back(*it);
+    if(it.count() != model.count(*it) || m.count(*it) != it.count()) {
+      cout << endl << "Incorrect count of " << *it << endl;
+      return false;
+    }
+  }
+  set<int> keys(model.begin(), model.end());
+  if(copies != vector<int>(model.begin(), model.end()) ||
+     distinct != vector<int>(keys.begin(), keys.end()) ||
+     m.size() != model.size() || m.distinct_size() != keys.size() ||
+     m.empty() != model.empty()) {
+    cout << endl << "Holding " << m.size() << " copies of "
+         << m.distinct_size() << " keys, expected " << model.size()
+         << " copies of " << keys.size() << endl;
+    return false;
+  }
+  vector<int> backwards;
+  for(RSTMultiset<int>::iterator it = m.end(); it != m.begin(); ) {
+    backwards.push_back(*--it);
+  }
+  if(!equal(backwards.begin(), backwards.end(), model.rbegin())) {
+    cout << endl << "Iterating backwards went wrong." << endl;
+    return false;
+  }
+  return true;
+}
+
+int test_RST_multiset(int N) {
+
+  cout << "### Testing RSTMultiset ..." << endl << endl;
+
+  cout << "Inserting " << N << " keys with many repeats...";
+  RSTMultiset<int> m;
+  multiset<int> model;
+  srand ( unsigned ( 251 ) );
+  for(int i=0; i<N; i++) {
+    int key = rand() % (N / 8 + 1);
+    unsigned int copies = i % 5 ? 1 : rand() % 4;
+    for(unsigned int j=0; j<copies; j++) {
+      model.insert(key);
+    }
+    if(m.insert(key, copies) != model.count(key)) {
+      cout << endl << "insert gave the wrong count of " << key << endl;
+      return -1;
+    }
+  }
+  if(!check_multiset(m, model)) return -1;
+  cout << " OK." << endl;
+
+  cout << "Finding keys and counting their copies...";
+  for(int key=-1; key<=N/8+1; key++) {
+    RSTMultiset<int>::iterator it = m.find(key);
+    if(m.count(key) != model.count(key) ||
+       m.contains(key) != (model.count(key) > 0) ||
+       (it != m.end()) != m.contains(key) || (it != m.end() && *it != key)) {
+      cout << endl << "Looking up " << key << " went wrong." << endl;
+      return -1;
+    }
+  }
+  cout << " OK." << endl;
+
+  cout << "Erasing single copies, several copies and every copy...";
+  for(int i=0; i<N; i++) {
+    int key = rand() % (N / 8 + 2);
+    unsigned int copies = i % 3 + 1;
+    unsigned int removed = 0;
+    if(i % 7 == 0) {
+      removed = model.erase(key);
+      if(m.erase_all(key) != removed) {
+        cout << endl << "erase_all gave the wrong count of " << key << endl;
+        return -1;
+      }
+      continue;
+    }
+    while(removed < copies && model.find(key) != model.end()) {
+      model.erase(model.find(key));
+      removed++;
+    }
+    if(m.erase(key, copies) != removed) {
+      cout << endl << "erase gave the wrong count of " << key << endl;
+      return -1;
+    }
+  }
+  if(!check_multiset(m, model)) return -1;
+  m.insert(N, 0);
+  if(m.contains(N) || !check_multiset(m, model)) {
+    cout << endl << "Inserting no copies left an entry behind." << endl;
+    return -1;
+  }
+  m.clear();
+  if(!check_multiset(m, multiset<int>())) return -1;
+  cout << " OK." << endl;
+
+  cout << endl << "### MULTISET TESTS PASSED ####" << endl << endl;
+
+  return 0;
+}
+
 /**
  * A simple partial test driver for the RST class template.
  */
@@ -232,5 +2764,149 @@ int main(int argc, char** argv) {
     return return_value;
   }
   
-  return test_RST_insert(N);
+  return_value = test_RST_insert(N);
+
+  if (return_value != 0) {
+    return return_value;
+  }
+
+  return_value = test_RST_allocators(N);
+
+  if (return_value != 0) {
+    return return_value;
+  }
+
+  return_value = test_RST_split_merge(N);
+
+  if (return_value != 0) {
+    return return_value;
+  }
+
+  return_value = test_RST_set_operations(N);
+
+  if (return_value != 0) {
+    return return_value;
+  }
+
+  return_value = test_RST_build_from_sorted(N);
+
+  if (return_value != 0) {
+    return return_value;
+  }
+
+  return_value = test_RST_erase(N);
+
+  if (return_value != 0) {
+    return return_value;
+  }
+
+  return_value = test_RST_order_statistics(N);
+
+  if (return_value != 0) {
+    return return_value;
+  }
+
+  return_value = test_ConcurrentRST(N);
+
+  if (return_value != 0) {
+    return return_value;
+  }
+
+  return_value = test_PersistentRST(N);
+
+  if (return_value != 0) {
+    return return_value;
+  }
+
+  return_value = test_CompactRST(N);
+
+  if (return_value != 0) {
+    return return_value;
+  }
+
+  return_value = test_FrozenRST(N);
+
+  if (return_value != 0) {
+    return return_value;
+  }
+
+  return_value = test_RST_iterators(N);
+
+  if (return_value != 0) {
+    return return_value;
+  }
+
+  return_value = test_RST_bounds(N);
+
+  if (return_value != 0) {
+    return return_value;
+  }
+
+  return_value = test_RSTMap(N);
+
+  if (return_value != 0) {
+    return return_value;
+  }
+
+  return_value = test_RST_compare(N);
+
+  if (return_value != 0) {
+    return return_value;
+  }
+
+  return_value = test_RST_priorities(N);
+
+  if (return_value != 0) {
+    return return_value;
+  }
+
+  return_value = test_RST_stats(N);
+
+  if (return_value != 0) {
+    return return_value;
+  }
+
+  return_value = test_countint(N);
+
+  if (return_value != 0) {
+    return return_value;
+  }
+
+  return_value = test_RST_hints(N);
+
+  if (return_value != 0) {
+    return return_value;
+  }
+
+  return_value = test_RST_parallel(N);
+
+  if (return_value != 0) {
+    return return_value;
+  }
+
+  return_value = test_RST_batch(N);
+
+  if (return_value != 0) {
+    return return_value;
+  }
+
+  return_value = test_RST_aggregate(N);
+
+  if (return_value != 0) {
+    return return_value;
+  }
+
+  return_value = test_RST_intervals(N);
+
+  if (return_value != 0) {
+    return return_value;
+  }
+
+  return_value = test_RST_sequence(N);
+
+  if (return_value != 0) {
+    return return_value;
+  }
+
+  return test_RST_multiset(N);
 }
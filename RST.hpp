@@ -11,9 +11,20 @@ Description:  This program creates a class called RST, creating a randomized
 
 #ifndef RST_HPP
 #define RST_HPP
+#include "Aggregate.hpp"
 #include "BST.hpp"
+#include "NodePool.hpp"
+#include "FrozenRST.hpp"
+#include "Priority.hpp"
+#include "TaskPool.hpp"
+#include <algorithm>
+#include <cstdint>
 #include <stdlib.h>
 #include <iostream>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 using namespace std;
 
@@ -22,144 +33,374 @@ using namespace std;
 class RST
 
 Description: Creates a RST, or randomized search tree, which will allow us to
-    insert nodes, rotate nodes left or right, and to locate nodes in our tree
+    insert nodes, rotate nodes left or right, and to locate nodes in our tree.
+    Alloc chooses the node allocator and Compare the order of the items, just
+    like in BST. Priority is the random number generator giving new nodes
+    their 64-bit priorities. Every RST owns its own, so trees never contend
+    for it, and seed makes the shape of a tree reproducible. With
+    HashPriority the priority of a node is a hash of its item instead, so
+    every set of items has exactly one shape however it was built.
+
+    Aggregate is a monoid like SumAggregate summarizing the items of every
+    subtree. Each node then stores the summary of its subtree, recomputed
+    by rotations and along the path of every insert and erase, so aggregate
+    summarizes any range in O(log n). With NoAggregate, the default, the
+    nodes are plain BSTNodes and none of this work is compiled in
+
+Data Fields:
+    priorities (Priority) - the source of the priorities of our nodes
 
 Public functions:
-    insert        - Inserts a node into our RST if it does not exist yet
-    BSTinsert     - Calls the insert function of BST class
-    findAndRotate - Finds a node in the tree and rotates it left or right
+    RST               - Creates an empty RST ordered by a Compare
+    seed              - Restarts the priorities of our RST from a seed
+    insert            - Inserts a node into our RST if it does not exist yet
+    BSTinsert         - Calls the insert function of BST class
+    findAndRotate     - Finds a node in the tree and rotates it left or right
+    build_from_sorted - Builds an RST from a sorted range in linear time
+    freeze            - Copies our items into a read-only FrozenRST
+    split             - Splits our RST into the items below and above a key
+    merge             - Merges two RSTs whose items do not interleave
+    union_with        - Adds the items of another RST to ours
+    intersect_with    - Keeps only the items also found in another RST
+    difference_with   - Removes the items of another RST from ours
+    build_parallel    - Builds an RST from an unsorted range on a TaskPool
+    filter            - Copies the items passing a test into a new RST
+    map               - Builds a tree of the results of a function
+    erase             - Removes an item, an iterator or a range of iterators
+    aggregate         - Summarizes the items of a range, or of the whole RST
 ******************************************************************************/
-template <typename Data>
-class RST : public BST<Data> {
+template <typename Data, template<typename> class Alloc = NodePool,
+          typename Compare = std::less<Data>, typename Priority = Xoshiro256,
+          typename Aggregate = NoAggregate>
+class RST : public BST<Data, Alloc, Compare,
+                       typename AggregateNodeOf<Data, Aggregate>::type> {
+
+protected:
+
+  typedef BST<Data, Alloc, Compare,
+              typename AggregateNodeOf<Data, Aggregate>::type> Base;
+
+  /** Whether our nodes keep a summary of their subtrees */
+  static const bool aggregated = !std::is_same<Aggregate, NoAggregate>::value;
+
+  Priority priorities;
 
 public:
 
 
+  /****************************************************************************
+  Function Name:  RST
+  Purpose:        This function initializes an empty RST
+  Input:          comp: the comparator ordering our items
+  Result:         An empty RST is created
+  ****************************************************************************/
+  explicit RST(const Compare& comp = Compare())
+      : Base(comp) {  }
+
+
+  /****************************************************************************
+  Function Name:  seed
+  Purpose:        This function restarts the priorities of our RST
+  Description:    Inserting the same items in the same order after the same
+                  seed always gives the same shape. Nodes already in our RST
+                  keep their priorities
+  Input:          s:  the seed of our priority source
+  ****************************************************************************/
+  void seed(std::uint64_t s) {
+    priorities.seed(s);
+  }
+
+
   /****************************************************************************
   Function Name:  insert
   Purpose:        This function inserts an item into our RST
-  Description:    This function calls BSTinsert to insert a node into our RST.
+  Description:    This function calls insertNode to insert a node into our RST.
                   It then checks to see if the insert is successful or not. If
-                  it is, it will check to see if the priority of the node
-                  matches with the structure of the RST. If not, it will rotate
-                  the node either to the left or to the right depending on its
-                  position. It will keep doing this until the node is in a
-                  position where both the BST and treap properties are met
+                  it is, rotateUp gives the node its priority and moves it to
+                  where both the BST and treap properties are met
   Input:          item: the data of the BSTNode we are attempting to insert 
                   into our tree
   Result:         true if the insert was performed successfully
                   false if the insert was performed unsuccessfully
   ****************************************************************************/
   virtual bool insert(const Data& item) {
+    BSTNode<Data>* insertingNode = Base::insertNode(item);
 
-    /* Variable to indicate whether insertiong was successful or not */
-    bool inserted = false;
+    /* If statement is executed when item was already in our RST */
+    if (!insertingNode)
+      return false;
 
-    BSTNode<Data>* current = BST<Data>::root;
-    BSTNode<Data>* insertingNode = new BSTNode<Data> (item);
+    rotateUp(insertingNode);
+    return true;
+  }
 
-    /* If statement is executed when current does not exist */
-    if (!current) {
-      BST<Data>::root = insertingNode;
-      inserted = true;
-    }
+  virtual bool insert(Data&& item) {
+    bool inserted;
+    BSTNode<Data>* insertingNode =
+      Base::emplaceNode(item, inserted, std::move(item));
 
-    /* While loop is executed while current exists */
-    while (current) {
+    /* If statement is executed when item was new to our RST */
+    if (inserted)
+      rotateUp(insertingNode);
 
-      /* If statement is executed when data of current is less than item */
-      if (current -> data < item) {
+    return inserted;
+  }
 
-        /* If statement is executed when current's right child doesn't exist */
-        if (!current -> right) {
 
-          /* We set insertingNode as current's right child and set our variable
-           * to true */
-          current -> right = insertingNode;
-          current -> right -> parent = current;
-          inserted = true;
-          break;
-        }
+  /****************************************************************************
+  Function Name:  insert
+  Purpose:        This function inserts an item next to a hint
+  Description:    This function calls emplaceNear, which climbs from the node
+                  of hint only as far as it has to, and rotates the new leaf
+                  up. A hint of end() starts from the last node, so appending
+                  sorted items takes O(1) expected comparisons and rotations
+                  each, and items d positions from hint O(log d)
+  Input:          hint: an iterator to an item close to item, or end()
+                  item: the data of the BSTNode we are attempting to insert
+  Result:         Returns an iterator to item, newly inserted or not
+  ****************************************************************************/
+  typename Base::iterator
+  insert(typename Base::iterator hint, const Data& item) {
+    return insertNear(hint, item, item);
+  }
 
-        else
+  typename Base::iterator
+  insert(typename Base::iterator hint, Data&& item) {
+    return insertNear(hint, item, std::move(item));
+  }
 
-          /* Recursion is used to traverse down the right subtree */
-          current = current -> right;
-      }
+  /****************************************************************************
+  Function Name:  erase
+  Purpose:        This function removes an item from our RST
+  Description:    This function finds the node holding item and calls
+                  eraseNode on it
+  Input:          item: the data of the BSTNode we are attempting to remove
+  Result:         true if item was found and removed
+                  false if item was not in our RST
+  ****************************************************************************/
+  bool erase(const Data& item) {
+    typename Base::iterator it =
+      Base::find(item);
 
-      /* Else if statement is executed when data of current is greater than
-       * item */
-      else if (item < current -> data) {
+    /* If statement is executed when item is not in our RST */
+    if (it == Base::end())
+      return false;
 
-        /* If statement is executed when current's left child doesn't exist */
-        if (!current -> left) {
+    eraseNode(Base::nodeOf(it));
+    return true;
+  }
 
-          /* We set insertingNode as current's left child and set our variable
-           * to true */
-          current -> left = insertingNode;
-          current -> left -> parent = current;
-          inserted = true;
-          break;
-        }
 
-        else
+  /****************************************************************************
+  Function Name:  erase
+  Purpose:        This function removes the item an iterator points to
+  Description:    This function finds the successor of the node first, since
+                  nodes never move in memory while others are rotated around
+                  them, and then calls eraseNode
+  Input:          position: a valid, dereferenceable iterator into our RST
+  Result:         Returns an iterator to the item after the removed one
+  ****************************************************************************/
+  typename Base::iterator
+  erase(typename Base::iterator position) {
+    typename Base::iterator next = position;
+    ++next;
+    eraseNode(Base::nodeOf(position));
+    return next;
+  }
 
-          /* Recursion is used to traverse down the left subtree */
-          current = current -> left;
-      }
 
-      else
-        break;
+  /****************************************************************************
+  Function Name:  erase
+  Purpose:        This function removes a range of items from our RST
+  Description:    This function splits our tree around the first item of the
+                  range and around last, frees the middle part in one
+                  postorder pass and joins the outer parts again. With k items
+                  in the range this takes O(log n + k) time instead of k
+                  separate searches
+  Input:          first:  iterator to the first item to remove
+                  last:   iterator past the last item to remove
+  Result:         Returns last
+  ****************************************************************************/
+  typename Base::iterator
+  erase(typename Base::iterator first,
+        typename Base::iterator last) {
+
+    /* If statement is executed when the range is empty */
+    if (first == last)
+      return last;
+
+    BSTNode<Data>* lowNode = Base::nodeOf(first);
+    BSTNode<Data>* highNode = Base::nodeOf(last);
+
+    BSTNode<Data>* left;
+    BSTNode<Data>* middle;
+    BSTNode<Data>* right = nullptr;
+    BSTNode<Data>* equal = nullptr;
+    splitNodes(Base::root, lowNode -> data, left, middle,
+               equal);
+
+    /* If statement is executed when the range stops before the end */
+    if (highNode) {
+      BSTNode<Data>* high = nullptr;
+      splitNodes(middle, highNode -> data, middle, right, high);
+      right = joinNodes(high, right);
     }
 
-    /* If statement is executed when insertion is successful */
+    unsigned int removed = Base::deleteAll(middle) +
+                           Base::deleteAll(equal);
+
+    adopt(joinNodes(left, right), Base::isize - removed);
+
+    return last;
+  }
+
+protected:
+
+
+  /****************************************************************************
+  Function Name:  priorityOf
+  Purpose:        This function gives the priority of a new node
+  Description:    Sources which hash the item are handed the item, and random
+                  number generators are simply asked for their next number
+  Input:          item: the item of the new node
+  Result:         Returns the priority of the node holding item
+  ****************************************************************************/
+  std::uint64_t priorityOf(const Data& item) {
+    if constexpr (std::is_invocable<Priority&, const Data&>::value)
+      return priorities(item);
+    else
+      return priorities();
+  }
+
+
+  /****************************************************************************
+  Function Name:  insertNear
+  Purpose:        This function inserts an item next to a hint
+  Input:          hint: an iterator to an item close to key, or end()
+                  key:  the item we are looking for
+                  args: the arguments for the constructor of the BSTNode
+  Result:         Returns an iterator to key, newly inserted or not
+  ****************************************************************************/
+  template<typename... Args>
+  typename Base::iterator
+  insertNear(typename Base::iterator hint,
+             const Data& key, Args&&... args) {
+    BSTNode<Data>* near = Base::nodeOf(hint);
+    bool inserted;
+    BSTNode<Data>* n = Base::emplaceNear(
+      near ? near : Base::rightmost, key, inserted,
+      std::forward<Args>(args)...);
+
+    /* If statement is executed when key was new to our RST */
     if (inserted)
-      ++BST<Data>::isize;
+      rotateUp(n);
 
-    else {
+    return typename Base::iterator(
+      n, &this -> rightmost);
+  }
+
+
+  /****************************************************************************
+  Function Name:  rotateUp
+  Purpose:        This function gives a new leaf its place in our RST
+  Description:    This function gives n its priority. It will then check
+                  to see if the priority of the node matches with the
+                  structure of the RST. If not, it will rotate the node either
+                  to the left or to the right depending on its position. It
+                  will keep doing this until the node is in a position where
+                  both the BST and treap properties are met
+  Input:          n:  the leaf just linked in by insertNode or emplaceNode
+  Result:         n is at the position its priority calls for
+  ****************************************************************************/
+  void rotateUp(BSTNode<Data>* n) {
+    BSTNode<Data>* current = n -> parent;
+    n -> priority = priorityOf(n -> data);
 
-      /* We free the node created since it was not inserted into our BST */
-      delete insertingNode;
-      return inserted;
+    /* While loop executes as long as current exists and the priority of n is
+     * less than priority of current */
+    while (current && n -> priority < current -> priority) {
+
+      /* If statement is executed when current's left child is the same as
+       * n */
+      if (current -> left == n)
+        rotateRight(current, n);
+
+      else
+        rotateLeft(current, n);
+
+      current = n -> parent;
     }
 
-    insertingNode -> priority = rand();
+    updateTotals(n -> parent);
+  }
+
 
-    /* If statement is executed if current, insertingNode's parent, does not
-     * exists */
-    if (!current)
-      return inserted;
+  /****************************************************************************
+  Function Name:  eraseNode
+  Purpose:        This function removes a node from our RST
+  Description:    This function rotates n down, always lifting the child with
+                  the better priority above it, until n has at most one child.
+                  n is then replaced by that child and destroyed. Lifting the
+                  better child keeps the treap property for every other node
+  Input:          n:  the node we are removing
+  Result:         n is removed from our RST
+  ****************************************************************************/
+  void eraseNode(BSTNode<Data>* n) {
 
-    /* While loop executes as long as priority of insertingNode is less than
-     * priority of current */
-    while (insertingNode -> priority < current -> priority) {
+    /* If statement is executed when n is the first or last node, whose
+     * neighbour takes its place */
+    if (n == Base::leftmost)
+      Base::leftmost = n -> successor();
 
-      /* If statement is executed when current's left child is the same as
-       * insertingNode */
-      if (current -> left == insertingNode) {
+    if (n == Base::rightmost)
+      Base::rightmost = n -> predecessor();
 
-        /* rotateRight method is called and current is updated */
-        rotateRight(current, insertingNode);
-        current = insertingNode -> parent;
-      }
+    if (n == Base::finger)
+      Base::finger = nullptr;
 
-      else {
+    /* While loop is executed while n has two children */
+    while (n -> left && n -> right) {
 
-        /* rotateLeft method is called and current is updated */
-        rotateLeft(current, insertingNode);
-        current = insertingNode -> parent;
-      }
+      /* If statement is executed when the left child has the better
+       * priority */
+      if (n -> left -> priority < n -> right -> priority)
+        rotateRight(n, n -> left);
 
-      /* If statement is executed when current does not exist, meaning
-       *insertingNode has become the root of our RST */
-      if (!current)
-        break;
+      else
+        rotateLeft(n, n -> right);
     }
 
-    return inserted;
+    BSTNode<Data>* child = n -> left ? n -> left : n -> right;
+    BSTNode<Data>* par = n -> parent;
+
+    /* If statement is executed when n has a child to take its place */
+    if (child)
+      child -> parent = par;
+
+    /* If statement is executed when n is not the root */
+    if (par) {
+      if (par -> left == n)
+        par -> left = child;
+
+      else
+        par -> right = child;
+    }
+
+    else
+      Base::root = child;
+
+#ifdef BST_ORDER_STATISTICS
+    /* Every ancestor of n lost one node */
+    for (BSTNode<Data>* a = par; a; a = a -> parent)
+      --a -> subtreeSize;
+#endif
+
+    updateTotals(par);
+
+    Base::destroyNode(n);
+    --Base::isize;
   }
 
-private:
 
 
   /****************************************************************************
@@ -177,6 +418,7 @@ private:
                   child of child
   ****************************************************************************/
   void rotateRight( BSTNode<Data>* par, BSTNode<Data>* child ) {
+    BST_STAT(++Base::counters.rotations;)
 
     /* We create nodes to hold the data of child's right child and par's
      * parent */
@@ -199,7 +441,7 @@ private:
 
       /* We update the root since we can determine that par is the current root
        * of our tree */
-      BST<Data>::root = child;
+      Base::root = child;
 
     /* We update the left, right, and parent pointers of child and par */
     child -> right = par;
@@ -210,6 +452,10 @@ private:
     /* If statement is executed if temp exists */
     if(temp)
       temp -> parent = par;
+
+    /* par is now below child, so its size and summary are recomputed first */
+    update(par);
+    update(child);
   }
 
 
@@ -228,6 +474,7 @@ private:
                   child of child
   ****************************************************************************/
   void rotateLeft( BSTNode<Data>* par, BSTNode<Data>* child ) {
+    BST_STAT(++Base::counters.rotations;)
 
     /* We create nodes to hold the data of child's left child and par's
      * parent */
@@ -250,7 +497,7 @@ private:
 
       /* We update the root since we can determine that par is the current root
        * of our tree */
-      BST<Data>::root = child;
+      Base::root = child;
 
     /* We update the left, right, and parent pointers of child and par */
     child -> left = par;
@@ -261,6 +508,10 @@ private:
     /* If statement is executed if temp exists */
     if(temp)
       temp -> parent = par;
+
+    /* par is now below child, so its size and summary are recomputed first */
+    update(par);
+    update(child);
   }
 
 public:
@@ -279,7 +530,10 @@ public:
                   false if the node was inserted unsuccessfully
   ****************************************************************************/
   bool BSTinsert(const Data& item) { 
-    return BST<Data>::insert(item);
+    BSTNode<Data>* n = Base::insertNode(item);
+    if (n)
+      updateTotals(n -> parent);
+    return n != nullptr;
   }
  
 
@@ -298,20 +552,9 @@ public:
                   -1 if the rotation failed for other reasons
   ****************************************************************************/
   int findAndRotate(const Data& item, bool leftOrRight) {
-     BSTNode<Data>* current = RST<Data>::root;
-     while ( current != 0 ) {
-       if ( item < current->data ) {
-         current = current->left;
-       }
-       else if ( current->data < item ) {
-         current = current->right;
-       }
-       else {  // already in the tree
-         break;
-       }
-     }
+     BSTNode<Data>* current = Base::findNode(item);
      
-     if (current == 0 or current->data != item) {
+     if (current == 0) {
        return 1;
      }
      
@@ -341,6 +584,1278 @@ public:
      }
      return 0;
   }
+
+  /****************************************************************************
+  Function Name:  build_from_sorted
+  Purpose:        This function builds an RST from a sorted range in O(n)
+  Description:    This function gives every item a random priority and builds
+                  the treap as a Cartesian tree. The right spine of the tree
+                  built so far acts as a stack: each new node climbs it through
+                  parent pointers while its priority beats the spine node,
+                  takes the last node it passed as its left child and becomes
+                  the right child of the node it stopped at. Every node is
+                  climbed past at most once, so no comparisons of items are
+                  needed to build the tree. The nodes are created in one block.
+
+                  If verify is true, one pass compares each pair of neighbours
+                  first. The pass is branch free, so the compiler can
+                  vectorize it for arithmetic items. Duplicates found by it are
+                  skipped, and if the range turns out not to be sorted the
+                  items are inserted one at a time instead. If verify is false
+                  the range must be strictly increasing
+  Input:          first:  iterator to the first item of the range
+                  last:   iterator past the last item of the range
+                  verify: whether to check the range for order and duplicates
+                  comp:   the comparator the range is sorted by
+  Result:         Returns an RST holding every item of the range
+  ****************************************************************************/
+  template<typename Iterator>
+  static RST build_from_sorted(Iterator first, Iterator last,
+                               bool verify = true,
+                               const Compare& comp = Compare()) {
+    RST built(comp);
+
+    /* If statement is executed when the range is empty */
+    if (first == last)
+      return built;
+
+    bool increasing = true;
+    bool sorted = true;
+
+    /* If statement is executed when the range has to be checked */
+    if (verify) {
+      Iterator prev = first;
+      for (Iterator it = std::next(first); it != last; ++prev, ++it)
+        increasing &= built.comp.less(*prev, *it);
+
+      /* If statement is executed when some neighbours were not increasing,
+       * meaning the range has duplicates or is not sorted at all */
+      if (!increasing) {
+        prev = first;
+        for (Iterator it = std::next(first); it != last; ++prev, ++it)
+          sorted &= !built.comp.less(*it, *prev);
+      }
+    }
+
+    /* If statement is executed when the range is not sorted */
+    if (!sorted) {
+      for (; first != last; ++first)
+        built.insert(*first);
+      return built;
+    }
+
+    built.alloc.reserve(std::distance(first, last));
+
+    BSTNode<Data>* spine = nullptr;
+    unsigned int count = 0;
+    Iterator prev = first;
+
+    for (Iterator it = first; it != last; prev = it, ++it) {
+
+      /* If statement is executed when the item is a duplicate of the last */
+      if (!increasing && it != first && !built.comp.less(*prev, *it))
+        continue;
+
+      BSTNode<Data>* n = built.createNode(*it);
+      n -> priority = built.priorityOf(n -> data);
+      ++count;
+
+      BSTNode<Data>* current = spine;
+      BSTNode<Data>* passed = nullptr;
+
+      /* While loop is executed while n belongs above the spine node */
+      while (current && n -> priority < current -> priority) {
+        passed = current;
+        current = current -> parent;
+      }
+
+      /* If statement is executed when n takes over the nodes it passed */
+      if (passed) {
+        n -> left = passed;
+        passed -> parent = n;
+      }
+
+      /* If statement is executed when n hangs below a spine node */
+      if (current) {
+        current -> right = n;
+        n -> parent = current;
+      }
+
+      else
+        built.root = n;
+
+      spine = n;
+    }
+
+#ifdef BST_ORDER_STATISTICS
+    updateSizes(built.root);
+#else
+    if (aggregated)
+      updateSizes(built.root);
+#endif
+
+    built.findEnds();
+    built.isize = count;
+    return built;
+  }
+
+
+  /****************************************************************************
+  Function Name:  freeze
+  Purpose:        This function creates a read-only copy of our RST
+  Description:    This function walks our items in order and hands them to
+                  FrozenRST, which lays them out for branchless searching.
+                  Our RST is not changed and later changes to it do not show
+                  up in the copy
+  Result:         Returns a FrozenRST holding every item of our RST
+  ****************************************************************************/
+  FrozenRST<Data, Compare> freeze() const {
+    return FrozenRST<Data, Compare>(Base::begin(),
+                                    Base::end(),
+                                    Base::comp.get());
+  }
+
+  /****************************************************************************
+  Function Name:  split
+  Purpose:        This function splits our RST into two RSTs around a key
+  Description:    This function walks down the path to key once, cutting every
+                  node on it to the left or right side, so it takes O(log n)
+                  time and creates no nodes. Both halves share the blocks of
+                  our allocator but keep free lists of their own, so they
+                  may be changed on different threads. Our RST is left
+                  empty. With BST_ORDER_STATISTICS the sizes of the halves
+                  are read off their roots. Otherwise the smaller half is
+                  counted, adding time proportional to its size. The right
+                  half continues our priorities and the left half gets a
+                  fork of them
+  Input:          key:  the item separating the two halves
+  Result:         Returns an RST with every item less than key, and an RST
+                  with every item greater than or equal to key
+  ****************************************************************************/
+  std::pair<RST, RST> split(const Data& key) {
+    BSTNode<Data>* left;
+    BSTNode<Data>* right;
+    BSTNode<Data>* equal = nullptr;
+    splitNodes(Base::root, key, left, right, equal);
+
+    /* If statement is executed when key was in our RST, which now belongs at
+     * the front of the right half */
+    if (equal)
+      right = joinNodes(equal, right);
+
+    std::pair<RST, RST> halves(RST(Base::comp.get()),
+                               RST(Base::comp.get()));
+#ifdef BST_ORDER_STATISTICS
+    unsigned int below = BSTNode<Data>::sizeOf(left);
+#else
+    bool leftSmaller;
+    unsigned int smaller = countSmaller(left, right, leftSmaller);
+    unsigned int below = leftSmaller ? smaller : Base::isize - smaller;
+#endif
+    halves.first.adopt(left, below);
+    halves.second.adopt(right, Base::isize - below);
+    halves.first.priorities = priorities.fork();
+    halves.second.priorities = priorities;
+    halves.first.alloc = Base::alloc.share();
+    halves.second.alloc = std::move(Base::alloc);
+
+    Base::root = nullptr;
+    Base::isize = 0;
+    Base::findEnds();
+    return halves;
+  }
+
+
+  /****************************************************************************
+  Function Name:  merge
+  Purpose:        This function merges two RSTs into one
+  Description:    This function joins the right spine of left with the left
+                  spine of right by priority, taking O(log n) time. Every item
+                  of left must be less than every item of right. The
+                  allocators of both RSTs are joined, and both RSTs are left
+                  empty
+  Input:          left:   the RST holding the smaller items
+                  right:  the RST holding the larger items
+  Result:         Returns an RST holding every item of left and right
+  ****************************************************************************/
+  static RST merge(RST&& left, RST&& right) {
+    RST merged(left.comp.get());
+    merged.priorities = left.priorities;
+    merged.alloc = std::move(left.alloc);
+    merged.alloc.absorb(right.alloc);
+    merged.adopt(joinNodes(left.root, right.root),
+                 left.isize + right.isize);
+
+    left.forget();
+    right.forget();
+    return merged;
+  }
+
+
+  /****************************************************************************
+  Function Name:  union_with
+  Purpose:        This function adds every item of another RST to our RST
+  Description:    This function keeps the root with the better priority, splits
+                  the other tree by the item of that root, and recurses on the
+                  left and right pairs. With m the size of the smaller RST and
+                  n the size of the larger one this takes O(m log(n/m + 1))
+                  time. Nodes of other are moved, not copied, and duplicates
+                  are destroyed. Given a pool, the two pairs are united in
+                  parallel until they hold about pool.grain() items
+  Input:          other:  the RST whose items we are adding, left empty
+                  pool:   the threads uniting the pairs
+  Result:         Our RST holds every item of both RSTs
+  ****************************************************************************/
+  void union_with(RST&& other) {
+    unionTrees(other, nullptr);
+  }
+
+  void union_with(RST&& other, TaskPool& pool) {
+    unionTrees(other, &pool);
+  }
+
+
+  /****************************************************************************
+  Function Name:  intersect_with
+  Purpose:        This function keeps only the items also in another RST
+  Description:    This function works like union_with, but a root is only kept
+                  if its item was found while splitting the other tree. Nodes
+                  which are not kept are destroyed
+  Input:          other:  the RST whose items we intersect with, left empty
+                  pool:   the threads intersecting the pairs
+  Result:         Our RST holds the items in both RSTs
+  ****************************************************************************/
+  void intersect_with(RST&& other) {
+    intersectTrees(other, nullptr);
+  }
+
+  void intersect_with(RST&& other, TaskPool& pool) {
+    intersectTrees(other, &pool);
+  }
+
+
+  /****************************************************************************
+  Function Name:  difference_with
+  Purpose:        This function removes every item of another RST from ours
+  Description:    This function splits the other tree by the item of our root
+                  and recurses on the left and right pairs. Our root is removed
+                  if its item was found while splitting, and the remaining
+                  subtrees are joined. Every node of other is destroyed
+  Input:          other:  the RST whose items we are removing, left empty
+                  pool:   the threads working on the pairs
+  Result:         Our RST holds the items which are not in other
+  ****************************************************************************/
+  void difference_with(RST&& other) {
+    differenceTrees(other, nullptr);
+  }
+
+  void difference_with(RST&& other, TaskPool& pool) {
+    differenceTrees(other, &pool);
+  }
+
+
+  /****************************************************************************
+  Function Name:  build_parallel
+  Purpose:        This function builds an RST from an unsorted range
+  Description:    This function copies the range and sorts it with a
+                  parallel merge sort, whose runs of about pool.grain() items
+                  are sorted and merged on every thread of pool. The sorted
+                  items are then cut into pieces, each built by
+                  build_from_sorted on its own thread without duplicates, and
+                  neighbouring pieces are merged in O(log n) each. The work is
+                  that of the sort, O(n log n), and the span O(log^2 n)
+  Input:          first:  iterator to the first item of the range
+                  last:   iterator past the last item of the range
+                  pool:   the threads building the RST
+                  comp:   the comparator ordering the items
+  Result:         Returns an RST holding every item of the range
+  ****************************************************************************/
+  template<typename Iterator>
+  static RST build_parallel(Iterator first, Iterator last,
+                            TaskPool& pool = TaskPool::shared(),
+                            const Compare& comp = Compare()) {
+    std::vector<Data> items(first, last);
+    sortItems(items, pool, comp);
+    return buildPieces(items, 0, items.size(), pool, comp);
+  }
+
+
+  /****************************************************************************
+  Function Name:  filter
+  Purpose:        This function copies the items passing a test
+  Description:    This function copies our RST in parallel on disjoint
+                  subtrees, leaving out the nodes failing pred and joining
+                  their subtrees instead. The copies keep the priorities of
+                  our nodes, so no item is compared and the new RST takes
+                  O(n) work. pred may be called from several threads at once
+  Input:          pred: the test an item must pass to be copied
+                  pool: the threads copying the subtrees
+  Result:         Returns an RST holding the items of ours passing pred
+  ****************************************************************************/
+  template<typename Predicate>
+  RST filter(Predicate pred, TaskPool& pool = TaskPool::shared()) const {
+    RST filtered(Base::comp.get());
+    filtered.priorities = priorities;
+    unsigned int kept = 0;
+    BSTNode<Data>* n = filtered.filterNodes(
+      Base::root, pred, kept, &pool,
+      forkDepth(&pool, Base::size()));
+    filtered.adopt(n, kept);
+    return filtered;
+  }
+
+
+  /****************************************************************************
+  Function Name:  map
+  Purpose:        This function builds an RST of the results of a function
+  Description:    This function cuts our RST into subtrees of about
+                  pool.grain() items and the nodes above them, and maps each
+                  into a vector of its own in parallel. The results, which
+                  need not be in order, are then built into an RST by
+                  build_parallel. Equal results are kept once. f may be
+                  called from several threads at once. The tree built is
+                  Target when the caller names one, like map<Tree>(f). When
+                  f returns our own type of item it is a tree like ours,
+                  ordered by a copy of our comparator, and otherwise an
+                  RST<Result, Alloc>
+  Input:          f:    the function applied to every item
+                  pool: the threads mapping the subtrees
+  Result:         Returns a tree holding f of every item of ours
+  ****************************************************************************/
+  template<typename Target = void, typename Function,
+           typename Result = typename std::decay<
+             typename std::invoke_result<Function&, const Data&>::type>::type,
+           typename Tree = typename std::conditional<
+             !std::is_void<Target>::value, Target,
+             typename std::conditional<std::is_same<Result, Data>::value,
+                                       RST, RST<Result, Alloc> >::type>::type>
+  Tree map(Function f, TaskPool& pool = TaskPool::shared()) const {
+    std::vector< std::pair<const BSTNode<Data>*, bool> > pieces;
+    cutPieces(Base::root,
+              forkDepth(&pool, Base::size()), pieces);
+
+    std::vector< std::vector<Result> > results(pieces.size());
+    mapPieces(pieces, results, 0, pieces.size(), f, pool);
+
+    std::vector<Result> all;
+    for (std::size_t i = 0; i < results.size(); ++i)
+      all.insert(all.end(), std::make_move_iterator(results[i].begin()),
+                 std::make_move_iterator(results[i].end()));
+
+    /* If statement is executed when the results go into a tree like ours,
+     * which keeps our order */
+    if constexpr (std::is_same<Tree, RST>::value)
+      return Tree::build_parallel(std::make_move_iterator(all.begin()),
+                                  std::make_move_iterator(all.end()), pool,
+                                  Base::comp.get());
+    else
+      return Tree::build_parallel(std::make_move_iterator(all.begin()),
+                                  std::make_move_iterator(all.end()), pool);
+  }
+
+
+  /****************************************************************************
+  Function Name:  aggregate
+  Purpose:        This function summarizes the items in a half open range
+  Description:    This function walks down to the highest node inside the
+                  range. From there one path leads to lo and another to hi,
+                  and every subtree hanging inside the range off either path
+                  adds its stored summary whole, so only O(log n) nodes are
+                  visited. Only available with an aggregate policy
+  Input:          lo: the smallest item summarized
+                  hi: the item at which the range stops
+  Result:         Returns the summary of the items x with lo <= x < hi, in
+                  order, or the identity if there are none
+  ****************************************************************************/
+  template<typename A = Aggregate>
+  typename A::Value aggregate(const Data& lo, const Data& hi) const {
+    static_assert(aggregated, "aggregate needs an aggregate policy");
+    BSTNode<Data>* t = Base::root;
+
+    /* While loop is executed while t lies outside the range */
+    while (t) {
+      if (Base::comp.less(t -> data, lo))
+        t = t -> right;
+      else if (!Base::comp.less(t -> data, hi))
+        t = t -> left;
+      else
+        break;
+    }
+
+    /* If statement is executed when no item lies inside the range */
+    if (!t)
+      return A::identity();
+
+    return A::combine(A::combine(aggregateFrom(t -> left, lo),
+                                 A::of(t -> data)),
+                      aggregateBelow(t -> right, hi));
+  }
+
+  /** Returns the summary of every item, in O(1) */
+  template<typename A = Aggregate>
+  typename A::Value aggregate() const {
+    static_assert(aggregated, "aggregate needs an aggregate policy");
+    return AggregateNode<Data, A>::totalOf(Base::root);
+  }
+
+private:
+
+
+  /****************************************************************************
+  Function Name:  aggregateFrom
+  Purpose:        This function summarizes the items of a subtree from lo on
+  Description:    Every node not below lo is summarized with its right
+                  subtree, in front of whatever was found before, and the
+                  walk goes on to its left. Other nodes are skipped to the
+                  right
+  Input:          t:  the root of the subtree
+                  lo: the smallest item summarized
+  Result:         Returns the summary of the items x below t with lo <= x
+  ****************************************************************************/
+  template<typename A = Aggregate>
+  typename A::Value aggregateFrom(const BSTNode<Data>* t,
+                                  const Data& lo) const {
+    typedef AggregateNode<Data, A> Node;
+    typename A::Value found = A::identity();
+
+    /* While loop is executed until we fall off the subtree */
+    while (t) {
+      if (Base::comp.less(t -> data, lo))
+        t = t -> right;
+
+      else {
+        found = A::combine(A::combine(A::of(t -> data),
+                                      Node::totalOf(t -> right)), found);
+        t = t -> left;
+      }
+    }
+    return found;
+  }
+
+
+  /****************************************************************************
+  Function Name:  aggregateBelow
+  Purpose:        This function summarizes the items of a subtree below hi
+  Description:    This function mirrors aggregateFrom: every node below hi is
+                  summarized with its left subtree, behind whatever was found
+                  before, and the walk goes on to its right
+  Input:          t:  the root of the subtree
+                  hi: the item at which the range stops
+  Result:         Returns the summary of the items x below t with x < hi
+  ****************************************************************************/
+  template<typename A = Aggregate>
+  typename A::Value aggregateBelow(const BSTNode<Data>* t,
+                                   const Data& hi) const {
+    typedef AggregateNode<Data, A> Node;
+    typename A::Value found = A::identity();
+
+    /* While loop is executed until we fall off the subtree */
+    while (t) {
+      if (!Base::comp.less(t -> data, hi))
+        t = t -> left;
+
+      else {
+        found = A::combine(found, A::combine(Node::totalOf(t -> left),
+                                             A::of(t -> data)));
+        t = t -> right;
+      }
+    }
+    return found;
+  }
+
+
+  /****************************************************************************
+  Function Name:  adopt
+  Purpose:        This function makes a subtree the whole of our RST
+  Input:          n:      the root of the subtree, or nullptr
+                  count:  the number of nodes in the subtree
+  Result:         n becomes our root and count our size
+  ****************************************************************************/
+  void adopt(BSTNode<Data>* n, unsigned int count) {
+    if (n)
+      n -> parent = nullptr;
+
+    Base::root = n;
+    Base::isize = count;
+    Base::findEnds();
+  }
+
+
+  /****************************************************************************
+  Function Name:  forget
+  Purpose:        This function empties an RST whose nodes were moved away
+  Description:    This function drops our root without destroying any node and
+                  lets go of our allocator, whose blocks now belong to the RST
+                  that took our nodes
+  Result:         An empty RST
+  ****************************************************************************/
+  void forget() {
+    Base::root = nullptr;
+    Base::isize = 0;
+    Base::findEnds();
+    Base::alloc.release();
+  }
+
+
+  /****************************************************************************
+  Function Name:  unionTrees
+  Purpose:        This function adds every item of another RST to our RST
+  Input:          other:  the RST whose items we are adding, left empty
+                  pool:   the threads uniting subtrees, or nullptr
+  Result:         Our RST holds every item of both RSTs
+  ****************************************************************************/
+  void unionTrees(RST& other, TaskPool* pool) {
+    unsigned int duplicates = 0;
+    Base::alloc.absorb(other.alloc);
+
+    unsigned int total = Base::isize + other.isize;
+    unsigned int depth = 0;
+    if (pool)
+      depth = forkDepth(pool, Base::size() + other.size());
+    BSTNode<Data>* n = unionNodes(Base::root, other.root,
+                                  duplicates, pool, depth);
+    adopt(n, total - duplicates);
+    other.forget();
+  }
+
+
+  /****************************************************************************
+  Function Name:  intersectTrees
+  Purpose:        This function keeps only the items also in another RST
+  Input:          other:  the RST whose items we intersect with, left empty
+                  pool:   the threads intersecting subtrees, or nullptr
+  Result:         Our RST holds the items in both RSTs
+  ****************************************************************************/
+  void intersectTrees(RST& other, TaskPool* pool) {
+    unsigned int kept = 0;
+    Base::alloc.absorb(other.alloc);
+    unsigned int depth = 0;
+    if (pool)
+      depth = forkDepth(pool, Base::size() + other.size());
+    BSTNode<Data>* n = intersectNodes(Base::root,
+                                      other.root, kept, pool, depth);
+    adopt(n, kept);
+    other.forget();
+  }
+
+
+  /****************************************************************************
+  Function Name:  differenceTrees
+  Purpose:        This function removes every item of another RST from ours
+  Input:          other:  the RST whose items we are removing, left empty
+                  pool:   the threads working on subtrees, or nullptr
+  Result:         Our RST holds the items which are not in other
+  ****************************************************************************/
+  void differenceTrees(RST& other, TaskPool* pool) {
+    unsigned int removed = 0;
+    Base::alloc.absorb(other.alloc);
+
+    unsigned int before = Base::isize;
+    unsigned int depth = 0;
+    if (pool)
+      depth = forkDepth(pool, Base::size() + other.size());
+    BSTNode<Data>* n = differenceNodes(Base::root,
+                                       other.root, removed, pool, depth);
+    adopt(n, before - removed);
+    other.forget();
+  }
+
+
+  /****************************************************************************
+  Function Name:  forkDepth
+  Purpose:        This function decides how deep a bulk operation forks
+  Description:    Every level of a treap roughly halves the items below it,
+                  so forking the top depth levels leaves pieces of about
+                  pool.grain() items each
+  Input:          pool:   the threads of the operation
+                  count:  the number of items the operation works on
+  Result:         Returns the number of levels worth forking, zero if pool
+                  has a single thread
+  ****************************************************************************/
+  static unsigned int forkDepth(TaskPool* pool, std::size_t count) {
+    unsigned int depth = 0;
+
+    /* If statement is executed when other threads can take some work */
+    if (pool -> threads() > 1)
+      while (depth < 40 && (pool -> grain() << depth) < count)
+        ++depth;
+
+    return depth;
+  }
+
+
+  /****************************************************************************
+  Function Name:  forkJoin
+  Purpose:        This function works on two disjoint subtrees
+  Description:    This function runs left on our RST and right on a helper RST
+                  of its own, in parallel on pool while depth is not zero.
+                  The helper creates and destroys nodes with its own
+                  allocator and counts its own stats, so the two sides share
+                  nothing. Afterwards our allocator absorbs the helper's and
+                  our stats add up its counters
+  Input:          pool:   the threads working on the subtrees
+                  depth:  the number of levels we may still fork
+                  left:   the work on the left subtree, given the RST to use
+                  right:  the work on the right subtree, given the RST to use
+  Result:         Both sides are done
+  ****************************************************************************/
+  template<typename Left, typename Right>
+  void forkJoin(TaskPool* pool, unsigned int depth, const Left& left,
+                const Right& right) {
+
+    /* If statement is executed when the subtrees are too small to split */
+    if (!depth) {
+      left(*this);
+      right(*this);
+      return;
+    }
+
+    RST helper(Base::comp.get());
+    pool -> invoke([&] { left(*this); }, [&] { right(helper); });
+
+    Base::alloc.absorb(helper.alloc);
+    BST_STAT(Base::counters += helper.counters;)
+    BST_STAT(Base::comp.addCount(helper.comp.count());)
+  }
+
+
+  /****************************************************************************
+  Function Name:  sortItems
+  Purpose:        This function sorts a vector on every thread of a pool
+  Description:    This function merge sorts items, going back and forth
+                  between items and a copy of them so every level of merging
+                  moves each item once. Runs of at most pool.grain() items are
+                  sorted by std::sort
+  Input:          items:  the items we are sorting
+                  pool:   the threads sorting the items
+                  comp:   the comparator ordering the items
+  Result:         items is sorted
+  ****************************************************************************/
+  static void sortItems(std::vector<Data>& items, TaskPool& pool,
+                        const Compare& comp) {
+
+    /* If statement is executed when one thread sorts every item */
+    if (items.size() <= pool.grain() || pool.threads() == 1) {
+      std::sort(items.begin(), items.end(), comp);
+      return;
+    }
+
+    std::vector<Data> buffer(items);
+    sortRuns(items, buffer, 0, items.size(), false, pool, comp);
+  }
+
+
+  /****************************************************************************
+  Function Name:  sortRuns
+  Purpose:        This function sorts part of a vector in parallel
+  Input:          items:    the items we are sorting
+                  buffer:   a vector as long as items
+                  lo:       the first item of the run
+                  hi:       one past the last item of the run
+                  toBuffer: whether the sorted run belongs in buffer instead
+                            of in items
+                  pool:     the threads sorting the items
+                  comp:     the comparator ordering the items
+  Result:         The run is sorted, in buffer if toBuffer is true
+  ****************************************************************************/
+  static void sortRuns(std::vector<Data>& items, std::vector<Data>& buffer,
+                       std::size_t lo, std::size_t hi, bool toBuffer,
+                       TaskPool& pool, const Compare& comp) {
+    typedef typename std::vector<Data>::iterator Iterator;
+
+    /* If statement is executed when the run is sorted by one thread */
+    if (hi - lo <= pool.grain()) {
+      std::sort(items.begin() + lo, items.begin() + hi, comp);
+      if (toBuffer)
+        std::move(items.begin() + lo, items.begin() + hi, buffer.begin() + lo);
+      return;
+    }
+
+    std::size_t mid = lo + (hi - lo) / 2;
+    pool.invoke(
+      [&] { sortRuns(items, buffer, lo, mid, !toBuffer, pool, comp); },
+      [&] { sortRuns(items, buffer, mid, hi, !toBuffer, pool, comp); });
+
+    Iterator from = toBuffer ? items.begin() : buffer.begin();
+    Iterator to = toBuffer ? buffer.begin() : items.begin();
+    mergeRuns(from + lo, from + mid, from + mid, from + hi, to + lo, pool,
+              comp);
+  }
+
+
+  /****************************************************************************
+  Function Name:  mergeRuns
+  Purpose:        This function merges two sorted runs in parallel
+  Description:    This function takes the middle item of the longer run and
+                  finds where it falls in the shorter run. The items before
+                  and after it in both runs are merged in parallel into the
+                  two sides of out
+  Input:          a, aEnd:  the first sorted run
+                  b, bEnd:  the second sorted run
+                  out:      where the merged items are moved to
+                  pool:     the threads merging the runs
+                  comp:     the comparator ordering the items
+  Result:         out holds the items of both runs in order
+  ****************************************************************************/
+  template<typename Iterator>
+  static void mergeRuns(Iterator a, Iterator aEnd, Iterator b, Iterator bEnd,
+                        Iterator out, TaskPool& pool, const Compare& comp) {
+
+    /* If statement is executed when the runs are merged by one thread */
+    if (std::size_t((aEnd - a) + (bEnd - b)) <= pool.grain()) {
+      std::merge(std::make_move_iterator(a), std::make_move_iterator(aEnd),
+                 std::make_move_iterator(b), std::make_move_iterator(bEnd),
+                 out, comp);
+      return;
+    }
+
+    /* We make sure a is the longer run */
+    if (aEnd - a < bEnd - b) {
+      std::swap(a, b);
+      std::swap(aEnd, bEnd);
+    }
+
+    Iterator aMid = a + (aEnd - a) / 2;
+    Iterator bMid = std::lower_bound(b, bEnd, *aMid, comp);
+    Iterator outMid = out + (aMid - a) + (bMid - b);
+    pool.invoke([&] { mergeRuns(a, aMid, b, bMid, out, pool, comp); },
+                [&] { mergeRuns(aMid, aEnd, bMid, bEnd, outMid, pool, comp); });
+  }
+
+
+  /****************************************************************************
+  Function Name:  buildPieces
+  Purpose:        This function builds an RST from part of a sorted vector
+  Description:    A piece of at most pool.grain() items is rid of duplicates
+                  and built by build_from_sorted. Larger pieces are halved,
+                  moving the cut past any duplicates of the item before it so
+                  no item ends up in both halves. The halves are built in
+                  parallel and merged
+  Input:          items:  the sorted items of build_parallel, moved into the
+                          nodes
+                  lo:     the first item of the piece
+                  hi:     one past the last item of the piece
+                  pool:   the threads building the RST
+                  comp:   the comparator ordering the items
+  Result:         Returns an RST holding the items of the piece
+  ****************************************************************************/
+  static RST buildPieces(std::vector<Data>& items, std::size_t lo,
+                         std::size_t hi, TaskPool& pool,
+                         const Compare& comp) {
+
+    std::size_t mid = lo + (hi - lo + 1) / 2;
+
+    /* While loop is executed while the cut would separate duplicates */
+    while (mid < hi && !comp(items[mid - 1], items[mid]))
+      ++mid;
+
+    /* If statement is executed when the piece is built by one thread,
+     * including when it is too full of duplicates to cut */
+    if (hi - lo <= pool.grain() || pool.threads() == 1 || mid == hi) {
+      typename std::vector<Data>::iterator first = items.begin() + lo;
+      typename std::vector<Data>::iterator last = items.begin() + hi;
+      last = std::unique(first, last, [&comp](const Data& a, const Data& b) {
+        return !comp(a, b);
+      });
+      return build_from_sorted(std::make_move_iterator(first),
+                               std::make_move_iterator(last), false, comp);
+    }
+
+    RST left(comp);
+    RST right(comp);
+    pool.invoke([&] { left = buildPieces(items, lo, mid, pool, comp); },
+                [&] { right = buildPieces(items, mid, hi, pool, comp); });
+    return merge(std::move(left), std::move(right));
+  }
+
+
+  /****************************************************************************
+  Function Name:  filterNodes
+  Purpose:        This function copies the nodes of a subtree passing a test
+  Input:          t:      the root of the subtree we are copying, which
+                          belongs to another RST
+                  pred:   the test an item must pass to be copied
+                  kept:   increased for every node copied
+                  pool:   the threads copying the subtrees
+                  depth:  the number of levels we may still fork
+  Result:         Returns the root of our copy
+  ****************************************************************************/
+  template<typename Predicate>
+  BSTNode<Data>* filterNodes(const BSTNode<Data>* t, Predicate& pred,
+                             unsigned int& kept, TaskPool* pool,
+                             unsigned int depth) {
+
+    /* If statement is executed when t does not exist */
+    if (!t)
+      return nullptr;
+
+    BSTNode<Data>* left = nullptr;
+    BSTNode<Data>* right = nullptr;
+    unsigned int keptRight = 0;
+    unsigned int below = depth ? depth - 1 : 0;
+    forkJoin(pool, depth,
+             [&](RST& r) {
+               left = r.filterNodes(t -> left, pred, kept, pool, below); },
+             [&](RST& r) {
+               right = r.filterNodes(t -> right, pred, keptRight, pool,
+                                     below); });
+    kept += keptRight;
+
+    /* If statement is executed when the item of t is left out */
+    if (!pred(t -> data))
+      return joinNodes(left, right);
+
+    BSTNode<Data>* n = Base::createNode(t -> data);
+    n -> priority = t -> priority;
+    ++kept;
+    return attach(n, left, right);
+  }
+
+
+  /****************************************************************************
+  Function Name:  collect
+  Purpose:        This function maps the items of a subtree into a vector
+  Input:          t:    the root of the subtree
+                  f:    the function applied to every item
+                  out:  the vector receiving the results in order
+  Result:         out holds f of every item below t
+  ****************************************************************************/
+  template<typename Result, typename Function>
+  static void collect(const BSTNode<Data>* t, Function& f,
+                      std::vector<Result>& out) {
+
+    /* If statement is executed when t exists */
+    if (t) {
+      collect(t -> left, f, out);
+      out.push_back(f(t -> data));
+      collect(t -> right, f, out);
+    }
+  }
+
+
+  /****************************************************************************
+  Function Name:  cutPieces
+  Purpose:        This function cuts a subtree into pieces for map
+  Description:    This function walks the top depth levels below t in order.
+                  A node above them is a piece on its own, and a subtree
+                  reached at depth levels down is a whole piece
+  Input:          t:      the root of the subtree we are cutting
+                  depth:  the number of levels above the whole pieces
+                  pieces: receives every piece in order, with true for a
+                          whole subtree
+  Result:         pieces covers every node below t
+  ****************************************************************************/
+  static void cutPieces(const BSTNode<Data>* t, unsigned int depth,
+        std::vector< std::pair<const BSTNode<Data>*, bool> >& pieces) {
+
+    /* If statement is executed when t does not exist */
+    if (!t)
+      return;
+
+    /* If statement is executed when the whole subtree is one piece */
+    if (!depth) {
+      pieces.push_back(std::make_pair(t, true));
+      return;
+    }
+
+    cutPieces(t -> left, depth - 1, pieces);
+    pieces.push_back(std::make_pair(t, false));
+    cutPieces(t -> right, depth - 1, pieces);
+  }
+
+
+  /****************************************************************************
+  Function Name:  mapPieces
+  Purpose:        This function maps a range of pieces in parallel
+  Input:          pieces:   the pieces cut by cutPieces
+                  results:  a vector per piece receiving its results
+                  lo:       the first piece of the range
+                  hi:       one past the last piece of the range
+                  f:        the function applied to every item
+                  pool:     the threads mapping the pieces
+  Result:         results holds f of every item of the pieces in the range
+  ****************************************************************************/
+  template<typename Result, typename Function>
+  static void mapPieces(
+      const std::vector< std::pair<const BSTNode<Data>*, bool> >& pieces,
+      std::vector< std::vector<Result> >& results, std::size_t lo,
+      std::size_t hi, Function& f, TaskPool& pool) {
+
+    /* If statement is executed when the range is a single piece */
+    if (hi - lo == 1) {
+
+      /* If statement is executed when the piece is a whole subtree */
+      if (pieces[lo].second)
+        collect(pieces[lo].first, f, results[lo]);
+
+      else
+        results[lo].push_back(f(pieces[lo].first -> data));
+
+      return;
+    }
+
+    /* If statement is executed when the range has pieces to split */
+    if (hi > lo) {
+      std::size_t mid = lo + (hi - lo) / 2;
+      pool.invoke([&] { mapPieces(pieces, results, lo, mid, f, pool); },
+                  [&] { mapPieces(pieces, results, mid, hi, f, pool); });
+    }
+  }
+
+
+  /****************************************************************************
+  Function Name:  countSmaller
+  Purpose:        This function counts the smaller of two subtrees
+  Description:    This function walks both subtrees at once, visiting one node
+                  of each in turn, and stops as soon as either runs out. It
+                  takes time proportional to the smaller subtree only
+  Input:          a:        the root of the first subtree
+                  b:        the root of the second subtree
+                  aSmaller: set to true if a is the smaller subtree
+  Result:         Returns the number of nodes in the smaller subtree
+  ****************************************************************************/
+  static unsigned int countSmaller(const BSTNode<Data>* a,
+                                   const BSTNode<Data>* b, bool& aSmaller) {
+    std::vector<const BSTNode<Data>*> aPending, bPending;
+    if (a)
+      aPending.push_back(a);
+    if (b)
+      bPending.push_back(b);
+
+    unsigned int count = 0;
+
+    /* While loop is executed while neither subtree has been counted */
+    while (!aPending.empty() && !bPending.empty()) {
+      ++count;
+      const BSTNode<Data>* n = aPending.back();
+      aPending.pop_back();
+      if (n -> left)
+        aPending.push_back(n -> left);
+      if (n -> right)
+        aPending.push_back(n -> right);
+
+      n = bPending.back();
+      bPending.pop_back();
+      if (n -> left)
+        bPending.push_back(n -> left);
+      if (n -> right)
+        bPending.push_back(n -> right);
+    }
+
+    aSmaller = aPending.empty();
+    return count;
+  }
+
+
+  /****************************************************************************
+  Function Name:  updateSizes
+  Purpose:        This function recomputes the size of every node in a subtree
+  Description:    This function performs a postorder traversal so the children
+                  of a node are always updated before the node itself. With
+                  an aggregate policy the summaries are recomputed too
+  Input:          n:  the root of the subtree
+  Result:         Every node below n knows the size of its subtree
+  ****************************************************************************/
+  static void updateSizes(BSTNode<Data>* n) {
+
+    /* If statement is executed when n exists */
+    if (n) {
+      updateSizes(n -> left);
+      updateSizes(n -> right);
+      update(n);
+    }
+  }
+
+
+  /****************************************************************************
+  Function Name:  update
+  Purpose:        This function recomputes what a node knows of its subtree
+  Description:    This function recomputes the size of n and, with an
+                  aggregate policy, its summary. The children of n must
+                  already be up to date. Without either nothing is done
+  Input:          n:  the node whose children changed
+  Result:         n knows the size and summary of its subtree
+  ****************************************************************************/
+  static void update(BSTNode<Data>* n) {
+    n -> updateSize();
+    if constexpr (aggregated)
+      static_cast<AggregateNode<Data, Aggregate>*>(n) -> updateTotal();
+  }
+
+
+  /****************************************************************************
+  Function Name:  updateTotals
+  Purpose:        This function recomputes the summaries on a path
+  Description:    This function climbs from n to the root recomputing every
+                  summary, after a node below n was added or removed. It
+                  does nothing without an aggregate policy
+  Input:          n:  the lowest node whose subtree changed, or nullptr
+  Result:         n and its ancestors know the summaries of their subtrees
+  ****************************************************************************/
+  static void updateTotals(BSTNode<Data>* n) {
+    if constexpr (aggregated)
+      for (; n; n = n -> parent)
+        static_cast<AggregateNode<Data, Aggregate>*>(n) -> updateTotal();
+  }
+
+
+  /****************************************************************************
+  Function Name:  attach
+  Purpose:        This function sets the children of a node
+  Input:          n:      the node receiving the children
+                  left:   the new left child of n, or nullptr
+                  right:  the new right child of n, or nullptr
+  Result:         Returns n with its children and their parents updated
+  ****************************************************************************/
+  static BSTNode<Data>* attach(BSTNode<Data>* n, BSTNode<Data>* left,
+                               BSTNode<Data>* right) {
+    n -> left = left;
+    n -> right = right;
+
+    if (left)
+      left -> parent = n;
+
+    if (right)
+      right -> parent = n;
+
+    update(n);
+    return n;
+  }
+
+
+  /****************************************************************************
+  Function Name:  splitNodes
+  Purpose:        This function splits a subtree around a key
+  Description:    This function follows the search path of key. Every node
+                  less than key is hung on the left result with its left
+                  subtree, and every node greater than key on the right result
+                  with its right subtree. A node equal to key is cut out with
+                  its children handed to the two sides. Priorities only ever
+                  decrease going down either result, so both remain treaps
+  Input:          t:      the root of the subtree we are splitting
+                  key:    the item we are splitting around
+                  left:   set to the root of the items less than key
+                  right:  set to the root of the items greater than key
+                  equal:  set to the node equal to key, if there is one
+  Result:         The subtree is split into left, right and equal
+  ****************************************************************************/
+  void splitNodes(BSTNode<Data>* t, const Data& key, BSTNode<Data>*& left,
+                  BSTNode<Data>*& right, BSTNode<Data>*& equal) const {
+
+    /* If statement is executed when t does not exist */
+    if (!t) {
+      left = right = nullptr;
+      return;
+    }
+
+    int order = Base::comp.order(key, t -> data);
+
+    /* If statement is executed when t belongs to the left result */
+    if (order > 0) {
+      splitNodes(t -> right, key, t -> right, right, equal);
+      if (t -> right)
+        t -> right -> parent = t;
+      update(t);
+      left = t;
+    }
+
+    /* Else if statement is executed when t belongs to the right result */
+    else if (order < 0) {
+      splitNodes(t -> left, key, left, t -> left, equal);
+      if (t -> left)
+        t -> left -> parent = t;
+      update(t);
+      right = t;
+    }
+
+    else {
+      left = t -> left;
+      right = t -> right;
+      t -> left = t -> right = nullptr;
+      update(t);
+      equal = t;
+    }
+  }
+
+
+  /****************************************************************************
+  Function Name:  joinNodes
+  Purpose:        This function joins two subtrees into one
+  Description:    This function picks whichever root has the better priority
+                  as the new root and recursively joins the other subtree with
+                  the inner child of that root
+  Input:          left:   the subtree holding the smaller items
+                  right:  the subtree holding the larger items
+  Result:         Returns the root of the joined subtree
+  ****************************************************************************/
+  static BSTNode<Data>* joinNodes(BSTNode<Data>* left, BSTNode<Data>* right) {
+
+    /* If statement is executed when either subtree does not exist */
+    if (!left)
+      return right;
+
+    if (!right)
+      return left;
+
+    /* If statement is executed when left becomes the root */
+    if (left -> priority < right -> priority)
+      return attach(left, left -> left, joinNodes(left -> right, right));
+
+    return attach(right, joinNodes(left, right -> left), right -> right);
+  }
+
+
+  /****************************************************************************
+  Function Name:  unionNodes
+  Purpose:        This function unites two subtrees
+  Input:          a:          the root of one subtree
+                  b:          the root of the other subtree
+                  duplicates: increased for every node destroyed as a
+                              duplicate
+                  pool:       the threads uniting the subtrees
+                  depth:      the number of levels we may still fork
+  Result:         Returns the root of a subtree holding the items of both
+  ****************************************************************************/
+  BSTNode<Data>* unionNodes(BSTNode<Data>* a, BSTNode<Data>* b,
+                            unsigned int& duplicates, TaskPool* pool,
+                            unsigned int depth) {
+
+    /* If statement is executed when either subtree does not exist */
+    if (!a)
+      return b;
+
+    if (!b)
+      return a;
+
+    /* We make sure a is the root with the better priority */
+    if (b -> priority < a -> priority)
+      std::swap(a, b);
+
+    BSTNode<Data>* left;
+    BSTNode<Data>* right;
+    BSTNode<Data>* equal = nullptr;
+    splitNodes(b, a -> data, left, right, equal);
+
+    /* If statement is executed when the item of a was also in b */
+    if (equal) {
+      Base::destroyNode(equal);
+      ++duplicates;
+    }
+
+    unsigned int duplicatesRight = 0;
+    unsigned int below = depth ? depth - 1 : 0;
+    forkJoin(pool, depth,
+             [&](RST& t) {
+               left = t.unionNodes(a -> left, left, duplicates, pool,
+                                   below); },
+             [&](RST& t) {
+               right = t.unionNodes(a -> right, right, duplicatesRight, pool,
+                                    below); });
+    duplicates += duplicatesRight;
+    return attach(a, left, right);
+  }
+
+
+  /****************************************************************************
+  Function Name:  intersectNodes
+  Purpose:        This function intersects two subtrees
+  Input:          a:    the root of one subtree
+                  b:    the root of the other subtree
+                  kept: increased for every node kept in the result
+                  pool:   the threads intersecting the subtrees
+                  depth:  the number of levels we may still fork
+  Result:         Returns the root of a subtree holding the items in both
+  ****************************************************************************/
+  BSTNode<Data>* intersectNodes(BSTNode<Data>* a, BSTNode<Data>* b,
+                                unsigned int& kept, TaskPool* pool,
+                                unsigned int depth) {
+
+    /* If statement is executed when either subtree does not exist */
+    if (!a || !b) {
+      Base::deleteAll(a);
+      Base::deleteAll(b);
+      return nullptr;
+    }
+
+    /* We make sure a is the root with the better priority */
+    if (b -> priority < a -> priority)
+      std::swap(a, b);
+
+    BSTNode<Data>* left;
+    BSTNode<Data>* right;
+    BSTNode<Data>* equal = nullptr;
+    splitNodes(b, a -> data, left, right, equal);
+
+    unsigned int keptRight = 0;
+    unsigned int below = depth ? depth - 1 : 0;
+    forkJoin(pool, depth,
+             [&](RST& t) {
+               left = t.intersectNodes(a -> left, left, kept, pool,
+                                       below); },
+             [&](RST& t) {
+               right = t.intersectNodes(a -> right, right, keptRight, pool,
+                                        below); });
+    kept += keptRight;
+
+    /* If statement is executed when the item of a was also in b */
+    if (equal) {
+      Base::destroyNode(equal);
+      ++kept;
+      return attach(a, left, right);
+    }
+
+    Base::destroyNode(a);
+    return joinNodes(left, right);
+  }
+
+
+  /****************************************************************************
+  Function Name:  differenceNodes
+  Purpose:        This function removes the items of one subtree from another
+  Input:          a:        the root of the subtree we are removing from
+                  b:        the root of the subtree whose items are removed
+                  removed:  increased for every node removed from a
+                  pool:     the threads working on the subtrees
+                  depth:    the number of levels we may still fork
+  Result:         Returns the root of a subtree holding the items of a which
+                  are not in b
+  ****************************************************************************/
+  BSTNode<Data>* differenceNodes(BSTNode<Data>* a, BSTNode<Data>* b,
+                                 unsigned int& removed, TaskPool* pool,
+                                 unsigned int depth) {
+
+    /* If statement is executed when either subtree does not exist */
+    if (!a || !b) {
+      Base::deleteAll(b);
+      return a;
+    }
+
+    BSTNode<Data>* left;
+    BSTNode<Data>* right;
+    BSTNode<Data>* equal = nullptr;
+    splitNodes(b, a -> data, left, right, equal);
+
+    unsigned int removedRight = 0;
+    unsigned int below = depth ? depth - 1 : 0;
+    forkJoin(pool, depth,
+             [&](RST& t) {
+               left = t.differenceNodes(a -> left, left, removed, pool,
+                                        below); },
+             [&](RST& t) {
+               right = t.differenceNodes(a -> right, right, removedRight, pool,
+                                         below); });
+    removed += removedRight;
+
+    /* If statement is executed when the item of a was also in b */
+    if (equal) {
+      Base::destroyNode(equal);
+      Base::destroyNode(a);
+      ++removed;
+      return joinNodes(left, right);
+    }
+
+    return attach(a, left, right);
+  }
 };
 
 
@@ -0,0 +1,543 @@
+/******************************************************************************
+
+File Name:    RSTMap.hpp
+Description:  This program creates a class called RSTMap, a randomized search
+              tree mapping keys to values, along with the entries it stores
+              and the iterator going through them
+
+******************************************************************************/
+
+
+#ifndef RSTMAP_HPP
+#define RSTMAP_HPP
+#include "RST.hpp"
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+
+/******************************************************************************
+class RSTMapEntry
+
+Description: Creates an RSTMapEntry, a key and its value. The key is const so
+    it cannot be changed through an iterator
+
+Data Fields:
+    first (Key const) - the key of the entry
+    second (Value)    - the value of the entry
+******************************************************************************/
+template<typename Key, typename Value>
+struct RSTMapEntry {
+
+  Key const first;
+  Value second;
+
+
+  /****************************************************************************
+  Function Name:  RSTMapEntry
+  Purpose:        This function initializes an entry
+  Description:    This function forwards key to the constructor of first and
+                  args to the constructor of second. It is not used for
+                  copies of another entry
+  Input:          key:  the key of the entry
+                  args: the arguments for the constructor of Value
+  Result:         An RSTMapEntry is created
+  ****************************************************************************/
+  template<typename K, typename... Args, typename = typename std::enable_if<
+             !std::is_same<typename std::decay<K>::type,
+                           RSTMapEntry>::value>::type>
+  RSTMapEntry(K&& key, Args&&... args)
+      : first(std::forward<K>(key)), second(std::forward<Args>(args)...) {  }
+
+  RSTMapEntry(const RSTMapEntry&) = default;
+  RSTMapEntry(RSTMapEntry&&) = default;
+};
+
+
+/******************************************************************************
+class RSTMapCompare
+
+Description: Creates an RSTMapCompare, the comparator of the RST inside an
+    RSTMap. Entries are ordered by their keys alone and may be compared with
+    a bare key, so an RSTMap can search for a key without building an entry.
+    compare orders the keys with a single comparison when KeyCompare can, so
+    a search through the map costs no more than one through a set of keys
+
+Data Fields:
+    keys (KeyCompare<Compare>) - the comparator of the keys
+******************************************************************************/
+template<typename Key, typename Value, typename Compare>
+class RSTMapCompare {
+
+  KeyCompare<Compare> keys;
+
+  static const Key& keyOf(const Key& key) {
+    return key;
+  }
+
+  static const Key& keyOf(const RSTMapEntry<Key, Value>& entry) {
+    return entry.first;
+  }
+
+public:
+
+  typedef void is_transparent;
+
+  RSTMapCompare(const Compare& comp = Compare()) : keys(comp) {  }
+
+  template<typename A, typename B>
+  bool operator()(const A& a, const B& b) const {
+    return keys.less(keyOf(a), keyOf(b));
+  }
+
+  template<typename A, typename B>
+  int compare(const A& a, const B& b) const {
+    return keys.order(keyOf(a), keyOf(b));
+  }
+
+  const Compare& get() const {
+    return keys.get();
+  }
+};
+
+
+/******************************************************************************
+class RSTMapIterator
+
+Description: Creates an RSTMapIterator, which goes through the entries of an
+    RSTMap like a BSTIterator but hands them out by mutable reference, so
+    values can be changed in place. Keys stay const. With Const the entries
+    are handed out by const reference instead, for a const RSTMap, and an
+    iterator converts to such a const iterator
+
+Template Parameters:
+    Key   - the type of the keys
+    Value - the type of the values
+    Const - true if the values may not be changed through us
+
+Data Fields:
+    it (BSTIterator<RSTMapEntry<Key, Value> >) - the iterator we step with
+******************************************************************************/
+template<typename Key, typename Value, bool Const = false>
+class RSTMapIterator {
+
+  typedef typename std::conditional<Const, const RSTMapEntry<Key, Value>,
+                                    RSTMapEntry<Key, Value> >::type Entry;
+
+  BSTIterator< RSTMapEntry<Key, Value> > it;
+
+  template<typename, typename, template<typename> class, typename>
+  friend class RSTMap;
+
+  template<typename, typename, bool>
+  friend class RSTMapIterator;
+
+public:
+
+  typedef std::bidirectional_iterator_tag iterator_category;
+  typedef RSTMapEntry<Key, Value> value_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef Entry* pointer;
+  typedef Entry& reference;
+
+  RSTMapIterator(BSTIterator< RSTMapEntry<Key, Value> > it =
+                 BSTIterator< RSTMapEntry<Key, Value> >()) : it(it) {  }
+
+  /** An iterator may always be used where a const iterator is wanted */
+  template<bool C, typename = typename std::enable_if<Const && !C>::type>
+  RSTMapIterator(const RSTMapIterator<Key, Value, C>& other)
+      : it(other.it) {  }
+
+  /** Nodes hold their entry as non-const data, so this is safe */
+  Entry& operator*() const {
+    return const_cast<RSTMapEntry<Key, Value>&>(*it);
+  }
+
+  Entry* operator->() const {
+    return &**this;
+  }
+
+  RSTMapIterator& operator++() {
+    ++it;
+    return *this;
+  }
+
+  RSTMapIterator operator++(int) {
+    RSTMapIterator before = *this;
+    ++it;
+    return before;
+  }
+
+  RSTMapIterator& operator--() {
+    --it;
+    return *this;
+  }
+
+  RSTMapIterator operator--(int) {
+    RSTMapIterator before = *this;
+    --it;
+    return before;
+  }
+
+  template<bool C>
+  bool operator==(const RSTMapIterator<Key, Value, C>& other) const {
+    return it == other.it;
+  }
+
+  template<bool C>
+  bool operator!=(const RSTMapIterator<Key, Value, C>& other) const {
+    return it != other.it;
+  }
+};
+
+
+/******************************************************************************
+class RSTMap
+
+Description: Creates an RSTMap, which keeps an RST of RSTMapEntries to map
+    every key to one value. It uses the node, search and rotation code of
+    RST: lookups compare the key with the entries directly, and inserting
+    functions only construct an entry, in place inside its node, once the
+    key is known to be missing. Values are reached by reference through
+    iterators and operator[], so they are never copied out of the tree. A
+    const RSTMap only hands out const references, through const_iterator
+
+Template Parameters:
+    Key     - the type of the keys
+    Value   - the type of the values
+    Alloc   - the allocator creating and destroying our nodes
+    Compare - the comparator ordering the keys
+
+Data Fields:
+    tree (Tree) - the RST holding our entries
+
+Public functions:
+    RSTMap           - constructor for RSTMap
+    find             - finds the entry of a key, as a const_iterator for a
+                       const RSTMap
+    contains         - checks if a key is in our RSTMap
+    at               - gives the value of a key which must be present
+    operator[]       - gives the value of a key, inserting it if missing
+    insert           - inserts an entry, copying or moving it
+    emplace          - inserts an entry built from a key and value arguments
+    try_emplace      - inserts a value built from arguments if key is missing
+    insert_or_assign - inserts a value or assigns it to an existing key
+    erase            - removes a key or the entry an iterator points to
+    size             - gives the number of entries
+    empty            - checks to see if our RSTMap is empty
+    clear            - removes every entry
+    begin            - creates iterator pointing to the first entry, const
+                       for a const RSTMap
+    end              - creates iterator pointing past the last entry, const
+                       for a const RSTMap
+******************************************************************************/
+template<typename Key, typename Value,
+         template<typename> class Alloc = NodePool,
+         typename Compare = std::less<Key> >
+class RSTMap {
+
+  typedef RSTMapCompare<Key, Value, Compare> EntryCompare;
+
+  /** Our RST, opening up the node level functions RSTMap is built on */
+  struct Tree : public RST<RSTMapEntry<Key, Value>, Alloc, EntryCompare> {
+    typedef RST<RSTMapEntry<Key, Value>, Alloc, EntryCompare> Base;
+    explicit Tree(const EntryCompare& comp) : Base(comp) {  }
+    using Base::emplaceNode;
+    using Base::findNode;
+    using Base::rotateUp;
+    using Base::eraseNode;
+    using Base::rightmost;
+  };
+
+  Tree tree;
+
+public:
+
+  typedef Key key_type;
+  typedef Value mapped_type;
+  typedef RSTMapEntry<Key, Value> value_type;
+  typedef RSTMapIterator<Key, Value> iterator;
+  typedef RSTMapIterator<Key, Value, true> const_iterator;
+
+
+  /****************************************************************************
+  Function Name:  RSTMap
+  Purpose:        This function initializes an empty RSTMap
+  Input:          comp: the comparator ordering our keys
+  Result:         An empty RSTMap is created
+  ****************************************************************************/
+  explicit RSTMap(const Compare& comp = Compare())
+      : tree(EntryCompare(comp)) {  }
+
+
+  /****************************************************************************
+  Function Name:  find
+  Purpose:        This function finds the entry of a key
+  Description:    This function compares key with the entries directly, so no
+                  entry or node is built to search with
+  Input:          key:  the key we are looking for
+  Result:         Returns an iterator to the entry of key, or end()
+  ****************************************************************************/
+  iterator find(const Key& key) {
+    return iteratorOf(tree.findNode(key));
+  }
+
+  const_iterator find(const Key& key) const {
+    return iteratorOf(tree.findNode(key));
+  }
+
+  bool contains(const Key& key) const {
+    return tree.findNode(key) != nullptr;
+  }
+
+
+  /****************************************************************************
+  Function Name:  at
+  Purpose:        This function gives the value of a key
+  Input:          key:  the key whose value we want
+  Result:         Returns a reference to the value of key
+                  Throws std::out_of_range if key is not in our RSTMap
+  ****************************************************************************/
+  Value& at(const Key& key) {
+    return nodeAt(key) -> data.second;
+  }
+
+  const Value& at(const Key& key) const {
+    return nodeAt(key) -> data.second;
+  }
+
+
+  /****************************************************************************
+  Function Name:  operator[]
+  Purpose:        This function gives the value of a key
+  Description:    This function calls try_emplace, which value-initializes
+                  the value of key if key is missing
+  Input:          key:  the key whose value we want
+  Result:         Returns a reference to the value of key
+  ****************************************************************************/
+  Value& operator[](const Key& key) {
+    return try_emplace(key).first -> second;
+  }
+
+  Value& operator[](Key&& key) {
+    return try_emplace(std::move(key)).first -> second;
+  }
+
+
+  /****************************************************************************
+  Function Name:  insert
+  Purpose:        This function inserts an entry
+  Description:    This function searches for the key of entry and copies or
+                  moves entry into a new node only if the key is missing
+  Input:          entry:  the entry we are inserting
+  Result:         Returns an iterator to the entry of its key, and true if
+                  entry was inserted or false if the key was already there
+  ****************************************************************************/
+  std::pair<iterator, bool> insert(const value_type& entry) {
+    return place(entry.first, entry);
+  }
+
+  std::pair<iterator, bool> insert(value_type&& entry) {
+    return place(entry.first, std::move(entry));
+  }
+
+
+  /****************************************************************************
+  Function Name:  emplace
+  Purpose:        This function inserts an entry built from arguments
+  Description:    This function searches for key first and only then builds
+                  the entry in its node, forwarding key and args. Unlike
+                  std::map::emplace, nothing is built when key is present
+  Input:          key:  the key of the entry
+                  args: the arguments for the constructor of Value
+  Result:         Returns an iterator to the entry of key, and true if it was
+                  inserted or false if key was already there
+  ****************************************************************************/
+  template<typename K, typename... Args>
+  std::pair<iterator, bool> emplace(K&& key, Args&&... args) {
+    return place(key, std::in_place, std::forward<K>(key),
+                 std::forward<Args>(args)...);
+  }
+
+
+  /****************************************************************************
+  Function Name:  try_emplace
+  Purpose:        This function inserts a value built from arguments
+  Description:    This function searches for key and only builds the entry,
+                  in place in a new node, if key is missing. args are left
+                  untouched otherwise
+  Input:          key:  the key of the entry
+                  args: the arguments for the constructor of Value
+  Result:         Returns an iterator to the entry of key, and true if it was
+                  inserted or false if key was already there
+  ****************************************************************************/
+  template<typename... Args>
+  std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args) {
+    return place(key, std::in_place, key, std::forward<Args>(args)...);
+  }
+
+  template<typename... Args>
+  std::pair<iterator, bool> try_emplace(Key&& key, Args&&... args) {
+    return place(key, std::in_place, std::move(key),
+                 std::forward<Args>(args)...);
+  }
+
+
+  /****************************************************************************
+  Function Name:  insert_or_assign
+  Purpose:        This function sets the value of a key
+  Description:    This function inserts an entry built from key and value if
+                  key is missing, and otherwise assigns value to the value
+                  already stored
+  Input:          key:    the key of the entry
+                  value:  the new value of key
+  Result:         Returns an iterator to the entry of key, and true if it was
+                  inserted or false if an existing value was assigned
+  ****************************************************************************/
+  template<typename V>
+  std::pair<iterator, bool> insert_or_assign(const Key& key, V&& value) {
+    bool inserted;
+    BSTNode<value_type>* n =
+      tree.emplaceNode(key, inserted, std::in_place, key,
+                        std::forward<V>(value));
+    return assignOrRotate(n, inserted, std::forward<V>(value));
+  }
+
+  template<typename V>
+  std::pair<iterator, bool> insert_or_assign(Key&& key, V&& value) {
+    bool inserted;
+    BSTNode<value_type>* n =
+      tree.emplaceNode(key, inserted, std::in_place, std::move(key),
+                        std::forward<V>(value));
+    return assignOrRotate(n, inserted, std::forward<V>(value));
+  }
+
+
+  /****************************************************************************
+  Function Name:  erase
+  Purpose:        This function removes the entry of a key
+  Input:          key:  the key we are removing
+  Result:         true if key was found and removed
+                  false if key was not in our RSTMap
+  ****************************************************************************/
+  bool erase(const Key& key) {
+    BSTNode<value_type>* n = tree.findNode(key);
+
+    /* If statement is executed when key is not in our RSTMap */
+    if (!n)
+      return false;
+
+    tree.eraseNode(n);
+    return true;
+  }
+
+  iterator erase(iterator position) {
+    return iterator(tree.erase(position.it));
+  }
+
+  unsigned int size() const {
+    return tree.size();
+  }
+
+  bool empty() const {
+    return tree.empty();
+  }
+
+  void clear() {
+    tree.clear();
+  }
+
+  iterator begin() {
+    return iterator(tree.begin());
+  }
+
+  const_iterator begin() const {
+    return const_iterator(tree.begin());
+  }
+
+  iterator end() {
+    return iterator(tree.end());
+  }
+
+  const_iterator end() const {
+    return const_iterator(tree.end());
+  }
+
+private:
+
+
+  /** An iterator pointing to n, or end() for nullptr */
+  iterator iteratorOf(BSTNode<value_type>* n) const {
+    return iterator(typename Tree::iterator(n, &tree.rightmost));
+  }
+
+
+  /****************************************************************************
+  Function Name:  nodeAt
+  Purpose:        This function finds the node of a key which must be present
+  Input:          key:  the key whose node we want
+  Result:         Returns the node of key
+                  Throws std::out_of_range if key is not in our RSTMap
+  ****************************************************************************/
+  BSTNode<value_type>* nodeAt(const Key& key) const {
+    BSTNode<value_type>* n = tree.findNode(key);
+
+    /* If statement is executed when key is not in our RSTMap */
+    if (!n)
+      throw std::out_of_range("RSTMap::at: key not found");
+
+    return n;
+  }
+
+
+  /****************************************************************************
+  Function Name:  place
+  Purpose:        This function finds or inserts the entry of a key
+  Description:    This function calls emplaceNode, which builds a node from
+                  args only if key is missing, and then gives a new node its
+                  place in the RST
+  Input:          key:  the key of the entry
+                  args: the arguments for the constructor of the node
+  Result:         Returns an iterator to the entry of key, and whether it was
+                  inserted
+  ****************************************************************************/
+  template<typename... Args>
+  std::pair<iterator, bool> place(const Key& key, Args&&... args) {
+    bool inserted;
+    BSTNode<value_type>* n =
+      tree.emplaceNode(key, inserted, std::forward<Args>(args)...);
+
+    /* If statement is executed when a new node was linked in */
+    if (inserted)
+      tree.rotateUp(n);
+
+    return std::make_pair(iteratorOf(n), inserted);
+  }
+
+
+  /****************************************************************************
+  Function Name:  assignOrRotate
+  Purpose:        This function finishes insert_or_assign
+  Input:          n:        the node of the key
+                  inserted: true if n was just created from value
+                  value:    the value to assign if n already existed
+  Result:         Returns an iterator to n, and inserted
+  ****************************************************************************/
+  template<typename V>
+  std::pair<iterator, bool> assignOrRotate(BSTNode<value_type>* n,
+                                           bool inserted, V&& value) {
+
+    /* If statement is executed when a new node was linked in */
+    if (inserted)
+      tree.rotateUp(n);
+
+    else
+      n -> data.second = std::forward<V>(value);
+
+    return std::make_pair(iteratorOf(n), inserted);
+  }
+};
+
+#endif // RSTMAP_HPP
@@ -0,0 +1,300 @@
+/******************************************************************************
+
+File Name:    RSTMultiset.hpp
+Description:  This program creates a class called RSTMultiset, a randomized
+              search tree holding any number of copies of every key, along
+              with the iterator going through them
+
+******************************************************************************/
+
+
+#ifndef RSTMULTISET_HPP
+#define RSTMULTISET_HPP
+#include "RSTMap.hpp"
+#include <cstddef>
+#include <iterator>
+
+
+/******************************************************************************
+class RSTMultisetIterator
+
+Description: Creates an RSTMultisetIterator, which goes through the keys of an
+    RSTMultiset in order. An expanding iterator hands out every key as many
+    times as it was inserted, counting its way through the copies of a node
+    before stepping on, while a distinct iterator hands out every key once
+
+Template Parameters:
+    Data   - the type of the keys
+    Expand - true to visit every copy of a key, false to visit it once
+
+Data Fields:
+    it (RSTMapIterator<Data, unsigned int, true>) - the entry of the current
+                                                    key
+    copy (unsigned int)                           - the copy of the key we are
+                                                    at, always 0 when not
+                                                    expanding
+******************************************************************************/
+template<typename Data, bool Expand>
+class RSTMultisetIterator {
+
+  RSTMapIterator<Data, unsigned int, true> it;
+  unsigned int copy;
+
+public:
+
+  typedef std::bidirectional_iterator_tag iterator_category;
+  typedef Data value_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef const Data* pointer;
+  typedef const Data& reference;
+
+  RSTMultisetIterator(RSTMapIterator<Data, unsigned int, true> it =
+                      RSTMapIterator<Data, unsigned int, true>())
+      : it(it), copy(0) {  }
+
+  const Data& operator*() const {
+    return it -> first;
+  }
+
+  const Data* operator->() const {
+    return &it -> first;
+  }
+
+  /** The number of copies of the key we are at */
+  unsigned int count() const {
+    return it -> second;
+  }
+
+
+  /****************************************************************************
+  Function Name:  operator++
+  Purpose:        This function moves on to the next key
+  Description:    When expanding, this function stays on the same entry until
+                  every copy of its key has been visited
+  Result:         Our iterator points to the next key, or to end()
+  ****************************************************************************/
+  RSTMultisetIterator& operator++() {
+
+    /* If statement is executed when another copy of this key is left */
+    if (Expand && copy + 1 < it -> second) {
+      ++copy;
+      return *this;
+    }
+
+    ++it;
+    copy = 0;
+    return *this;
+  }
+
+  RSTMultisetIterator operator++(int) {
+    RSTMultisetIterator before = *this;
+    ++*this;
+    return before;
+  }
+
+
+  /****************************************************************************
+  Function Name:  operator--
+  Purpose:        This function moves back to the previous key
+  Description:    When expanding, this function goes back through the copies
+                  of a key, and steps back onto the last copy of the one
+                  before
+  Result:         Our iterator points to the previous key
+  ****************************************************************************/
+  RSTMultisetIterator& operator--() {
+
+    /* If statement is executed when an earlier copy of this key is left */
+    if (copy > 0) {
+      --copy;
+      return *this;
+    }
+
+    --it;
+    copy = Expand ? it -> second - 1 : 0;
+    return *this;
+  }
+
+  RSTMultisetIterator operator--(int) {
+    RSTMultisetIterator before = *this;
+    --*this;
+    return before;
+  }
+
+  bool operator==(const RSTMultisetIterator& other) const {
+    return it == other.it && copy == other.copy;
+  }
+
+  bool operator!=(const RSTMultisetIterator& other) const {
+    return !(*this == other);
+  }
+};
+
+
+/******************************************************************************
+class RSTMultiset
+
+Description: Creates an RSTMultiset, which keeps every key once in an RSTMap
+    along with the number of copies of it. Inserting a key that is already
+    there only adds to its count, and erasing takes from the count until the
+    last copy goes, each in a single descent of the tree. Repeated keys
+    therefore cost no nodes and no depth, count is O(1) once the key is
+    found, and size is kept as a running total
+
+Template Parameters:
+    Data    - the type of the keys
+    Alloc   - the allocator creating and destroying our nodes
+    Compare - the comparator ordering the keys
+
+Data Fields:
+    counts (RSTMap<Data, unsigned int>) - the number of copies of every key
+    total (unsigned int)                - the number of copies of all keys
+
+Public functions:
+    RSTMultiset    - constructor for RSTMultiset
+    insert         - inserts copies of a key
+    erase          - removes copies of a key
+    erase_all      - removes every copy of a key
+    count          - gives the number of copies of a key
+    contains       - checks if a key is in our RSTMultiset
+    find           - finds the first copy of a key
+    size           - gives the number of copies of all keys
+    distinct_size  - gives the number of different keys
+    empty          - checks to see if our RSTMultiset is empty
+    clear          - removes every key
+    begin          - creates iterator pointing to the first copy
+    end            - creates iterator pointing past the last copy
+    distinct_begin - creates iterator visiting every key once, from the first
+    distinct_end   - creates iterator pointing past the last key
+******************************************************************************/
+template<typename Data, template<typename> class Alloc = NodePool,
+         typename Compare = std::less<Data> >
+class RSTMultiset {
+
+  RSTMap<Data, unsigned int, Alloc, Compare> counts;
+  unsigned int total;
+
+public:
+
+  typedef Data value_type;
+  typedef RSTMultisetIterator<Data, true> iterator;
+  typedef RSTMultisetIterator<Data, false> distinct_iterator;
+
+
+  /****************************************************************************
+  Function Name:  RSTMultiset
+  Purpose:        This function initializes an empty RSTMultiset
+  Input:          comp: the comparator ordering our keys
+  Result:         An empty RSTMultiset is created
+  ****************************************************************************/
+  explicit RSTMultiset(const Compare& comp = Compare())
+      : counts(comp), total(0) {  }
+
+
+  /****************************************************************************
+  Function Name:  insert
+  Purpose:        This function inserts copies of a key
+  Description:    This function calls try_emplace, which creates the entry of
+                  key with no copies if key is missing, and adds to the count
+                  of the entry it finds or creates
+  Input:          key:    the key we are inserting
+                  copies: the number of copies to insert
+  Result:         Returns the number of copies of key now in our RSTMultiset
+  ****************************************************************************/
+  unsigned int insert(const Data& key, unsigned int copies = 1) {
+
+    /* If statement is executed when nothing is inserted, so no entry with
+     * no copies is left behind */
+    if (copies == 0)
+      return count(key);
+
+    total += copies;
+    return counts.try_emplace(key, 0u).first -> second += copies;
+  }
+
+
+  /****************************************************************************
+  Function Name:  erase
+  Purpose:        This function removes copies of a key
+  Description:    This function takes copies from the count of key, and
+                  erases its entry through the iterator it found, without
+                  searching again, when no copies are left
+  Input:          key:    the key we are removing
+                  copies: the largest number of copies to remove
+  Result:         Returns the number of copies removed, 0 if key was not in
+                  our RSTMultiset
+  ****************************************************************************/
+  unsigned int erase(const Data& key, unsigned int copies = 1) {
+    typename RSTMap<Data, unsigned int, Alloc, Compare>::iterator it =
+      counts.find(key);
+
+    /* If statement is executed when key is not in our RSTMultiset */
+    if (it == counts.end())
+      return 0;
+
+    /* If statement is executed when some copies of key are left */
+    if (copies < it -> second) {
+      it -> second -= copies;
+      total -= copies;
+      return copies;
+    }
+
+    copies = it -> second;
+    total -= copies;
+    counts.erase(it);
+    return copies;
+  }
+
+  /** Removes every copy of key, giving how many there were */
+  unsigned int erase_all(const Data& key) {
+    return erase(key, static_cast<unsigned int>(-1));
+  }
+
+  unsigned int count(const Data& key) const {
+    typename RSTMap<Data, unsigned int, Alloc, Compare>::const_iterator it =
+      counts.find(key);
+    return it == counts.end() ? 0 : it -> second;
+  }
+
+  bool contains(const Data& key) const {
+    return counts.contains(key);
+  }
+
+  iterator find(const Data& key) const {
+    return iterator(counts.find(key));
+  }
+
+  unsigned int size() const {
+    return total;
+  }
+
+  unsigned int distinct_size() const {
+    return counts.size();
+  }
+
+  bool empty() const {
+    return total == 0;
+  }
+
+  void clear() {
+    counts.clear();
+    total = 0;
+  }
+
+  iterator begin() const {
+    return iterator(counts.begin());
+  }
+
+  iterator end() const {
+    return iterator(counts.end());
+  }
+
+  distinct_iterator distinct_begin() const {
+    return distinct_iterator(counts.begin());
+  }
+
+  distinct_iterator distinct_end() const {
+    return distinct_iterator(counts.end());
+  }
+};
+
+#endif // RSTMULTISET_HPP
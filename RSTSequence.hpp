@@ -0,0 +1,710 @@
+/******************************************************************************
+
+File Name:    RSTSequence.hpp
+Description:  This program creates a class called RSTSequence, a sequence
+              kept in a treap ordered by position instead of by key, so
+              elements can be inserted, erased, cut, pasted and reversed
+              anywhere in O(log n)
+
+******************************************************************************/
+
+
+#ifndef RSTSEQUENCE_HPP
+#define RSTSEQUENCE_HPP
+#include "NodePool.hpp"
+#include "Priority.hpp"
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+/** Whether T has +=, which range adds need */
+template<typename T, typename = void>
+struct SequenceAddable : std::false_type {  };
+
+template<typename T>
+struct SequenceAddable<T, std::void_t<decltype(
+    std::declval<T&>() += std::declval<const T&>())> > : std::true_type {  };
+
+
+/** The add tag of a node of an RSTSequence. Only a T with += can be added
+ *  to, so otherwise the tag is empty and costs the node nothing */
+template<typename T, bool = SequenceAddable<T>::value>
+struct SequenceAddTag {
+  bool adding = false;  // whether pending still has to reach the children
+  T pending = T();      // the value added to this subtree, not its children
+};
+
+template<typename T>
+struct SequenceAddTag<T, false> {  };
+
+
+/******************************************************************************
+class RSTSequence
+
+Description: Creates an RSTSequence, an implicit treap. Nodes carry random
+    priorities just like in RST, but no keys: the position of a node is the
+    number of nodes before it in order, found from the sizes of the subtrees
+    on the way down. Every operation splits the treap at one or two
+    positions, works on the middle part and joins the parts again, each
+    split and join taking O(log n) expected time.
+
+    Reversing or adding to a range only tags the root of its part. A tag is
+    pushed down to the children of a node the next time anything walks
+    through the node, so a range of any length is changed in O(log n). A
+    node with the reversed tag has already swapped its children, and one
+    with an add tag has already added to its own element. Const reads never
+    push: they gather the tags of the nodes they pass and apply them to what
+    they read, so a const RSTSequence can be read from several threads.
+
+    Nodes come from Alloc like those of RST. Halves of a split share the
+    allocator and concat joins the allocators, so no element is ever copied
+    to cut and paste
+
+Template Parameters:
+    T     - the type of the elements, which must be default constructible.
+            add needs T to have +=
+    Alloc - the allocator creating and destroying our nodes
+
+Data Fields:
+    root (Node*)            - the root of our treap, or nullptr if empty
+    alloc (Alloc)           - the allocator owning our nodes
+    priorities (Xoshiro256) - the source of the priorities of our nodes
+
+Public functions:
+    RSTSequence  - constructor for an empty sequence or one holding a range
+    ~RSTSequence - destructor for RSTSequence
+    size         - gives the number of elements
+    empty        - checks to see if our RSTSequence is empty
+    clear        - removes every element
+    at           - gives the element at a position
+    insert_at    - inserts an element before a position
+    erase_at     - removes the element at a position
+    split_at     - splits our RSTSequence into two before a position
+    concat       - joins two RSTSequences, one after the other
+    reverse      - reverses a range of positions
+    add          - adds a value to every element of a range of positions
+    copy_to      - writes every element in order
+    to_vector    - copies every element into a vector
+******************************************************************************/
+template<typename T, template<typename> class Alloc = NodePool>
+class RSTSequence {
+
+  /** An element, its priority and what it knows of its subtree */
+  struct Node : SequenceAddTag<T> {
+    template<typename U>
+    Node(U&& d, std::uint64_t p)
+        : left(nullptr), right(nullptr), priority(p), size(1),
+          reversed(false), data(std::forward<U>(d)) {  }
+
+    Node* left;
+    Node* right;
+    std::uint64_t priority;
+    unsigned int size;      // the number of nodes in this subtree
+    bool reversed;          // whether the children still have to be reversed
+    T data;
+  };
+
+  Node* root;
+  Alloc<Node> alloc;
+  Xoshiro256 priorities;
+
+public:
+
+
+  /****************************************************************************
+  Function Name:  RSTSequence
+  Purpose:        This function initializes an empty RSTSequence
+  Result:         An empty RSTSequence is created
+  ****************************************************************************/
+  RSTSequence() : root(nullptr) {  }
+
+
+  /****************************************************************************
+  Function Name:  RSTSequence
+  Purpose:        This function builds an RSTSequence from a range in O(n)
+  Description:    This function builds the treap as a Cartesian tree, the way
+                  build_from_sorted builds an RST. The right spine of the
+                  treap built so far is kept on a stack, and every new node
+                  pops the spine nodes its priority beats and takes the last
+                  of them as its left child. A node is popped once its
+                  subtree is complete, so its size is counted then
+  Input:          first:  iterator to the first element
+                  last:   iterator past the last element
+  Result:         An RSTSequence holding the elements of the range in order
+  ****************************************************************************/
+  template<typename Iterator>
+  RSTSequence(Iterator first, Iterator last) : root(nullptr) {
+    std::vector<Node*> spine;
+
+    /* If statement is executed when the range can be measured up front */
+    if constexpr (std::is_base_of<std::forward_iterator_tag,
+                    typename std::iterator_traits<Iterator>::iterator_category
+                  >::value)
+      alloc.reserve(std::distance(first, last));
+
+    for (; first != last; ++first) {
+      Node* n = alloc.create(*first, priorities());
+      Node* passed = nullptr;
+
+      /* While loop is executed while n belongs above the spine node */
+      while (!spine.empty() && n -> priority < spine.back() -> priority) {
+        passed = spine.back();
+        spine.pop_back();
+        update(passed);
+      }
+
+      n -> left = passed;
+      if (!spine.empty())
+        spine.back() -> right = n;
+      spine.push_back(n);
+    }
+
+    /* While loop is executed while the right spine is not counted */
+    while (!spine.empty()) {
+      update(spine.back());
+      root = spine.back();
+      spine.pop_back();
+    }
+  }
+
+  RSTSequence(const RSTSequence&) = delete;
+  RSTSequence& operator=(const RSTSequence&) = delete;
+
+  RSTSequence(RSTSequence&& other) noexcept
+      : root(other.root), priorities(other.priorities) {
+    alloc.swap(other.alloc);
+    other.root = nullptr;
+  }
+
+  RSTSequence& operator=(RSTSequence&& other) noexcept {
+    if (this != &other) {
+      clear();
+      alloc.swap(other.alloc);
+      root = other.root;
+      priorities = other.priorities;
+      other.root = nullptr;
+    }
+    return *this;
+  }
+
+  ~RSTSequence() {
+    clear();
+  }
+
+  unsigned int size() const {
+    return sizeOf(root);
+  }
+
+  bool empty() const {
+    return !root;
+  }
+
+
+  /****************************************************************************
+  Function Name:  clear
+  Purpose:        This function removes every element
+  Description:    Nodes are destroyed one by one only when they need their
+                  destructors called or another sequence still uses the
+                  blocks of our allocator, just like in BST::clear
+  Result:         An empty RSTSequence
+  ****************************************************************************/
+  void clear() {
+
+    /* If statement is executed when the nodes must be destroyed one by one */
+    if (root && (!Alloc<Node>::bulkRelease ||
+                 !std::is_trivially_destructible<Node>::value ||
+                 !alloc.sole()))
+      deleteAll(root);
+
+    alloc.release();
+    root = nullptr;
+  }
+
+
+  /****************************************************************************
+  Function Name:  at
+  Purpose:        This function gives the element at a position
+  Description:    This function walks down by subtree sizes, pushing the tags
+                  of every node it passes, so the element is up to date
+  Input:          pos:  the position of the element, counted from 0
+  Result:         Returns a reference to the element at pos
+                  Throws std::out_of_range if pos is not below size()
+  ****************************************************************************/
+  T& at(unsigned int pos) {
+
+    /* If statement is executed when there is no element at pos */
+    if (pos >= size())
+      throw std::out_of_range("RSTSequence::at: position past the end");
+
+    Node* t = root;
+
+    /* While loop is executed until t is the node at pos */
+    for (;;) {
+      push(t);
+      unsigned int before = sizeOf(t -> left);
+
+      if (pos == before)
+        return t -> data;
+
+      if (pos < before)
+        t = t -> left;
+
+      else {
+        pos -= before + 1;
+        t = t -> right;
+      }
+    }
+  }
+
+
+
+  /****************************************************************************
+  Function Name:  at
+  Purpose:        This function reads the element at a position
+  Description:    This function walks down by subtree sizes without pushing
+                  any tag. It keeps whether the nodes passed reverse the
+                  subtree it walks into and what they still add to it, and
+                  adds that to the element it reaches
+  Input:          pos:  the position of the element, counted from 0
+  Result:         Returns a copy of the element at pos
+                  Throws std::out_of_range if pos is not below size()
+  ****************************************************************************/
+  T at(unsigned int pos) const {
+
+    /* If statement is executed when there is no element at pos */
+    if (pos >= size())
+      throw std::out_of_range("RSTSequence::at: position past the end");
+
+    const Node* t = root;
+    bool flipped = false;
+    SequenceAddTag<T> above;
+
+    /* While loop is executed until t is the node at pos */
+    for (;;) {
+      const Node* first = flipped ? t -> right : t -> left;
+      const Node* second = flipped ? t -> left : t -> right;
+      unsigned int before = sizeOf(first);
+
+      if (pos == before)
+        return valueOf(t, above);
+
+      flipped = flipped != t -> reversed;
+      gather(above, t);
+
+      if (pos < before)
+        t = first;
+
+      else {
+        pos -= before + 1;
+        t = second;
+      }
+    }
+  }
+
+  T& operator[](unsigned int pos) {
+    return at(pos);
+  }
+
+  T operator[](unsigned int pos) const {
+    return at(pos);
+  }
+
+
+  /****************************************************************************
+  Function Name:  insert_at
+  Purpose:        This function inserts an element before a position
+  Description:    This function splits our treap at pos and joins the new
+                  node in between
+  Input:          pos:  the position the element will have, at most size()
+                  item: the element we are inserting
+  Result:         item is at pos and the elements from pos on moved up by one
+                  Throws std::out_of_range if pos is past size()
+  ****************************************************************************/
+  void insert_at(unsigned int pos, const T& item) {
+    check(pos, size());
+    link(pos, alloc.create(item, priorities()));
+  }
+
+  void insert_at(unsigned int pos, T&& item) {
+    check(pos, size());
+    link(pos, alloc.create(std::move(item), priorities()));
+  }
+
+
+  /****************************************************************************
+  Function Name:  erase_at
+  Purpose:        This function removes the element at a position
+  Description:    This function cuts out the node at pos and joins the parts
+                  before and after it
+  Input:          pos:  the position of the element, below size()
+  Result:         The element is removed and the elements after it moved down
+                  Throws std::out_of_range if pos is not below size()
+  ****************************************************************************/
+  void erase_at(unsigned int pos) {
+    Node* left;
+    Node* middle;
+    Node* right;
+    cut(pos, pos + 1, left, middle, right);
+    alloc.destroy(middle);
+    root = joinNodes(left, right);
+  }
+
+
+  /****************************************************************************
+  Function Name:  split_at
+  Purpose:        This function splits our RSTSequence before a position
+  Description:    This function splits the treap in O(log n) without creating
+                  a node. Both halves share the blocks of our allocator, and
+                  may be changed on different threads. Our RSTSequence is
+                  left empty
+  Input:          pos:  the number of elements going to the first half, at
+                        most size()
+  Result:         Returns the elements before pos and those from pos on
+                  Throws std::out_of_range if pos is past size()
+  ****************************************************************************/
+  std::pair<RSTSequence, RSTSequence> split_at(unsigned int pos) {
+    check(pos, size());
+    std::pair<RSTSequence, RSTSequence> halves;
+    splitNodes(root, pos, halves.first.root, halves.second.root);
+    halves.first.priorities = priorities.fork();
+    halves.second.priorities = priorities;
+    halves.first.alloc = alloc.share();
+    halves.second.alloc = std::move(alloc);
+    root = nullptr;
+    return halves;
+  }
+
+
+  /****************************************************************************
+  Function Name:  concat
+  Purpose:        This function joins two RSTSequences
+  Description:    This function joins the right spine of left with the left
+                  spine of right by priority in O(log n), and joins the
+                  allocators of both. Both RSTSequences are left empty
+  Input:          left:   the elements coming first
+                  right:  the elements coming after them
+  Result:         Returns an RSTSequence of the elements of left, then right
+  ****************************************************************************/
+  static RSTSequence concat(RSTSequence&& left, RSTSequence&& right) {
+    RSTSequence joined;
+    joined.priorities = left.priorities;
+    joined.alloc = std::move(left.alloc);
+    joined.alloc.absorb(right.alloc);
+    joined.root = joinNodes(left.root, right.root);
+
+    left.root = right.root = nullptr;
+    left.alloc.release();
+    right.alloc.release();
+    return joined;
+  }
+
+
+  /****************************************************************************
+  Function Name:  reverse
+  Purpose:        This function reverses a range of positions
+  Description:    This function cuts out the range, tags its root as reversed
+                  and joins the parts again
+  Input:          first:  the position of the first element of the range
+                  last:   the position past the last element of the range
+  Result:         The elements of the range are in the opposite order
+                  Throws std::out_of_range if the range is not in our
+                  RSTSequence
+  ****************************************************************************/
+  void reverse(unsigned int first, unsigned int last) {
+    Node* left;
+    Node* middle;
+    Node* right;
+    cut(first, last, left, middle, right);
+    flip(middle);
+    root = joinNodes(joinNodes(left, middle), right);
+  }
+
+
+  /****************************************************************************
+  Function Name:  add
+  Purpose:        This function adds a value to a range of positions
+  Description:    This function cuts out the range, adds delta to the element
+                  at its root and tags the root so its children get delta
+                  later
+  Input:          first:  the position of the first element of the range
+                  last:   the position past the last element of the range
+                  delta:  the value added to every element of the range
+  Result:         Every element of the range has had delta added with +=
+                  Throws std::out_of_range if the range is not in our
+                  RSTSequence
+  ****************************************************************************/
+  void add(unsigned int first, unsigned int last, const T& delta) {
+    static_assert(SequenceAddable<T>::value, "add needs T to have +=");
+    Node* left;
+    Node* middle;
+    Node* right;
+    cut(first, last, left, middle, right);
+    addTo(middle, delta);
+    root = joinNodes(joinNodes(left, middle), right);
+  }
+
+
+  /****************************************************************************
+  Function Name:  copy_to
+  Purpose:        This function writes every element in order
+  Description:    This function walks the treap in order in O(n), gathering
+                  the tags of every node on the way down just like at const
+  Input:          out:  receives every element in order
+  Result:         Returns out advanced past the last element written
+  ****************************************************************************/
+  template<typename OutIterator>
+  OutIterator copy_to(OutIterator out) const {
+    exportNodes(root, false, SequenceAddTag<T>(), out);
+    return out;
+  }
+
+  /** Copies every element in order into a vector of the right size */
+  std::vector<T> to_vector() const {
+    std::vector<T> items;
+    items.reserve(size());
+    copy_to(std::back_inserter(items));
+    return items;
+  }
+
+private:
+
+  static unsigned int sizeOf(const Node* n) {
+    return n ? n -> size : 0;
+  }
+
+  static void update(Node* n) {
+    n -> size = 1 + sizeOf(n -> left) + sizeOf(n -> right);
+  }
+
+  /** Throws std::out_of_range unless pos <= limit */
+  static void check(unsigned int pos, unsigned int limit) {
+    if (pos > limit)
+      throw std::out_of_range("RSTSequence: position past the end");
+  }
+
+
+  /****************************************************************************
+  Function Name:  flip
+  Purpose:        This function reverses a subtree
+  Description:    This function swaps the children of n and tags n, so its
+                  children swap theirs when n is next pushed
+  Input:          n:  the root of the subtree, or nullptr
+  Result:         The subtree of n holds its elements in the opposite order
+  ****************************************************************************/
+  static void flip(Node* n) {
+    if (n) {
+      std::swap(n -> left, n -> right);
+      n -> reversed = !n -> reversed;
+    }
+  }
+
+  /** Adds delta to a tag, which starts adding if it was not yet */
+  static void addTag(SequenceAddTag<T>& tag, const T& delta) {
+    if (tag.adding)
+      tag.pending += delta;
+
+    else {
+      tag.pending = delta;
+      tag.adding = true;
+    }
+  }
+
+  /** Adds delta to the element of n and to the tag its children get */
+  static void addTo(Node* n, const T& delta) {
+    if (n) {
+      n -> data += delta;
+      addTag(*n, delta);
+    }
+  }
+
+  /** Adds what n still adds to its children to what was gathered above it */
+  static void gather(SequenceAddTag<T>& above, const Node* n) {
+    if constexpr (SequenceAddable<T>::value) {
+      if (n -> adding)
+        addTag(above, n -> pending);
+    }
+  }
+
+  /** The element of n with what the nodes above it still add */
+  static T valueOf(const Node* n, const SequenceAddTag<T>& above) {
+    T value = n -> data;
+    if constexpr (SequenceAddable<T>::value) {
+      if (above.adding)
+        value += above.pending;
+    }
+    return value;
+  }
+
+
+  /****************************************************************************
+  Function Name:  push
+  Purpose:        This function passes the tags of a node to its children
+  Input:          n:  the node we are about to walk through
+  Result:         n has no tags left and its children carry them instead
+  ****************************************************************************/
+  static void push(Node* n) {
+
+    /* If statement is executed when the children still have to reverse */
+    if (n -> reversed) {
+      flip(n -> left);
+      flip(n -> right);
+      n -> reversed = false;
+    }
+
+    if constexpr (SequenceAddable<T>::value) {
+
+      /* If statement is executed when the children still have to add */
+      if (n -> adding) {
+        addTo(n -> left, n -> pending);
+        addTo(n -> right, n -> pending);
+        n -> adding = false;
+      }
+    }
+  }
+
+
+  /****************************************************************************
+  Function Name:  splitNodes
+  Purpose:        This function splits a subtree before a position
+  Description:    This function follows the path to position pos, hanging
+                  every node before it on the left result and every other
+                  node on the right result. Tags are pushed on the way down
+  Input:          t:      the root of the subtree we are splitting
+                  pos:    the number of nodes going to left
+                  left:   set to the root of the first pos nodes
+                  right:  set to the root of the remaining nodes
+  Result:         The subtree is split into left and right
+  ****************************************************************************/
+  static void splitNodes(Node* t, unsigned int pos, Node*& left,
+                         Node*& right) {
+
+    /* If statement is executed when t does not exist */
+    if (!t) {
+      left = right = nullptr;
+      return;
+    }
+
+    push(t);
+    unsigned int before = sizeOf(t -> left);
+
+    /* If statement is executed when t belongs to the right result */
+    if (pos <= before) {
+      splitNodes(t -> left, pos, left, t -> left);
+      right = t;
+    }
+
+    else {
+      splitNodes(t -> right, pos - before - 1, t -> right, right);
+      left = t;
+    }
+    update(t);
+  }
+
+
+  /****************************************************************************
+  Function Name:  joinNodes
+  Purpose:        This function joins two subtrees, one after the other
+  Description:    This function picks whichever root has the better priority
+                  as the new root and recursively joins the other subtree with
+                  the inner child of that root
+  Input:          left:   the subtree coming first
+                  right:  the subtree coming after it
+  Result:         Returns the root of the joined subtree
+  ****************************************************************************/
+  static Node* joinNodes(Node* left, Node* right) {
+
+    /* If statement is executed when either subtree does not exist */
+    if (!left)
+      return right;
+
+    if (!right)
+      return left;
+
+    /* If statement is executed when left becomes the root */
+    if (left -> priority < right -> priority) {
+      push(left);
+      left -> right = joinNodes(left -> right, right);
+      update(left);
+      return left;
+    }
+
+    push(right);
+    right -> left = joinNodes(left, right -> left);
+    update(right);
+    return right;
+  }
+
+
+  /****************************************************************************
+  Function Name:  cut
+  Purpose:        This function cuts a range of positions out of our treap
+  Input:          first:  the position of the first node of the range
+                  last:   the position past the last node of the range
+                  left:   set to the nodes before the range
+                  middle: set to the nodes of the range
+                  right:  set to the nodes after the range
+  Result:         Our treap is split into left, middle and right
+                  Throws std::out_of_range if the range is not in our
+                  RSTSequence, leaving our treap untouched
+  ****************************************************************************/
+  void cut(unsigned int first, unsigned int last, Node*& left,
+           Node*& middle, Node*& right) {
+    check(last, size());
+    check(first, last);
+    splitNodes(root, last, middle, right);
+    splitNodes(middle, first, left, middle);
+    root = nullptr;
+  }
+
+  /** Joins n in before position pos, which must be at most size() */
+  void link(unsigned int pos, Node* n) {
+    Node* left;
+    Node* right;
+    splitNodes(root, pos, left, right);
+    root = joinNodes(joinNodes(left, n), right);
+  }
+
+
+
+  /****************************************************************************
+  Function Name:  exportNodes
+  Purpose:        This function writes a subtree in order without pushing
+  Input:          n:        the root of the subtree, or nullptr
+                  flipped:  whether the nodes above n reverse its subtree
+                  above:    what the nodes above n still add to its subtree
+                  out:      receives every element of the subtree
+  Result:         out is advanced past the last element written
+  ****************************************************************************/
+  template<typename OutIterator>
+  static void exportNodes(const Node* n, bool flipped,
+                          SequenceAddTag<T> above, OutIterator& out) {
+
+    /* While loop is executed while there are nodes left below n */
+    while (n) {
+      SequenceAddTag<T> below = above;
+      gather(below, n);
+      bool reversed = flipped != n -> reversed;
+
+      exportNodes(flipped ? n -> right : n -> left, reversed, below, out);
+      *out++ = valueOf(n, above);
+      n = flipped ? n -> left : n -> right;
+      flipped = reversed;
+      above = below;
+    }
+  }
+
+  /** Destroys every node of a subtree in postorder */
+  void deleteAll(Node* n) {
+    if (n) {
+      deleteAll(n -> left);
+      deleteAll(n -> right);
+      alloc.destroy(n);
+    }
+  }
+};
+
+#endif // RSTSEQUENCE_HPP
@@ -0,0 +1,367 @@
+/******************************************************************************
+
+File Name:    TaskPool.hpp
+Description:  This program creates the thread pool our bulk operations run
+              on. Work is split fork-join style: a task runs one half of the
+              work itself and leaves the other half for an idle thread to
+              steal, so deep recursions on disjoint subtrees spread over every
+              core without any central scheduler
+
+******************************************************************************/
+
+
+#ifndef TASKPOOL_HPP
+#define TASKPOOL_HPP
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+/******************************************************************************
+class TaskPool
+
+Description: Creates a work-stealing thread pool. Every worker thread has its
+    own queue of tasks. invoke pushes its second function onto the queue of
+    the calling thread, runs the first function, and then takes the second
+    back unless another thread stole it meanwhile. Owners take from the back
+    of their queue and thieves from the front, so a thief always gets the
+    biggest piece of work left, the one pushed nearest the top of the
+    recursion. Threads outside the pool share one extra queue.
+
+    While waiting for a stolen task a thread runs other tasks instead of
+    blocking, so nested invokes never deadlock and never leave a core idle.
+    Idle workers sleep until a task is pushed. The pool of the library,
+    shared by every tree, is created on first use by shared
+
+Data Fields:
+    workers (vector<thread>)  - the threads of the pool, one fewer than
+                                threads since the caller works too
+    queues (Queue[])          - a queue per worker, then the outside queue
+    queueCount (size_t)       - the number of queues, set before the workers
+                                start so they never look at workers
+    grainSize (size_t)        - the number of items below which bulk
+                                operations stop splitting their work
+    pending (atomic<size_t>)  - tasks pushed and not yet taken
+    sleepers (atomic<size_t>) - workers waiting for a task
+    stopping (atomic<bool>)   - set when the pool is destroyed
+
+Public functions:
+    TaskPool - constructor for TaskPool
+    ~TaskPool - destructor for TaskPool, joining every worker
+    shared   - gives the pool of the library
+    threads  - gives the number of threads working on tasks
+    grain    - gives the number of items worth a task of their own
+    invoke   - runs two functions, in parallel if a thread is free
+******************************************************************************/
+class TaskPool {
+
+  /** A function pushed by invoke, waiting to run on any thread */
+  struct Task {
+    void (*run)(void*);
+    void* function;
+    std::atomic<bool> done{false};
+    std::exception_ptr error;
+  };
+
+  struct Queue {
+    std::mutex lock;
+    std::deque<Task*> tasks;
+  };
+
+  std::vector<std::thread> workers;
+  std::unique_ptr<Queue[]> queues;
+  std::size_t queueCount;
+  std::size_t grainSize;
+  std::atomic<std::size_t> pending{0};
+  std::atomic<std::size_t> sleepers{0};
+  std::atomic<bool> stopping{false};
+  std::mutex sleepLock;
+  std::condition_variable wake;
+
+
+  /****************************************************************************
+  Function Name:  current
+  Purpose:        This function finds the pool and queue of the calling thread
+  Result:         Returns the pool the calling thread works for, or nullptr,
+                  and sets index to its queue
+  ****************************************************************************/
+  static TaskPool*& current(std::size_t*& index) {
+    static thread_local TaskPool* pool = nullptr;
+    static thread_local std::size_t queue = 0;
+    index = &queue;
+    return pool;
+  }
+
+  /** The queue the calling thread pushes onto */
+  std::size_t ownQueue() {
+    std::size_t* index;
+    return current(index) == this ? *index : queueCount - 1;
+  }
+
+
+  /****************************************************************************
+  Function Name:  push
+  Purpose:        This function makes a task available to every thread
+  Description:    A sleeping worker is only woken when one is known to sleep.
+                  Workers count themselves as sleepers before checking for
+                  tasks, so either we see the sleeper or it sees the task
+  Input:          q:    the queue of the calling thread
+                  task: the task we are pushing
+  ****************************************************************************/
+  void push(std::size_t q, Task* task) {
+    {
+      std::lock_guard<std::mutex> guard(queues[q].lock);
+      queues[q].tasks.push_back(task);
+    }
+    ++pending;
+
+    /* If statement is executed when a worker may be waiting for a task */
+    if (sleepers.load()) {
+      std::lock_guard<std::mutex> guard(sleepLock);
+      wake.notify_one();
+    }
+  }
+
+
+  /****************************************************************************
+  Function Name:  take
+  Purpose:        This function takes a task back from a queue
+  Description:    Our own pushes since task were all taken back before invoke
+                  returned, so task is at the back of a worker's queue unless
+                  it was stolen. The outside queue is shared, so it is
+                  searched
+  Input:          q:    the queue the task was pushed onto
+                  task: the task we want back
+  Result:         true if task was still waiting and is ours to run
+                  false if another thread took it
+  ****************************************************************************/
+  bool take(std::size_t q, Task* task) {
+    std::lock_guard<std::mutex> guard(queues[q].lock);
+    std::deque<Task*>& tasks = queues[q].tasks;
+    std::deque<Task*>::reverse_iterator it =
+      std::find(tasks.rbegin(), tasks.rend(), task);
+
+    /* If statement is executed when task was stolen */
+    if (it == tasks.rend())
+      return false;
+
+    tasks.erase(std::next(it).base());
+    --pending;
+    return true;
+  }
+
+
+  /****************************************************************************
+  Function Name:  next
+  Purpose:        This function finds a task for a thread to run
+  Description:    This function takes the newest task of queue q, or else
+                  steals the oldest task of the first other queue which has
+                  one, starting after q so thieves spread over the queues
+  Input:          q:  the queue of the calling thread
+  Result:         Returns the task to run, or nullptr if every queue is empty
+  ****************************************************************************/
+  Task* next(std::size_t q) {
+    /* If statement is executed when no task is waiting anywhere */
+    if (!pending.load())
+      return nullptr;
+
+    for (std::size_t i = 0; i < queueCount; ++i) {
+      Queue& queue = queues[(q + i) % queueCount];
+      std::lock_guard<std::mutex> guard(queue.lock);
+
+      /* If statement is executed when the queue has a task for us */
+      if (!queue.tasks.empty()) {
+        Task* task;
+        if (i == 0) {
+          task = queue.tasks.back();
+          queue.tasks.pop_back();
+        }
+
+        else {
+          task = queue.tasks.front();
+          queue.tasks.pop_front();
+        }
+        --pending;
+        return task;
+      }
+    }
+    return nullptr;
+  }
+
+  /** Runs task, keeping whatever it throws for the thread waiting on it */
+  static void run(Task* task) {
+    try {
+      task -> run(task -> function);
+    }
+    catch (...) {
+      task -> error = std::current_exception();
+    }
+    task -> done.store(true, std::memory_order_release);
+  }
+
+
+  /****************************************************************************
+  Function Name:  work
+  Purpose:        This function is the loop of a worker thread
+  Input:          q:  the queue of the worker
+  Result:         Runs tasks until the pool is destroyed
+  ****************************************************************************/
+  void work(std::size_t q) {
+    std::size_t* index;
+    current(index) = this;
+    *index = q;
+
+    /* While loop is executed until the pool is destroyed */
+    while (!stopping.load()) {
+      Task* task = next(q);
+
+      /* If statement is executed when every queue is empty */
+      if (!task) {
+        std::unique_lock<std::mutex> guard(sleepLock);
+        ++sleepers;
+        wake.wait(guard, [this] { return stopping.load() || pending.load(); });
+        --sleepers;
+        continue;
+      }
+
+      run(task);
+    }
+  }
+
+public:
+
+
+  /****************************************************************************
+  Function Name:  TaskPool
+  Purpose:        This function starts a TaskPool
+  Description:    The thread calling invoke always works on its own tasks, so
+                  only threads - 1 worker threads are started. A pool of one
+                  thread runs everything in the calling thread
+  Input:          threads:  the number of threads working on tasks, every
+                            hardware thread by default
+                  grain:    the number of items below which bulk operations
+                            stop splitting their work
+  Result:         A TaskPool whose workers wait for tasks
+  ****************************************************************************/
+  explicit TaskPool(unsigned threads = std::thread::hardware_concurrency(),
+                    std::size_t grain = 4096)
+      : queueCount(std::max(threads, 1u)),
+        grainSize(std::max<std::size_t>(grain, 1)) {
+    queues.reset(new Queue[queueCount]);
+    workers.reserve(queueCount - 1);
+    for (std::size_t q = 0; q + 1 < queueCount; ++q)
+      workers.emplace_back([this, q] { work(q); });
+  }
+
+  TaskPool(const TaskPool&) = delete;
+  TaskPool& operator=(const TaskPool&) = delete;
+
+
+  /****************************************************************************
+  Function Name:  ~TaskPool
+  Purpose:        This function deconstructs our TaskPool
+  Description:    Every invoke must have returned before the pool is
+                  destroyed. The workers are woken and joined
+  Result:         Every worker thread has finished
+  ****************************************************************************/
+  ~TaskPool() {
+    {
+      std::lock_guard<std::mutex> guard(sleepLock);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (std::size_t i = 0; i < workers.size(); ++i)
+      workers[i].join();
+  }
+
+
+  /****************************************************************************
+  Function Name:  shared
+  Purpose:        This function gives the pool of the library
+  Description:    The pool is created by the first bulk operation asking for
+                  it, with a thread per hardware thread, and lives until the
+                  program exits
+  Result:         Returns the pool shared by every tree
+  ****************************************************************************/
+  static TaskPool& shared() {
+    static TaskPool pool;
+    return pool;
+  }
+
+  unsigned threads() const {
+    return queueCount;
+  }
+
+  std::size_t grain() const {
+    return grainSize;
+  }
+
+
+  /****************************************************************************
+  Function Name:  invoke
+  Purpose:        This function runs two functions, in parallel if possible
+  Description:    This function leaves second for any idle thread to steal
+                  and runs first itself. If nobody stole second meanwhile we
+                  run it too, otherwise we run other tasks until the thief has
+                  finished it. Whatever either function throws is thrown again
+                  once both are done
+  Input:          first:  the function run by the calling thread
+                  second: the function another thread may run
+  Result:         Both functions have run
+  ****************************************************************************/
+  template<typename First, typename Second>
+  void invoke(First&& first, Second&& second) {
+
+    /* If statement is executed when nobody could steal second */
+    if (queueCount == 1) {
+      first();
+      second();
+      return;
+    }
+
+    typedef typename std::remove_reference<Second>::type Function;
+    Task task;
+    task.run = [](void* f) { (*static_cast<Function*>(f))(); };
+    task.function = const_cast<void*>(static_cast<const void*>(&second));
+
+    std::size_t q = ownQueue();
+    push(q, &task);
+
+    std::exception_ptr error;
+    try {
+      first();
+    }
+    catch (...) {
+      error = std::current_exception();
+    }
+
+    /* If statement is executed when second was not stolen */
+    if (take(q, &task))
+      run(&task);
+
+    /* While loop is executed until the thief has finished second */
+    while (!task.done.load(std::memory_order_acquire)) {
+      Task* other = next(q);
+      if (other)
+        run(other);
+      else
+        std::this_thread::yield();
+    }
+
+    if (error)
+      std::rethrow_exception(error);
+
+    if (task.error)
+      std::rethrow_exception(task.error);
+  }
+};
+
+#endif // TASKPOOL_HPP
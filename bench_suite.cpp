@@ -0,0 +1,521 @@
+#include "RST.hpp"
+#include "RSTMap.hpp"
+#include "countint.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+typedef chrono::steady_clock benchclock;
+
+/** The bytes currently allocated through operator new, for bytes per key */
+static size_t live_bytes = 0;
+
+/** Results of finds and iterations end up here, so they are not optimized out */
+volatile long long sink;
+
+// every allocation carries its size in a 16 byte header, keeping alignment
+void* operator new(size_t n) {
+  void* p = malloc(n + 16);
+  if(!p) throw bad_alloc();
+  *static_cast<size_t*>(p) = n;
+  live_bytes += n;
+  return static_cast<char*>(p) + 16;
+}
+
+void operator delete(void* p) noexcept {
+  if(!p) return;
+  char* block = static_cast<char*>(p) - 16;
+  live_bytes -= *reinterpret_cast<size_t*>(block);
+  free(block);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  operator delete(p);
+}
+
+/**
+ * A histogram of latencies in nanoseconds. Values below 16 get a bucket of
+ * their own, and every power of two above is cut into 16 buckets, so any
+ * percentile is within 1/16 of the truth while the histogram stays the same
+ * size for any number of operations.
+ */
+class latencies {
+  vector<uint64_t> buckets;
+  uint64_t total;
+
+  static size_t bucket(uint64_t ns) {
+    if(ns < 16) return ns;
+    int e = 63 - __builtin_clzll(ns);
+    return (e - 3) * 16 + ((ns >> (e - 4)) & 15);
+  }
+
+  static uint64_t lowest(size_t b) {
+    if(b < 16) return b;
+    int e = b / 16 + 3;
+    return (uint64_t(16) + b % 16) << (e - 4);
+  }
+
+public:
+  latencies() : buckets(61 * 16, 0), total(0) {}
+
+  void add(uint64_t ns) {
+    ++buckets[bucket(ns)];
+    ++total;
+  }
+
+  /** The smallest latency at or above fraction q of all operations */
+  uint64_t percentile(double q) const {
+    uint64_t rank = uint64_t(ceil(q * total));
+    uint64_t seen = 0;
+    for(size_t b=0; b<buckets.size(); b++) {
+      seen += buckets[b];
+      if(seen >= rank && seen) return lowest(b);
+    }
+    return 0;
+  }
+};
+
+/** One line of the results: one operation on one structure and workload */
+struct result {
+  string structure, workload, op;
+  int n;
+  double mops;                  // millions of operations per second
+  uint64_t p50, p99, p999;      // nanoseconds, 0 if not measured
+  double bytes_per_key;
+  double comparisons;           // countint comparisons per operation
+  double copies, moves;         // countint copies and moves per operation
+};
+
+/**
+ * Zipfian ranks 0..n-1 with exponent theta, using the method of Gray et al.
+ * that YCSB uses: one O(n) pass to sum the weights, then O(1) per draw. Ranks
+ * are scattered over the keys so the popular keys are not all neighbours.
+ */
+class zipfian {
+  uint64_t n;
+  double theta, alpha, zetan, eta;
+  mt19937_64 gen;
+  uniform_real_distribution<double> unit;
+
+public:
+  zipfian(uint64_t n, uint64_t seed, double theta = 0.99)
+      : n(n), theta(theta), gen(seed), unit(0.0, 1.0) {
+    zetan = 0;
+    for(uint64_t i=1; i<=n; i++) zetan += 1.0 / pow(double(i), theta);
+    double zeta2 = 1.0 + 1.0 / pow(2.0, theta);
+    alpha = 1.0 / (1.0 - theta);
+    eta = (1.0 - pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / zetan);
+  }
+
+  int operator()() {
+    double u = unit(gen);
+    double uz = u * zetan;
+    uint64_t rank;
+    if(uz < 1.0) rank = 0;
+    else if(uz < 1.0 + pow(0.5, theta)) rank = 1;
+    else rank = uint64_t(n * pow(eta * u - eta + 1.0, alpha));
+    if(rank >= n) rank = n - 1;
+    uint64_t state = rank;
+    return int(splitmix64(state) % n);
+  }
+};
+
+/** The keys inserted, looked up and erased by one workload */
+struct workload {
+  string name;
+  vector<int> inserts, finds, erases;
+};
+
+vector<int> permutation(int n, uint64_t seed) {
+  vector<int> v(n);
+  for(int i=0; i<n; i++) v[i] = i;
+  shuffle(v.begin(), v.end(), mt19937_64(seed));
+  return v;
+}
+
+/**
+ * sorted:      ascending inserts and erases, random finds
+ * random:      a random permutation for each of inserts, finds and erases
+ * zipfian:     every key drawn Zipfian, so inserts and erases repeat keys and
+ *              finds mostly hit a few popular keys
+ * adversarial: 0, n-1, 1, n-2, ... for everything, a zigzag which turns an
+ *              unbalanced tree into a path and defeats caching near the ends
+ */
+workload make_workload(const string& name, int n) {
+  workload w;
+  w.name = name;
+  if(name == "sorted") {
+    w.inserts = permutation(n, 0);
+    sort(w.inserts.begin(), w.inserts.end());
+    w.finds = permutation(n, 2);
+    w.erases = w.inserts;
+  }
+  else if(name == "random") {
+    w.inserts = permutation(n, 1);
+    w.finds = permutation(n, 2);
+    w.erases = permutation(n, 3);
+  }
+  else if(name == "zipfian") {
+    zipfian z(n, 4);
+    for(int i=0; i<n; i++) w.inserts.push_back(z());
+    for(int i=0; i<n; i++) w.finds.push_back(z());
+    for(int i=0; i<n; i++) w.erases.push_back(z());
+  }
+  else {
+    for(int lo=0, hi=n-1; lo<=hi; lo++, hi--) {
+      w.inserts.push_back(lo);
+      if(lo != hi) w.inserts.push_back(hi);
+    }
+    w.finds = w.erases = w.inserts;
+  }
+  return w;
+}
+
+int value(int k) { return k; }
+int value(const countint& k) { return k.getval(); }
+
+/** How each set is built from sorted distinct keys, if it can be */
+template<typename Set>
+struct bulk_loader {
+  static const bool able = false;
+};
+
+template<typename Key>
+struct bulk_loader< RST<Key> > {
+  static const bool able = true;
+  static void load(RST<Key>& s, const vector<Key>& sorted) {
+    s = RST<Key>::build_from_sorted(sorted.begin(), sorted.end());
+  }
+};
+
+template<typename Key>
+struct bulk_loader< set<Key> > {
+  static const bool able = true;
+  static void load(set<Key>& s, const vector<Key>& sorted) {
+    s = set<Key>(sorted.begin(), sorted.end());
+  }
+};
+
+/** RST, BST and std::set behind one interface. Keys are forwarded, so
+ *  temporaries are moved into the set */
+template<typename Set, bool Erases = true>
+struct set_adapter {
+  Set s;
+  static const bool can_erase = Erases;
+  static const bool can_bulk = bulk_loader<Set>::able;
+  template<typename Key> void insert(Key&& k) { s.insert(std::forward<Key>(k)); }
+  template<typename Key> void bulk(const vector<Key>& sorted) {
+    bulk_loader<Set>::load(s, sorted);
+  }
+  template<typename Key> bool find(const Key& k) const { return s.find(k) != s.end(); }
+  template<typename Key> void erase(const Key& k) { s.erase(k); }
+  long long iterate() const {
+    long long sum = 0;
+    for(auto it = s.begin(); it != s.end(); ++it) sum += value(*it);
+    return sum;
+  }
+};
+
+/** RSTMap and std::map behind the same interface, mapping keys to ints */
+template<typename Map>
+struct map_adapter {
+  Map m;
+  static const bool can_erase = true;
+  static const bool can_bulk = false;
+  template<typename Key> void insert(Key&& k) {
+    int v = value(k);
+    m.try_emplace(std::forward<Key>(k), v);
+  }
+  template<typename Key> void bulk(const vector<Key>&) {}
+  template<typename Key> bool find(const Key& k) const { return m.find(k) != m.end(); }
+  template<typename Key> void erase(const Key& k) { m.erase(k); }
+  long long iterate() const {
+    long long sum = 0;
+    for(auto it = m.begin(); it != m.end(); ++it) sum += it->second;
+    return sum;
+  }
+};
+
+/** Runs op on every key and returns the seconds taken */
+template<typename Op>
+double run(const vector<int>& keys, Op op) {
+  benchclock::time_point start = benchclock::now();
+  for(size_t i=0; i<keys.size(); i++) op(keys[i]);
+  return chrono::duration<double>(benchclock::now() - start).count();
+}
+
+/** Runs op on every key, timing each one separately */
+template<typename Op>
+latencies time_each(const vector<int>& keys, Op op) {
+  latencies l;
+  benchclock::time_point before = benchclock::now();
+  for(size_t i=0; i<keys.size(); i++) {
+    op(keys[i]);
+    benchclock::time_point after = benchclock::now();
+    l.add(chrono::duration_cast<chrono::nanoseconds>(after - before).count());
+    before = after;
+  }
+  return l;
+}
+
+/** Runs op on every key as a countint, filling in what it did per key */
+template<typename Op>
+void count_each(result& r, const vector<int>& keys, Op op) {
+  countscope scope;
+  for(size_t i=0; i<keys.size(); i++) op(countint(keys[i]));
+  keycounts spent = scope.counts();
+  r.comparisons = double(spent.comparisons) / keys.size();
+  r.copies = double(spent.copies) / keys.size();
+  r.moves = double(spent.moves) / keys.size();
+}
+
+/** Fills r with throughput and, if given, latency percentiles */
+void record(result& r, size_t ops, double seconds, const latencies* l) {
+  r.mops = ops / seconds / 1e6;
+  r.p50 = l ? l->percentile(0.5) : 0;
+  r.p99 = l ? l->percentile(0.99) : 0;
+  r.p999 = l ? l->percentile(0.999) : 0;
+}
+
+/**
+ * Measures one structure on one workload. Throughput comes from untimed
+ * loops, since reading the clock around every operation costs about as
+ * much as a small find, and latencies from a second pass on a fresh
+ * structure timing every operation. Comparisons, copies and moves are
+ * counted on a third structure holding countints, so counting never slows
+ * the timed passes. Structures which can be built from sorted keys also get
+ * a bulk row, timing that build.
+ */
+template<template<typename> class Structure>
+void measure(const string& name, const workload& w, int n,
+             vector<result>& results) {
+  result base = result();
+  base.structure = name;
+  base.workload = w.name;
+  base.n = n;
+
+  result ins = base, fnd = base, itr = base, ers = base, blk = base;
+  ins.op = "insert";
+  fnd.op = "find";
+  itr.op = "iterate";
+  ers.op = "erase";
+  blk.op = "bulk";
+
+  constexpr bool erases = Structure<int>::can_erase;
+  constexpr bool bulks = Structure<int>::can_bulk;
+  set<int> distinct(w.inserts.begin(), w.inserts.end());
+  vector<int> sorted(distinct.begin(), distinct.end());
+  distinct.clear();
+  size_t keys = sorted.size();
+  {
+    size_t before = live_bytes;
+    Structure<int>* s = new Structure<int>();
+    double t = run(w.inserts, [&](int k) { s->insert(k); });
+    record(ins, w.inserts.size(), t, nullptr);
+    ins.bytes_per_key = fnd.bytes_per_key = itr.bytes_per_key =
+        ers.bytes_per_key = double(live_bytes - before) / keys;
+
+    size_t hits = 0;
+    t = run(w.finds, [&](int k) { hits += s->find(k); });
+    latencies l = time_each(w.finds, [&](int k) { hits += s->find(k); });
+    record(fnd, w.finds.size(), t, &l);
+    sink = hits;
+
+    benchclock::time_point start = benchclock::now();
+    sink = s->iterate();
+    itr.mops = keys / chrono::duration<double>(benchclock::now() - start).count()
+               / 1e6;
+
+    if constexpr (erases) {
+      t = run(w.erases, [&](int k) { s->erase(k); });
+      record(ers, w.erases.size(), t, nullptr);
+    }
+    delete s;
+  }
+  if constexpr (bulks) {
+    Structure<int>* s = new Structure<int>();
+    benchclock::time_point start = benchclock::now();
+    s->bulk(sorted);
+    record(blk, keys, chrono::duration<double>(benchclock::now() - start).count(),
+           nullptr);
+    blk.bytes_per_key = ins.bytes_per_key;
+    delete s;
+  }
+  {
+    Structure<int>* s = new Structure<int>();
+    latencies l = time_each(w.inserts, [&](int k) { s->insert(k); });
+    ins.p50 = l.percentile(0.5);
+    ins.p99 = l.percentile(0.99);
+    ins.p999 = l.percentile(0.999);
+    if constexpr (erases) {
+      l = time_each(w.erases, [&](int k) { s->erase(k); });
+      ers.p50 = l.percentile(0.5);
+      ers.p99 = l.percentile(0.99);
+      ers.p999 = l.percentile(0.999);
+    }
+    delete s;
+  }
+  {
+    Structure<countint>* s = new Structure<countint>();
+    count_each(ins, w.inserts, [&](countint&& k) { s->insert(std::move(k)); });
+    count_each(fnd, w.finds, [&](countint&& k) { sink = s->find(k); });
+    if constexpr (erases) {
+      count_each(ers, w.erases, [&](countint&& k) { s->erase(k); });
+    }
+    delete s;
+  }
+  if constexpr (bulks) {
+    Structure<countint>* s = new Structure<countint>();
+    vector<countint> counted_keys(sorted.begin(), sorted.end());
+    countscope scope;
+    s->bulk(counted_keys);
+    keycounts spent = scope.counts();
+    blk.comparisons = double(spent.comparisons) / keys;
+    blk.copies = double(spent.copies) / keys;
+    blk.moves = double(spent.moves) / keys;
+    delete s;
+  }
+
+  results.push_back(ins);
+  results.push_back(fnd);
+  results.push_back(itr);
+  if(erases) results.push_back(ers);
+  if(bulks) results.push_back(blk);
+}
+
+template<typename Key> using rst_set = set_adapter< RST<Key> >;
+template<typename Key> using bst_set = set_adapter< BST<Key>, false >;
+template<typename Key> using std_set = set_adapter< set<Key> >;
+template<typename Key> using rst_map = map_adapter< RSTMap<Key, int> >;
+template<typename Key> using std_map = map_adapter< map<Key, int> >;
+
+/** Splits a comma separated list */
+vector<string> split_list(const string& s) {
+  vector<string> out;
+  stringstream in(s);
+  string item;
+  while(getline(in, item, ',')) if(!item.empty()) out.push_back(item);
+  return out;
+}
+
+bool wanted(const vector<string>& list, const string& name) {
+  return find(list.begin(), list.end(), name) != list.end();
+}
+
+void write_csv(const string& path, const string& label,
+               const vector<result>& results) {
+  ofstream out(path.c_str());
+  out << "label,structure,workload,n,op,mops,p50_ns,p99_ns,p999_ns,"
+      << "bytes_per_key,comparisons_per_op,copies_per_op,moves_per_op" << endl;
+  for(size_t i=0; i<results.size(); i++) {
+    const result& r = results[i];
+    out << label << ',' << r.structure << ',' << r.workload << ',' << r.n
+        << ',' << r.op << ',' << r.mops << ',' << r.p50 << ',' << r.p99
+        << ',' << r.p999 << ',' << r.bytes_per_key << ',' << r.comparisons
+        << ',' << r.copies << ',' << r.moves << endl;
+  }
+}
+
+void write_json(const string& path, const string& label,
+                const vector<result>& results) {
+  ofstream out(path.c_str());
+  out << "{\"label\": \"" << label << "\", \"results\": [" << endl;
+  for(size_t i=0; i<results.size(); i++) {
+    const result& r = results[i];
+    out << "  {\"structure\": \"" << r.structure << "\", \"workload\": \""
+        << r.workload << "\", \"n\": " << r.n << ", \"op\": \"" << r.op
+        << "\", \"mops\": " << r.mops << ", \"p50_ns\": " << r.p50
+        << ", \"p99_ns\": " << r.p99 << ", \"p999_ns\": " << r.p999
+        << ", \"bytes_per_key\": " << r.bytes_per_key
+        << ", \"comparisons_per_op\": " << r.comparisons
+        << ", \"copies_per_op\": " << r.copies
+        << ", \"moves_per_op\": " << r.moves << "}"
+        << (i + 1 < results.size() ? "," : "") << endl;
+  }
+  out << "]}" << endl;
+}
+
+/**
+ * The benchmark suite: every structure on every workload and size, printed
+ * as a table and optionally written as CSV and JSON for comparing commits.
+ *
+ *   --sizes 1000,100000        numbers of keys (up to 100000000)
+ *   --structures RST,std::set  any of RST, BST, std::set, RSTMap, std::map
+ *   --workloads random         any of sorted, random, zipfian, adversarial
+ *   --csv results.csv          write the results as CSV
+ *   --json results.json        write the results as JSON
+ *   --label abc123             tag every result, e.g. with a commit hash
+ *
+ * BST does not balance itself, so it only runs sorted and adversarial
+ * streams up to 20000 keys, and it cannot erase.
+ */
+int main(int argc, char** argv) {
+
+  vector<string> sizes = split_list("1000,10000,100000,1000000");
+  vector<string> structures = split_list("RST,BST,std::set,RSTMap,std::map");
+  vector<string> workloads = split_list("sorted,random,zipfian,adversarial");
+  string csv, json, label = "current";
+
+  for(int i=1; i+1<argc; i+=2) {
+    string flag = argv[i], arg = argv[i+1];
+    if(flag == "--sizes") sizes = split_list(arg);
+    else if(flag == "--structures") structures = split_list(arg);
+    else if(flag == "--workloads") workloads = split_list(arg);
+    else if(flag == "--csv") csv = arg;
+    else if(flag == "--json") json = arg;
+    else if(flag == "--label") label = arg;
+    else {
+      cout << "unknown option " << flag << endl;
+      return 1;
+    }
+  }
+
+  vector<result> results;
+  cout << "structure  workload     n          op       Mops/s    p50 ns  "
+       << "p99 ns  p999 ns  bytes/key  cmp/op  copy/op  move/op" << endl;
+
+  for(size_t si=0; si<sizes.size(); si++) {
+    int n = atoi(sizes[si].c_str());
+    for(size_t wi=0; wi<workloads.size(); wi++) {
+      workload w = make_workload(workloads[wi], n);
+      size_t first = results.size();
+
+      if(wanted(structures, "RST")) measure<rst_set>("RST", w, n, results);
+      if(wanted(structures, "BST")) {
+        if(n <= 20000 || (w.name != "sorted" && w.name != "adversarial"))
+          measure<bst_set>("BST", w, n, results);
+      }
+      if(wanted(structures, "std::set")) measure<std_set>("std::set", w, n, results);
+      if(wanted(structures, "RSTMap")) measure<rst_map>("RSTMap", w, n, results);
+      if(wanted(structures, "std::map")) measure<std_map>("std::map", w, n, results);
+
+      for(size_t i=first; i<results.size(); i++) {
+        const result& r = results[i];
+        printf("%-10s %-12s %-10d %-8s %8.3f %9llu %7llu %8llu %10.1f %7.2f"
+               " %8.2f %8.2f\n",
+               r.structure.c_str(), r.workload.c_str(), r.n, r.op.c_str(),
+               r.mops, (unsigned long long) r.p50, (unsigned long long) r.p99,
+               (unsigned long long) r.p999, r.bytes_per_key, r.comparisons,
+               r.copies, r.moves);
+      }
+    }
+  }
+
+  if(!csv.empty()) write_csv(csv, label, results);
+  if(!json.empty()) write_json(json, label, results);
+  return 0;
+}
@@ -0,0 +1,622 @@
+#include "RST.hpp"
+#include "ConcurrentRST.hpp"
+#include "CompactRST.hpp"
+#include "IntervalRST.hpp"
+#include "RSTSequence.hpp"
+#include "RSTMultiset.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+typedef chrono::steady_clock benchclock;
+
+/** Milliseconds elapsed since start */
+double elapsed(benchclock::time_point start) {
+  return chrono::duration<double, milli>(benchclock::now() - start).count();
+}
+
+/** N distinct keys in a reproducible psuedo-random order */
+vector<int> random_keys(int N) {
+  vector<int> v;
+  for(int i=0; i<N; i++) {
+    v.push_back(i);
+  }
+  srand ( unsigned ( 149 ) );
+  for(int i=N-1; i>0; i--) {
+    swap(v[i], v[rand() % (i+1)]);
+  }
+  return v;
+}
+
+/**
+ * Times inserting every key, inserting every key a second time (all
+ * duplicates) and tearing the tree down, for one allocator.
+ */
+template<template<typename> class Alloc>
+void bench_allocator(const string& name, const vector<int>& keys) {
+  double insert_ms, duplicate_ms, teardown_ms;
+  {
+    RST<int, Alloc>* r = new RST<int, Alloc>();
+
+    benchclock::time_point start = benchclock::now();
+    for(size_t i=0; i<keys.size(); i++) {
+      r->insert(keys[i]);
+    }
+    insert_ms = elapsed(start);
+
+    start = benchclock::now();
+    for(size_t i=0; i<keys.size(); i++) {
+      r->insert(keys[i]);
+    }
+    duplicate_ms = elapsed(start);
+
+    start = benchclock::now();
+    delete r;
+    teardown_ms = elapsed(start);
+  }
+
+  cout << name << ": insert " << insert_ms << " ms, duplicate insert "
+       << duplicate_ms << " ms, teardown " << teardown_ms << " ms" << endl;
+}
+
+/**
+ * Compares inserting into and tearing down an RST whose nodes come from a
+ * NodePool against one which calls new and delete for every node.
+ */
+void bench_allocators(int N) {
+  cout << endl << "### Node allocators, " << N << " random keys" << endl;
+  vector<int> keys = random_keys(N);
+  bench_allocator<HeapAllocator>("HeapAllocator", keys);
+  bench_allocator<NodePool>("NodePool     ", keys);
+}
+
+/**
+ * Compares union_with against inserting the keys of the smaller tree one at
+ * a time, for a small tree of m keys and a large tree of N keys.
+ */
+void bench_union(int N) {
+  cout << endl << "### Union of " << N << " keys with m keys" << endl;
+  vector<int> keys = random_keys(N);
+
+  for(int m = 10; m <= N; m *= 100) {
+    RST<int> large, small, looped;
+    for(int i=0; i<N; i++) {
+      large.insert(2 * keys[i]);
+      looped.insert(2 * keys[i]);
+    }
+    for(int i=0; i<m; i++) {
+      small.insert(2 * keys[i] + 1);
+    }
+
+    benchclock::time_point start = benchclock::now();
+    for(int i=0; i<m; i++) {
+      looped.insert(2 * keys[i] + 1);
+    }
+    double insert_ms = elapsed(start);
+
+    start = benchclock::now();
+    large.union_with(std::move(small));
+    double union_ms = elapsed(start);
+
+    cout << "m = " << m << ": " << m << " inserts " << insert_ms
+         << " ms, union_with " << union_ms << " ms" << endl;
+  }
+}
+
+/**
+ * Compares loading N sorted keys with build_from_sorted against inserting
+ * them one at a time.
+ */
+void bench_build(int N) {
+  cout << endl << "### Loading " << N << " sorted keys" << endl;
+  vector<int> keys;
+  for(int i=0; i<N; i++) {
+    keys.push_back(i);
+  }
+
+  benchclock::time_point start = benchclock::now();
+  {
+    RST<int> r;
+    for(int i=0; i<N; i++) {
+      r.insert(keys[i]);
+    }
+  }
+  cout << "insert one at a time: " << elapsed(start) << " ms" << endl;
+
+  start = benchclock::now();
+  {
+    RST<int> r = RST<int>::build_from_sorted(keys.begin(), keys.end());
+  }
+  cout << "build_from_sorted:    " << elapsed(start) << " ms" << endl;
+
+  start = benchclock::now();
+  {
+    RST<int> r = RST<int>::build_from_sorted(keys.begin(), keys.end(), false);
+  }
+  cout << "unverified build:     " << elapsed(start) << " ms" << endl;
+}
+
+/**
+ * Runs work(t) on each of threads threads and returns the milliseconds until
+ * all of them finished.
+ */
+template<typename Work>
+double run_threads(int threads, Work work) {
+  benchclock::time_point start = benchclock::now();
+  vector<thread> pool;
+  for(int t=0; t<threads; t++) {
+    pool.push_back(thread(work, t));
+  }
+  for(int t=0; t<threads; t++) {
+    pool[t].join();
+  }
+  return elapsed(start);
+}
+
+/**
+ * Measures insert and find throughput of a ConcurrentRST from 1 up to
+ * max_threads threads, against one RST behind a single mutex.
+ */
+void bench_concurrent(int N, int max_threads) {
+  cout << endl << "### Concurrent insert and find, " << N << " random keys" << endl;
+  vector<int> keys = random_keys(N);
+
+  for(int threads = 1; threads <= max_threads; threads *= 2) {
+    RST<int> locked;
+    mutex lock;
+    double locked_ms = run_threads(threads, [&](int t) {
+      for(int i=t; i<N; i+=threads) {
+        lock_guard<mutex> guard(lock);
+        locked.insert(keys[i]);
+      }
+      for(int i=t; i<N; i+=threads) {
+        lock_guard<mutex> guard(lock);
+        locked.find(keys[i]);
+      }
+    });
+
+    ConcurrentRST<int> sharded(keys.begin(), keys.begin() + min(N, 10000));
+    double sharded_ms = run_threads(threads, [&](int t) {
+      for(int i=t; i<N; i+=threads) {
+        sharded.insert(keys[i]);
+      }
+      for(int i=t; i<N; i+=threads) {
+        sharded.find(keys[i]);
+      }
+    });
+
+    cout << threads << " threads: single mutex " << 2 * N / locked_ms / 1000
+         << " Mops/s, ConcurrentRST " << 2 * N / sharded_ms / 1000
+         << " Mops/s" << endl;
+  }
+}
+
+/**
+ * Times finding every key of lookups in tree, in the given order, and
+ * returns millions of finds per second. The hits are summed so the finds
+ * cannot be optimized away.
+ */
+template<typename Tree>
+double find_rate(const Tree& tree, const vector<int>& lookups) {
+  benchclock::time_point start = benchclock::now();
+  size_t hits = 0;
+  for(size_t i=0; i<lookups.size(); i++) {
+    hits += tree.find(lookups[i]) != tree.end();
+  }
+  double ms = elapsed(start);
+  if(hits != lookups.size()) {
+    cout << "missing keys!" << endl;
+  }
+  return lookups.size() / ms / 1000;
+}
+
+/** Fills a CompactRST with keys and reports its footprint and find rate */
+template<template<typename> class Storage>
+void bench_compact_storage(const string& name, const vector<int>& keys,
+                           const vector<int>& lookups) {
+  CompactRST<int, Storage> c;
+  c.reserve(keys.size());
+  for(size_t i=0; i<keys.size(); i++) {
+    c.insert(keys[i]);
+  }
+  cout << name << double(c.bytes()) / keys.size() << " bytes/key, "
+       << find_rate(c, lookups) << " Mfinds/s" << endl;
+}
+
+/**
+ * Compares the memory per key and the find throughput of an RST, whose nodes
+ * are linked by pointers, against a CompactRST storing the same keys in
+ * arrays linked by 32-bit indices, with and without separate arrays per
+ * field.
+ */
+void bench_compact(int N) {
+  cout << endl << "### Node layouts, " << N << " random keys" << endl;
+  vector<int> keys = random_keys(N);
+  vector<int> lookups = keys;
+  for(int i=N-1; i>0; i--) {
+    swap(lookups[i], lookups[rand() % (i+1)]);
+  }
+
+  {
+    RST<int> r;
+    for(int i=0; i<N; i++) {
+      r.insert(keys[i]);
+    }
+    // NodePool slots are exactly one node wide
+    cout << "pointer RST:        " << sizeof(BSTNode<int>) << " bytes/key, "
+         << find_rate(r, lookups) << " Mfinds/s" << endl;
+  }
+  bench_compact_storage<PackedNodes>("CompactRST (AoS):   ", keys, lookups);
+  bench_compact_storage<SplitNodes>("CompactRST (SoA):   ", keys, lookups);
+}
+
+/**
+ * Compares the find throughput of an RST against the FrozenRST produced by
+ * freeze and against std::lower_bound on a sorted vector of the same keys.
+ */
+void bench_frozen(int N) {
+  cout << endl << "### Frozen lookups, " << N << " random keys" << endl;
+  vector<int> keys = random_keys(N);
+  vector<int> lookups = keys;
+  for(int i=N-1; i>0; i--) {
+    swap(lookups[i], lookups[rand() % (i+1)]);
+  }
+
+  RST<int> r;
+  for(int i=0; i<N; i++) {
+    r.insert(keys[i]);
+  }
+  benchclock::time_point start = benchclock::now();
+  FrozenRST<int> f = r.freeze();
+  double freeze_ms = elapsed(start);
+
+  double live = find_rate(r, lookups);
+  double frozen = find_rate(f, lookups);
+
+  vector<int> sorted_keys(f.begin(), f.end());
+  start = benchclock::now();
+  size_t hits = 0;
+  for(size_t i=0; i<lookups.size(); i++) {
+    hits += *std::lower_bound(sorted_keys.begin(), sorted_keys.end(), lookups[i]) == lookups[i];
+  }
+  double sorted = lookups.size() / elapsed(start) / 1000;
+  if(hits != lookups.size()) {
+    cout << "missing keys!" << endl;
+  }
+
+  cout << "freeze:             " << freeze_ms << " ms" << endl;
+  cout << "RST find:           " << live << " Mfinds/s" << endl;
+  cout << "FrozenRST find:     " << frozen << " Mfinds/s, " << frozen / live
+       << "x the live tree" << endl;
+  cout << "std::lower_bound:   " << sorted << " Mfinds/s" << endl;
+}
+
+/** An RST which can measure the depths of its nodes */
+template<typename Priority>
+struct depth_rst : public RST<int, NodePool, std::less<int>, Priority> {
+  void depths(double& total, int& deepest) const {
+    depths(this->root, 0, total, deepest);
+  }
+  void depths(BSTNode<int>* n, int depth, double& total, int& deepest) const {
+    for(; n; n = n->right, ++depth) {
+      total += depth;
+      deepest = max(deepest, depth);
+      depths(n->left, depth + 1, total, deepest);
+    }
+  }
+};
+
+/**
+ * Times inserting the keys into an RST taking its priorities from Priority,
+ * and reports the average and largest depth of the nodes, averaged over a
+ * few trees.
+ */
+template<typename Priority>
+void bench_priority(const string& name, const vector<int>& keys) {
+  const int trees = 5;
+  double ms = 0, total = 0, deepest = 0;
+  for(int t=0; t<trees; t++) {
+    depth_rst<Priority> r;
+    r.seed(t + 1);
+    benchclock::time_point start = benchclock::now();
+    for(size_t i=0; i<keys.size(); i++) {
+      r.insert(keys[i]);
+    }
+    ms += elapsed(start);
+    int d = 0;
+    r.depths(total, d);
+    deepest += d;
+  }
+  cout << name << keys.size() * trees / ms / 1000 << " Minserts/s, average depth "
+       << total / keys.size() / trees << ", max depth " << deepest / trees << endl;
+}
+
+/**
+ * Compares the priority sources of RST: the per-tree xoshiro256** and wyrand
+ * generators against the shared rand() RST used before, and against hashing
+ * the keys for canonical shapes.
+ */
+void bench_priorities(int N) {
+  cout << endl << "### Priority sources, " << N << " random keys" << endl;
+  vector<int> keys = random_keys(N);
+  bench_priority<RandPriority>("rand():             ", keys);
+  bench_priority<Xoshiro256>("Xoshiro256:         ", keys);
+  bench_priority<WyRand>("WyRand:             ", keys);
+  bench_priority<HashPriority>("HashPriority:       ", keys);
+}
+
+/**
+ * Measures the speedup of the bulk operations on a TaskPool of 1 up to
+ * max_threads threads: building from shuffled keys, uniting two trees of
+ * N/2 interleaved keys, and filtering and mapping a tree of N keys.
+ */
+void bench_parallel(int N, int max_threads) {
+  cout << endl << "### Parallel bulk operations, " << N << " random keys" << endl;
+  vector<int> keys = random_keys(N);
+  RST<int> whole = RST<int>::build_from_sorted(keys.begin(), keys.end(), false);
+  double base_ms[4] = { 0, 0, 0, 0 };
+
+  for(int threads = 1; threads <= max_threads; threads *= 2) {
+    TaskPool pool(threads);
+    double ms[4];
+
+    benchclock::time_point start = benchclock::now();
+    RST<int> built = RST<int>::build_parallel(keys.begin(), keys.end(), pool);
+    ms[0] = elapsed(start);
+
+    RST<int> evens = built.filter([](int k) { return k % 2 == 0; }, pool);
+    RST<int> odds = built.filter([](int k) { return k % 2 != 0; }, pool);
+    start = benchclock::now();
+    evens.union_with(std::move(odds), pool);
+    ms[1] = elapsed(start);
+
+    start = benchclock::now();
+    RST<int> filtered = whole.filter([](int k) { return k % 3 != 0; }, pool);
+    ms[2] = elapsed(start);
+
+    start = benchclock::now();
+    RST<int> mapped = whole.map([](int k) { return k / 2; }, pool);
+    ms[3] = elapsed(start);
+
+    if(threads == 1) copy(ms, ms + 4, base_ms);
+    cout << threads << " threads: build_parallel " << ms[0] << " ms ("
+         << base_ms[0] / ms[0] << "x), union_with " << ms[1] << " ms ("
+         << base_ms[1] / ms[1] << "x), filter " << ms[2] << " ms ("
+         << base_ms[2] / ms[2] << "x), map " << ms[3] << " ms ("
+         << base_ms[3] / ms[3] << "x)" << endl;
+  }
+}
+
+/**
+ * Compares the find throughput of a loop of find calls against find_batch on
+ * the same shuffled lookups, which overlaps the cache misses of several
+ * descents, and against find_batch on the lookups sorted, which walks the
+ * shared upper levels of their paths once. The gain shows on trees larger
+ * than the last level cache.
+ */
+void bench_batch(int N) {
+  cout << endl << "### Batched lookups, " << N << " random keys" << endl;
+  vector<int> keys = random_keys(N);
+  vector<int> lookups = keys;
+  for(int i=N-1; i>0; i--) {
+    swap(lookups[i], lookups[rand() % (i+1)]);
+  }
+
+  RST<int> r;
+  for(int i=0; i<N; i++) {
+    r.insert(keys[i]);
+  }
+  double looped = find_rate(r, lookups);
+
+  vector<bool> present;
+  present.reserve(N);
+  benchclock::time_point start = benchclock::now();
+  r.contains_batch(lookups.begin(), lookups.end(), back_inserter(present));
+  double batched = N / elapsed(start) / 1000;
+
+  vector<int> sorted_lookups(lookups);
+  sort(sorted_lookups.begin(), sorted_lookups.end());
+  present.clear();
+  start = benchclock::now();
+  r.contains_batch(sorted_lookups.begin(), sorted_lookups.end(),
+                   back_inserter(present));
+  double sorted = N / elapsed(start) / 1000;
+  if(count(present.begin(), present.end(), false)) {
+    cout << "missing keys!" << endl;
+  }
+
+  cout << "find loop:          " << looped << " Mfinds/s" << endl;
+  cout << "find_batch:         " << batched << " Mfinds/s, " << batched / looped
+       << "x the loop" << endl;
+  cout << "sorted find_batch:  " << sorted << " Mfinds/s, " << sorted / looped
+       << "x the loop" << endl;
+}
+
+/**
+ * Compares stabbing and overlap queries on an IntervalRST of N intervals,
+ * most of them short, against a scan of a vector of the same intervals.
+ * Both count the intervals found so the queries cannot be optimized away.
+ */
+void bench_intervals(int N) {
+  cout << endl << "### Interval queries, " << N << " random intervals" << endl;
+  IntervalRST<int> tree;
+  vector< Interval<int> > list;
+  for(int i=0; i<N; i++) {
+    int low = rand() % (4*N);
+    int high = low + (i % 10 ? rand() % 16 : rand() % 1024);
+    if(tree.insert(low, high)) list.push_back(Interval<int>{low, high});
+  }
+
+  const int queries = 1000;
+  vector<int> points;
+  for(int i=0; i<queries; i++) {
+    points.push_back(rand() % (4*N));
+  }
+
+  vector< Interval<int> > found;
+  size_t tree_hits = 0, scan_hits = 0;
+  benchclock::time_point start = benchclock::now();
+  for(int i=0; i<queries; i++) {
+    found.clear();
+    tree.containing(points[i], back_inserter(found));
+    tree_hits += found.size();
+  }
+  double stab_tree = elapsed(start);
+
+  start = benchclock::now();
+  for(int i=0; i<queries; i++) {
+    for(size_t j=0; j<list.size(); j++) {
+      scan_hits += list[j].low <= points[i] && points[i] <= list[j].high;
+    }
+  }
+  double stab_scan = elapsed(start);
+
+  start = benchclock::now();
+  for(int i=0; i<queries; i++) {
+    found.clear();
+    tree.overlapping(points[i], points[i] + 64, back_inserter(found));
+    tree_hits += found.size();
+  }
+  double overlap_tree = elapsed(start);
+
+  start = benchclock::now();
+  for(int i=0; i<queries; i++) {
+    for(size_t j=0; j<list.size(); j++) {
+      scan_hits += list[j].low <= points[i] + 64 && points[i] <= list[j].high;
+    }
+  }
+  double overlap_scan = elapsed(start);
+  if(tree_hits != scan_hits) {
+    cout << "different intervals found!" << endl;
+  }
+
+  cout << "IntervalRST stab:    " << queries / stab_tree << " queries/ms, "
+       << stab_scan / stab_tree << "x the scan" << endl;
+  cout << "IntervalRST overlap: " << queries / overlap_tree << " queries/ms, "
+       << overlap_scan / overlap_tree << "x the scan" << endl;
+  cout << "linear scan:         " << queries / stab_scan << " stabs/ms, "
+       << queries / overlap_scan << " overlaps/ms" << endl;
+}
+
+void bench_sequence(int N) {
+  cout << endl << "### Sequence edits, " << N << " elements" << endl;
+  vector<int> list;
+  for(int i=0; i<N; i++) {
+    list.push_back(i);
+  }
+  RSTSequence<int> seq(list.begin(), list.end());
+
+  const int edits = 10000;
+  vector<unsigned> positions;
+  for(int i=0; i<edits; i++) {
+    positions.push_back(rand() % N);
+  }
+
+  benchclock::time_point start = benchclock::now();
+  for(int i=0; i<edits; i++) {
+    seq.insert_at(positions[i], i);
+    seq.erase_at(positions[(i * 7) % edits]);
+  }
+  double seq_edit = elapsed(start);
+
+  start = benchclock::now();
+  for(int i=0; i<edits; i++) {
+    list.insert(list.begin() + positions[i], i);
+    list.erase(list.begin() + positions[(i * 7) % edits]);
+  }
+  double vec_edit = elapsed(start);
+
+  start = benchclock::now();
+  for(int i=0; i<edits; i++) {
+    unsigned first = positions[i] / 2;
+    seq.reverse(first, first + N / 2);
+  }
+  double seq_reverse = elapsed(start);
+
+  start = benchclock::now();
+  for(int i=0; i<edits; i++) {
+    unsigned first = positions[i] / 2;
+    reverse(list.begin() + first, list.begin() + first + N / 2);
+  }
+  double vec_reverse = elapsed(start);
+  if(seq.to_vector() != list) {
+    cout << "different sequences built!" << endl;
+  }
+
+  cout << "RSTSequence insert+erase: " << edits / seq_edit << " pairs/ms, "
+       << vec_edit / seq_edit << "x vector" << endl;
+  cout << "RSTSequence reverse:      " << edits / seq_reverse
+       << " reversals/ms, " << vec_reverse / seq_reverse << "x vector" << endl;
+}
+
+void bench_multiset(int N) {
+  cout << endl << "### Multiset inserts, " << N << " keys, "
+       << N / 100 + 1 << " distinct" << endl;
+  vector<int> keys;
+  for(int i=0; i<N; i++) {
+    keys.push_back(rand() % (N / 100 + 1));
+  }
+
+  RSTMultiset<int> counted;
+  benchclock::time_point start = benchclock::now();
+  for(int i=0; i<N; i++) {
+    counted.insert(keys[i]);
+  }
+  size_t counted_total = 0;
+  for(int i=0; i<N; i++) {
+    counted_total += counted.count(keys[i]);
+  }
+  double counted_time = elapsed(start);
+
+  multiset<int> nodes;
+  start = benchclock::now();
+  for(int i=0; i<N; i++) {
+    nodes.insert(keys[i]);
+  }
+  size_t nodes_total = 0;
+  for(int i=0; i<N; i++) {
+    nodes_total += nodes.count(keys[i]);
+  }
+  double nodes_time = elapsed(start);
+  if(counted_total != nodes_total) {
+    cout << "different counts found!" << endl;
+  }
+
+  cout << "RSTMultiset:   " << N / counted_time << " inserts+counts/ms in "
+       << counted.distinct_size() << " nodes" << endl;
+  cout << "std::multiset: " << N / nodes_time << " inserts+counts/ms in "
+       << nodes.size() << " nodes" << endl;
+}
+
+/**
+ * A simple benchmark driver for the RST class template.
+ */
+int main(int argc, char** argv) {
+
+  int N = 1000000;
+  if(argc > 1) N = atoi(argv[1]);
+  int threads = max(1u, thread::hardware_concurrency());
+  if(argc > 2) threads = atoi(argv[2]);
+
+  bench_allocators(N);
+  bench_union(N);
+  bench_build(N);
+  bench_concurrent(N, threads);
+  bench_compact(N);
+  bench_frozen(N);
+  bench_priorities(N);
+  bench_parallel(N, threads);
+  bench_batch(N);
+  bench_intervals(N);
+  bench_sequence(N);
+  bench_multiset(N);
+  return 0;
+}
@@ -1,19 +1,156 @@
-
 #include "countint.hpp"
+#include <mutex>
+#include <vector>
 
 /** Implementation of the countint class
  *  See: countint.hpp
  *  @author Paul Kube (c) 2010
  */
 
-unsigned long countint::count = 0;  // define  static count variable
+namespace {
+
+// the countblock of a live thread, and what it had counted when the
+// counts were last cleared. Only its thread writes the block, so clearing
+// moves the baseline instead of storing into the block
+struct liveblock {
+  countblock* block;
+  keycounts base;
+
+  keycounts read() const { return block->read() - base; }
+};
+
+// the countblocks of live threads, and the counts of finished ones. It is
+// created on first use and never destroyed, so countints may be used
+// during static initialization and destruction
+struct registry {
+  std::mutex lock;
+  std::vector<liveblock> blocks;
+  keycounts finished;
+};
+
+registry& threads() {
+  static registry* r = new registry;
+  return *r;
+}
+
+// registers the countblock of its thread, and folds it into finished
+// when the thread exits
+struct threadblock {
+  countblock counts;
+
+  threadblock() {
+    registry& r = threads();
+    std::lock_guard<std::mutex> lock(r.lock);
+    r.blocks.push_back(liveblock{&counts, keycounts()});
+  }
+
+  ~threadblock() {
+    registry& r = threads();
+    std::lock_guard<std::mutex> lock(r.lock);
+    for(size_t b = 0; b < r.blocks.size(); b++) {
+      if(r.blocks[b].block == &counts) {
+        r.finished += r.blocks[b].read();
+        r.blocks.erase(r.blocks.begin() + b);
+        break;
+      }
+    }
+  }
+};
+
+thread_local threadblock mine;
+
+}
+
+keycounts& keycounts::operator+=(keycounts const & o) {
+  comparisons += o.comparisons;
+  copies += o.copies;
+  moves += o.moves;
+  assignments += o.assignments;
+  destructions += o.destructions;
+  return *this;
+}
+
+keycounts keycounts::operator-(keycounts const & o) const {
+  keycounts d = *this;
+  d.comparisons -= o.comparisons;
+  d.copies -= o.copies;
+  d.moves -= o.moves;
+  d.assignments -= o.assignments;
+  d.destructions -= o.destructions;
+  return d;
+}
+
+keycounts countblock::read() const {
+  keycounts k;
+  k.comparisons = comparisons.get();
+  k.copies = copies.get();
+  k.moves = moves.get();
+  k.assignments = assignments.get();
+  k.destructions = destructions.get();
+  return k;
+}
+
+countblock& countint::local() {
+  return mine.counts;
+}
 
 void countint::clearcount() {
-  count = 0;
+  registry& r = threads();
+  std::lock_guard<std::mutex> lock(r.lock);
+  r.finished = keycounts();
+  for(size_t b = 0; b < r.blocks.size(); b++) {
+    r.blocks[b].base = r.blocks[b].block->read();
+  }
 }
 
 unsigned long countint::getcount() {
-  return count;
+  return counts().comparisons;
+}
+
+keycounts countint::counts() {
+  registry& r = threads();
+  std::lock_guard<std::mutex> lock(r.lock);
+  keycounts total = r.finished;
+  for(size_t b = 0; b < r.blocks.size(); b++) {
+    total += r.blocks[b].read();
+  }
+  return total;
+}
+
+keycounts countint::threadcounts() {
+  countblock& own = local();
+  registry& r = threads();
+  std::lock_guard<std::mutex> lock(r.lock);
+  for(size_t b = 0; b < r.blocks.size(); b++) {
+    if(r.blocks[b].block == &own) {
+      return r.blocks[b].read();
+    }
+  }
+  return own.read();
+}
+
+countint::countint(countint const & o) : i(o.i) {
+  local().copies.bump();
+}
+
+countint::countint(countint&& o) noexcept : i(o.i) {
+  local().moves.bump();
+}
+
+countint& countint::operator=(countint const & o) {
+  local().assignments.bump();
+  i = o.i;
+  return *this;
+}
+
+countint& countint::operator=(countint&& o) noexcept {
+  local().assignments.bump();
+  i = o.i;
+  return *this;
+}
+
+countint::~countint() {
+  local().destructions.bump();
 }
   
 int countint::getval() const {
@@ -21,35 +158,40 @@ int countint::getval() const {
 }
 
 bool countint::operator<(countint const & o) const {
-    count++;
+    local().comparisons.bump();
     return i < o.i;
 }
 
 bool countint::operator<=(countint const & o) const {
-    count++;
+    local().comparisons.bump();
     return i <= o.i;
 }
 
 bool countint::operator==(countint const & o) const {
-    count++;
+    local().comparisons.bump();
     return i == o.i;
 }
 
 bool countint::operator>(countint const & o) const {
-    count++;
+    local().comparisons.bump();
     return i > o.i;
 }
 
 bool countint::operator>=(countint const & o) const {
-    count++;
+    local().comparisons.bump();
     return i >= o.i;
 }
 
 bool countint::operator!=(countint const & o) const {
-    count++;
+    local().comparisons.bump();
     return i != o.i;
 }
 
+int countint::compare(countint const & o) const {
+    local().comparisons.bump();
+    return (o.i < i) - (i < o.i);
+}
+
 std::ostream& operator<<(std::ostream& stm, const countint& i) {
     stm << i.getval();
     return stm;
@@ -2,24 +2,77 @@
 
 #ifndef COUNTINT_HPP
 #define COUNTINT_HPP
+#include <atomic>
 #include <iostream>
+#include <utility>
+
+/** The operations counted on countints and other counted keys.
+ *  Every thread counts into its own countblock, and countint::counts()
+ *  adds up those of all threads, including threads that have finished.
+ */
+struct keycounts {
+  unsigned long comparisons = 0;
+  unsigned long copies = 0;        // copy constructions
+  unsigned long moves = 0;         // move constructions
+  unsigned long assignments = 0;   // copy and move assignments
+  unsigned long destructions = 0;
+
+  keycounts& operator+=(keycounts const & o);
+  keycounts operator-(keycounts const & o) const;
+};
+
+/** One count of one thread. Only its thread writes it, so bumping it
+ *  needs no atomic read-modify-write, but other threads may read it. */
+struct countcell {
+  std::atomic<unsigned long> n{0};
+  void bump() {
+    n.store(n.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+  unsigned long get() const { return n.load(std::memory_order_relaxed); }
+};
+
+/** The counts of one thread. They only ever grow: clearing the counts
+ *  remembers where each thread stood rather than writing its cells */
+struct countblock {
+  countcell comparisons, copies, moves, assignments, destructions;
+  keycounts read() const;
+};
 
 /** A class which counts the number of comparisons done
- *  to instances of the class.
- *  To reset the count to 0, call countint::clearcount()
+ *  to instances of the class, along with their copies, moves,
+ *  assignments and destructions.
+ *  To reset the counts to 0, call countint::clearcount()
  *  To inspect the current value of thecount, call countint::getcount()
+ *  To inspect every count, call countint::counts()
+ *  Counting is thread-safe: every thread counts on its own and the
+ *  counts are only added up when they are asked for.
  *  @author Paul Kube (c) 2010, 2011
  */
 class countint {
 public:
   countint(int i) : i(i) {}
 
-  /** Clear (set to 0) the total comparison count of countints. */
+  countint(countint const & o);
+  countint(countint&& o) noexcept;
+  countint& operator=(countint const & o);
+  countint& operator=(countint&& o) noexcept;
+  ~countint();
+
+  /** Clear (set to 0) every count of every thread. */
   static void clearcount();
 
   /** Return the total comparison count of countints. */
   static unsigned long getcount();
-  
+
+  /** Return every count, added up over all threads. */
+  static keycounts counts();
+
+  /** Return the counts of the calling thread alone. */
+  static keycounts threadcounts();
+
+  /** The counts of the calling thread, for counted keys to add to. */
+  static countblock& local();
+
   /** Return the value of this countint. */
   int getval() const;
 
@@ -39,9 +92,13 @@ public:
 
   bool operator!=(countint const & o) const;
 
+  /** Three-way comparison: negative, zero or positive as this countint
+   *  is less than, equal to or greater than o. Counts as one comparison.
+   */
+  int compare(countint const & o) const;
+
 private:
   int i; // the value of this countint
-  static unsigned long count;  // to keep track of comparisons done to all countints
 
 };
 
@@ -49,4 +106,87 @@ private:
 std::ostream& operator<<(std::ostream& stm, const countint& i);
 
 
-#endif // COUNTINT_HPP
\ No newline at end of file
+/** A scope guard measuring what the calling thread did to counted keys
+ *  while it was alive. counts() gives the counts so far, and if a
+ *  keycounts was passed in it receives them when the guard is destroyed:
+ *
+ *    keycounts spent;
+ *    { countscope guard(&spent); tree.insert(key); }
+ */
+class countscope {
+public:
+  explicit countscope(keycounts* out = nullptr)
+      : start(countint::threadcounts()), out(out) {}
+
+  countscope(countscope const &) = delete;
+  countscope& operator=(countscope const &) = delete;
+
+  ~countscope() {
+    if(out) *out = counts();
+  }
+
+  keycounts counts() const {
+    return countint::threadcounts() - start;
+  }
+
+private:
+  keycounts start;
+  keycounts* out;
+};
+
+
+/** Wraps any key type T, counting the same operations as countint into
+ *  the same counters, so the copies of heavier keys like std::string can
+ *  be measured too. Comparisons go through operator< and compare.
+ */
+template<typename T>
+class counted {
+public:
+  template<typename... Args>
+  counted(Args&&... args) : v(std::forward<Args>(args)...) {}
+
+  counted(counted const & o) : v(o.v) { countint::local().copies.bump(); }
+  counted(counted& o) : v(o.v) { countint::local().copies.bump(); }
+  counted(counted&& o) noexcept : v(std::move(o.v)) { countint::local().moves.bump(); }
+
+  counted& operator=(counted const & o) {
+    countint::local().assignments.bump();
+    v = o.v;
+    return *this;
+  }
+
+  counted& operator=(counted&& o) noexcept {
+    countint::local().assignments.bump();
+    v = std::move(o.v);
+    return *this;
+  }
+
+  ~counted() { countint::local().destructions.bump(); }
+
+  const T& get() const { return v; }
+
+  bool operator<(counted const & o) const {
+    countint::local().comparisons.bump();
+    return v < o.v;
+  }
+
+  bool operator==(counted const & o) const {
+    countint::local().comparisons.bump();
+    return v == o.v;
+  }
+
+  bool operator!=(counted const & o) const {
+    return !(*this == o);
+  }
+
+  int compare(counted const & o) const {
+    countint::local().comparisons.bump();
+    return (o.v < v) - (v < o.v);
+  }
+
+private:
+  T v;
+};
+
+
+#endif // COUNTINT_HPP